@@ -0,0 +1,27 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 texCoord;
+
+layout(location = 0) out vec4 outColor;
+
+// vulkan_bindless_table
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+// object_push_constants
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint material_index;
+    uint texture_index;
+    uint sampler_index;
+} object;
+
+void main() {
+    // Push constants are uniform across the draw, nonuniformEXT keeps this
+    // correct once the indices come from per instance data
+    outColor = texture(sampler2D(textures[nonuniformEXT(object.texture_index)],
+                                 samplers[nonuniformEXT(object.sampler_index)]),
+                       texCoord);
+}
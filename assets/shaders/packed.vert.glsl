@@ -0,0 +1,43 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+// object_push_constants
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    uint material_index;
+    uint texture_index;
+    uint sampler_index;
+} object;
+
+// PackedVertex. Vertex fetch already expands the snorm, unorm and half float
+// components, and object.model includes the transform from the quantized
+// [-1, 1] positions back to mesh space.
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec4 inColor;
+layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in vec2 inNormal;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+// Mesh space, for lighting
+layout(location = 2) out vec3 fragNormal;
+
+// Must stay in sync with oct_encode in vertex_packing.cpp
+vec3 oct_decode(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -t : t;
+    normal.y += normal.y >= 0.0 ? -t : t;
+    return normalize(normal);
+}
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * object.model * vec4(inPosition, 1.0);
+    fragColor = inColor.rgb;
+    fragTexCoord = inTexCoord;
+    fragNormal = oct_decode(inNormal);
+}
@@ -14,6 +14,14 @@ then
 echo "Error:"$ERRORLEVEL && exit
 fi
 
+echo "assets/shaders/packed.vert.glsl -> bin/assets/shaders/packed.vert.spv"
+$VULKAN_SDK/bin/glslc -fshader-stage=vert assets/shaders/packed.vert.glsl -o bin/assets/shaders/packed.vert.spv --target-spv=spv1.5 --target-env=vulkan1.2
+ERRORLEVEL=$?
+if [ $ERRORLEVEL -ne 0 ]
+then
+echo "Error:"$ERRORLEVEL && exit
+fi
+
 echo "assets/shaders/default.frag.glsl -> bin/assets/shaders/default.frag.spv"
 $VULKAN_SDK/bin/glslc -fshader-stage=frag assets/shaders/default.frag.glsl -o bin/assets/shaders/default.frag.spv --target-spv=spv1.5 --target-env=vulkan1.2
 ERRORLEVEL=$?
@@ -22,11 +30,21 @@ then
 echo "Error:"$ERRORLEVEL && exit
 fi
 
+echo "assets/shaders/bindless.frag.glsl -> bin/assets/shaders/bindless.frag.spv"
+$VULKAN_SDK/bin/glslc -fshader-stage=frag assets/shaders/bindless.frag.glsl -o bin/assets/shaders/bindless.frag.spv --target-spv=spv1.5 --target-env=vulkan1.2
+ERRORLEVEL=$?
+if [ $ERRORLEVEL -ne 0 ]
+then
+echo "Error:"$ERRORLEVEL && exit
+fi
+
 echo "Copying assets..."
 echo cp -R "assets" "bin"
 cp -R "assets" "bin"
 
 spirv-val bin/assets/shaders/default.vert.spv
+spirv-val bin/assets/shaders/packed.vert.spv
 spirv-val bin/assets/shaders/default.frag.spv
+spirv-val bin/assets/shaders/bindless.frag.spv
 
 echo "Done."
@@ -0,0 +1,31 @@
+#ifndef ASSET_COMPRESSION_H
+#define ASSET_COMPRESSION_H
+
+#include <cstddef>
+
+// Blocks use the LZ4 block format: fast to decode, no dictionary or framing.
+
+/**
+ * @brief Gets the largest compressed size of size bytes of input
+ */
+size_t asset_compress_bound(size_t size);
+
+/**
+ * @brief Compresses a block
+ * @param capacity Bytes available at destination, compression stops as soon
+ * as the output would not fit
+ * @returns The compressed size, or 0 if it didn't fit
+ */
+size_t asset_compress(const void *source, size_t size, void *destination,
+                      size_t capacity);
+
+/**
+ * @brief Decompresses a block, checking every read and write against the
+ * given sizes
+ * @param size The exact decompressed size
+ * @returns true if the block was valid and decompressed to exactly size bytes
+ */
+bool asset_decompress(const void *source, size_t source_size,
+                      void *destination, size_t size);
+
+#endif
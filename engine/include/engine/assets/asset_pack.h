@@ -0,0 +1,122 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "engine/filesystem.h"
+
+#define ASSET_PACK_MAGIC 0x4B41504F  // 'OPAK'
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_EXTENSION ".opak"
+// Blobs start on this boundary, enough for SPIR-V words and vertex data
+#define ASSET_PACK_BLOB_ALIGNMENT 16
+
+typedef enum asset_pack_compression {
+  ASSET_PACK_COMPRESSION_NONE = 0,
+  // LZ4 block format, see asset_compression.h
+  ASSET_PACK_COMPRESSION_LZ4 = 1
+} asset_pack_compression;
+
+/**
+ * On disk layout of a pack. The header is followed by the index, sorted by
+ * path hash, then the path strings and finally the blobs, each aligned to
+ * ASSET_PACK_BLOB_ALIGNMENT.
+ */
+typedef struct asset_pack_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t reserved;
+  uint64_t index_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+} asset_pack_header;
+
+typedef struct asset_pack_entry {
+  // FNV-1a of the path, the index is sorted by it
+  uint64_t path_hash;
+  uint64_t offset;
+  // Bytes in the pack, and once decompressed
+  uint64_t stored_size;
+  uint64_t size;
+  // Into the string table, not null terminated
+  uint32_t path_offset;
+  uint32_t path_length;
+  uint32_t compression;
+  uint32_t reserved;
+} asset_pack_entry;
+
+// A mounted, read-only memory mapped pack
+typedef struct asset_pack {
+  file_mapping mapping;
+  const asset_pack_header *header;
+  const asset_pack_entry *entries;
+  const char *strings;
+} asset_pack;
+
+// The bytes of one asset
+typedef struct asset_data {
+  const void *data;
+  size_t size;
+  // Set when data had to be decompressed, freed on release
+  void *owned;
+  // Set when data is a loose file rather than part of a pack
+  file_mapping mapping;
+} asset_data;
+
+// One file to put in a pack
+typedef struct asset_pack_source {
+  // Path the asset is looked up by, relative to the assets root
+  const char *path;
+  const void *data;
+  size_t size;
+} asset_pack_source;
+
+/**
+ * @brief Hashes an asset path the way the index does
+ */
+uint64_t asset_pack_hash_path(const char *path, size_t length);
+
+/**
+ * @brief Writes a pack. Paths must be unique. The file is written to a
+ * temporary path first and renamed, like the mesh cache.
+ * @param compress Compress the entries that shrink enough to be worth it
+ * @returns true on success
+ */
+bool asset_pack_write(const char *path, const asset_pack_source *sources,
+                      uint32_t source_count, bool compress);
+
+/**
+ * @brief Maps a pack and validates its index
+ * @returns true on success
+ */
+bool asset_pack_mount(const char *path, asset_pack *out_pack);
+
+/**
+ * @brief Unmaps a pack. Uncompressed asset data served from it is invalidated.
+ */
+void asset_pack_unmount(asset_pack *pack);
+
+/**
+ * @brief Looks an asset up by path with a binary search of the index
+ * @returns The entry, or nullptr if the pack doesn't contain the path
+ */
+const asset_pack_entry *asset_pack_find(const asset_pack *pack,
+                                        const char *path);
+
+/**
+ * @brief Gets an entry's bytes. Uncompressed entries point straight into the
+ * mapping, compressed ones are decompressed into a new buffer.
+ * @param out_data Released with asset_data_release
+ * @returns false if the entry is corrupt
+ */
+bool asset_pack_read(const asset_pack *pack, const asset_pack_entry *entry,
+                     asset_data *out_data);
+
+/**
+ * @brief Frees anything asset_data owns
+ */
+void asset_data_release(asset_data *data);
+
+#endif
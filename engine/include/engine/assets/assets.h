@@ -0,0 +1,40 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <cstddef>
+
+#include "engine/assets/asset_pack.h"
+
+// Loose assets live here, names passed to assets_load are relative to it
+#define ASSETS_ROOT "../bin/assets/"
+// Built from ASSETS_ROOT by orion_pack, used instead of it when present
+#define ASSETS_PACK_PATH "../bin/assets" ASSET_PACK_EXTENSION
+
+/**
+ * @brief Mounts the asset pack, if there is one. Until it is unmounted assets
+ * are served from the pack, falling back to loose files for anything it
+ * doesn't contain.
+ * @returns true if a pack was mounted
+ */
+bool assets_mount(const char *pack_path);
+
+/**
+ * @brief Unmounts the pack. Asset data served from it is invalidated.
+ */
+void assets_unmount();
+
+/**
+ * @brief Checks if an asset is in the mounted pack
+ * @param name Path relative to ASSETS_ROOT, eg. "shaders/vert.spv"
+ */
+bool assets_is_packed(const char *name);
+
+/**
+ * @brief Gets an asset's bytes from the pack, or maps the loose file
+ * @param name Path relative to ASSETS_ROOT, eg. "shaders/vert.spv"
+ * @param out_data Released with asset_data_release
+ * @returns true on success
+ */
+bool assets_load(const char *name, asset_data *out_data);
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef FILESYSTEM_H
 #define FILESYSTEM_H
 
+#include <cstddef>
+#include <cstdint>
+
 // Handle to a file
 typedef struct file_handle {
   void *handle;
@@ -12,6 +15,21 @@ typedef enum file_modes {
   FILE_MODE_WRITE = 0x2
 } file_modes;
 
+// Access pattern hints for a mapped file, may be combined
+typedef enum file_map_hints {
+  FILE_MAP_HINT_NONE = 0x0,
+  // Read front to back, so the kernel can read ahead aggressively
+  FILE_MAP_HINT_SEQUENTIAL = 0x1,
+  // The whole file is about to be read, start paging it in now
+  FILE_MAP_HINT_WILLNEED = 0x2
+} file_map_hints;
+
+// Read-only view of an entire file
+typedef struct file_mapping {
+  const void *data;
+  size_t size;
+} file_mapping;
+
 /**
  * Checks if a file with the given path exists
  * @param path The path of the file to check
@@ -33,10 +51,107 @@ bool filesystem_write_line(file_handle *handle, const char *text);
 bool filesystem_read(file_handle *handle, long data_size, void *out_data,
                      long *out_bytes_read);
 
+/**
+ * Reads the rest of a file into a new buffer
+ * @param out_bytes The contents, the caller frees them with free()
+ * @returns true if the whole file was read
+ */
 bool filesystem_read_all_bytes(file_handle *handle, char **out_bytes,
                                long *out_bytes_read);
 
-bool filesystem_write(file_handle *handle, char data_size, const void *data,
-                      char *out_bytes_written);
+bool filesystem_write(file_handle *handle, long data_size, const void *data,
+                      long *out_bytes_written);
+
+/**
+ * Maps a whole file read-only, without copying it. The data is page aligned
+ * and stays valid until filesystem_unmap, even after the file is deleted.
+ * @param path The path of the file to map
+ * @param hints Combination of file_map_hints
+ * @param out_mapping The view of the file. An empty file maps to no data
+ * @returns true on success
+ */
+bool filesystem_map(const char *path, uint32_t hints,
+                    file_mapping *out_mapping);
+
+/**
+ * Unmaps a file, invalidating its data
+ */
+void filesystem_unmap(file_mapping *mapping);
+
+// Asynchronous whole file reads
+
+typedef enum file_io_backend {
+  // io_uring when the kernel allows it, threads otherwise
+  FILE_IO_BACKEND_AUTO = 0,
+  // Reads are submitted to the kernel in batches from one service thread
+  FILE_IO_BACKEND_IO_URING = 1,
+  // A pool of threads each doing blocking preads
+  FILE_IO_BACKEND_THREADS = 2
+} file_io_backend;
+
+typedef struct file_io_queue file_io_queue;
+
+// Completion handle for one read, unique within its queue
+typedef uint32_t file_read_id;
+
+typedef struct file_read_result {
+  // The contents, owned by whoever waits for the read. Freed with free()
+  char *data;
+  size_t size;
+  bool success;
+} file_read_result;
+
+/**
+ * Called on an I/O thread as soon as a read finishes, before any waiter is
+ * woken. It may queue and submit more reads.
+ */
+typedef void (*file_read_callback)(file_read_id id,
+                                   const file_read_result *result,
+                                   void *user_data);
+
+/**
+ * Creates a queue and the threads servicing it
+ * @param backend The backend to use, AUTO falls back to threads
+ * @param depth The most reads in flight at once, 0 for a default
+ * @param out_queue The new queue
+ * @returns false if the requested backend isn't available
+ */
+bool filesystem_io_queue_create(file_io_backend backend, uint32_t depth,
+                                file_io_queue **out_queue);
+
+/**
+ * Waits for every read in flight, frees any results nobody waited for and
+ * destroys the queue
+ */
+void filesystem_io_queue_destroy(file_io_queue *queue);
+
+/**
+ * Gets the backend a queue ended up with
+ */
+file_io_backend filesystem_io_queue_backend(file_io_queue *queue);
+
+/**
+ * Queues a read of a whole file. Nothing is read until the next
+ * filesystem_io_submit, so many reads go to the backend at once.
+ * @param callback Optional, called on an I/O thread when the read finishes
+ * @returns The handle to wait on
+ */
+file_read_id filesystem_read_async(file_io_queue *queue, const char *path,
+                                   file_read_callback callback,
+                                   void *user_data);
+
+/**
+ * Hands every queued read to the backend
+ */
+void filesystem_io_submit(file_io_queue *queue);
+
+/**
+ * Blocks until a read finishes, submitting it first if needed. Each read can
+ * be waited for once.
+ * @param out_result The result, its data now belongs to the caller
+ * @returns true if the whole file was read
+ */
+bool filesystem_io_wait(file_io_queue *queue, file_read_id id,
+                        file_read_result *out_result);
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef FRAME_LIMITER_H
+#define FRAME_LIMITER_H
+
+#include <cstdint>
+
+// Sleeping is only trusted up to this close to the deadline, the rest is spun
+// to land on it precisely
+#define FRAME_LIMITER_SPIN_SECONDS 0.002
+
+/**
+ * The frame limiter caps the main loop's rate on the CPU. Call
+ * frame_limiter_wait right before polling input, so the wait is spent ahead
+ * of input sampling and the frame goes out with the freshest input. A low
+ * cap saves power, while no cap with a mailbox or immediate present mode
+ * gives the lowest input to photon latency.
+ */
+typedef struct frame_limiter {
+  // Seconds between frames, 0 when unlimited
+  double interval;
+  // When the next frame may start
+  double deadline;
+  uint64_t frame_count;
+  // Frames a whole interval late, which restart the schedule
+  uint64_t late_count;
+  double sleep_seconds;
+  double spin_seconds;
+} frame_limiter;
+
+/**
+ * @param frames_per_second The cap, 0 for unlimited
+ */
+void frame_limiter_create(double frames_per_second, frame_limiter* out_limiter);
+
+/**
+ * @brief Changes the cap, takes effect from the next frame
+ */
+void frame_limiter_set_rate(frame_limiter* limiter, double frames_per_second);
+
+/**
+ * @brief Blocks until the next frame may start
+ */
+void frame_limiter_wait(frame_limiter* limiter);
+
+void frame_limiter_log_stats(const frame_limiter* limiter);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "engine/filesystem.h"
+#include "engine/renderer_types.inl"
+
+#define MESH_CACHE_MAGIC 0x48534D4F  // 'OMSH'
+// Bump whenever the layout of the file or the processing baked into the
+// vertex/index blobs changes, so stale caches are rebuilt.
+#define MESH_CACHE_VERSION 4
+#define MESH_CACHE_EXTENSION ".omesh"
+#define MESH_CACHE_BLOB_ALIGNMENT 16
+
+/**
+ * On disk layout of a cached mesh. The header is followed by the vertex blob
+ * (laid out exactly as Vertex) and the index blob (uint16_t or uint32_t, see
+ * index_stride), each starting at an offset aligned to
+ * MESH_CACHE_BLOB_ALIGNMENT.
+ */
+typedef struct mesh_cache_header {
+  uint32_t magic;
+  uint32_t version;
+  // Key of the source asset this was built from
+  uint64_t source_path_hash;
+  int64_t source_mtime;
+  uint64_t source_size;
+
+  uint32_t vertex_stride;
+  uint32_t vertex_count;
+  uint32_t index_stride;
+  uint32_t index_count;
+  uint64_t vertex_offset;
+  uint64_t index_offset;
+
+  float bounds_min[3];
+  float bounds_max[3];
+} mesh_cache_header;
+
+// A read-only memory mapped mesh cache file
+typedef struct mesh_cache_file {
+  file_mapping mapping;
+  mesh_geometry geometry;
+  bool is_valid;
+} mesh_cache_file;
+
+/**
+ * @brief Maps the cache built for the given source asset, if there is one and
+ * it is still up to date with the source path, modification time and size.
+ * @param source_path The path of the source asset (ie. the .obj)
+ * @param out_file The mapped file. geometry points directly into the mapping
+ * @returns true on a cache hit, false if the asset must be rebuilt
+ */
+bool mesh_cache_load(const std::string &source_path,
+                     mesh_cache_file *out_file);
+
+/**
+ * @brief Reads a cache that is already in memory, eg. one stored in an asset
+ * pack. There's no source to compare against so only the layout is checked.
+ * @param out_geometry Points directly into data
+ * @returns true if data is a valid cache
+ */
+bool mesh_cache_load_memory(const void *data, size_t size,
+                            mesh_geometry *out_geometry);
+
+/**
+ * @brief Writes geometry to the cache for the given source asset. The file is
+ * written to a temporary path first and renamed so readers never see a
+ * partially written cache.
+ */
+bool mesh_cache_write(const std::string &source_path,
+                      const mesh_geometry *geometry);
+
+/**
+ * @brief Unmaps a cache file. Any geometry pointing into it is invalidated.
+ */
+void mesh_cache_close(mesh_cache_file *file);
+
+/**
+ * @brief Gets the cache file path for a source asset
+ */
+std::string mesh_cache_path(const std::string &source_path);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef MESH_LOADER_H
+#define MESH_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "engine/geometry/mesh_cache.h"
+#include "engine/renderer_types.inl"
+
+/**
+ * A loaded mesh. geometry is the view to upload from, and points either into
+ * vertices and one of the index vectors (freshly parsed) or into cache (mapped
+ * from disk).
+ */
+typedef struct mesh_asset {
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  // Used instead of indices when every vertex is addressable with 16 bits
+  std::vector<uint16_t> short_indices;
+  mesh_cache_file cache;
+  mesh_geometry geometry;
+  bool from_cache;
+} mesh_asset;
+
+typedef enum mesh_obj_parser {
+  // Reference single threaded parser
+  MESH_OBJ_PARSER_TINYOBJ = 0,
+  // Chunked multithreaded parser, falls back to tinyobj for n-gons
+  MESH_OBJ_PARSER_PARALLEL = 1
+} mesh_obj_parser;
+
+/**
+ * @brief Parses an .obj file into deduplicated vertices and indices, without
+ * going through the mesh cache. Both parsers produce identical output.
+ */
+bool mesh_loader_parse_obj(const std::string& path, mesh_obj_parser parser,
+                           std::vector<Vertex>* out_vertices,
+                           std::vector<uint32_t>* out_indices);
+
+/**
+ * @brief Loads a mesh from an .obj file, going through the binary mesh cache
+ * when use_cache is set. A cache miss parses the source and writes the cache
+ * for the next run.
+ * @param path The path of the .obj file
+ * @param use_cache Whether to read/write the mesh cache
+ * @param out_mesh The loaded mesh
+ * @returns true on success
+ */
+bool mesh_loader_load(const std::string& path, bool use_cache,
+                      mesh_asset* out_mesh);
+
+/**
+ * @brief Loads a mesh from an in-memory cache, as stored in an asset pack
+ * @param name The name to log the mesh as
+ * @param data The cache contents, must outlive the mesh
+ * @param out_mesh The loaded mesh
+ * @returns true on success
+ */
+bool mesh_loader_load_memory(const char* name, const void* data, size_t size,
+                             mesh_asset* out_mesh);
+
+/**
+ * @brief Frees the CPU side storage of a mesh once it has been uploaded.
+ * The vertex and index counts in geometry are kept for drawing.
+ */
+void mesh_loader_release(mesh_asset* mesh);
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "engine/renderer_types.inl"
+
+// Post-transform cache size optimized for and measured against. Most GPUs
+// behave like a FIFO of roughly this many vertices.
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+// How much worse the overdraw pass may make ACMR before it is rejected
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+typedef struct vertex_cache_stats {
+  // Average cache miss ratio, transformed vertices per triangle. 0.5 is the
+  // best a regular grid can do, 3 means no reuse at all.
+  float acmr;
+  // Average transform to vertex ratio, 1 is ideal
+  float atvr;
+} vertex_cache_stats;
+
+typedef struct mesh_optimize_stats {
+  vertex_cache_stats before;
+  vertex_cache_stats after;
+  // Whether the overdraw pass was kept, it is skipped if it costs too much
+  // cache efficiency
+  bool overdraw_applied;
+  double elapsed_ms;
+} mesh_optimize_stats;
+
+/**
+ * @brief Simulates a FIFO post-transform cache over an index buffer.
+ */
+vertex_cache_stats mesh_optimizer_analyze_vertex_cache(
+    const uint32_t* indices, uint32_t index_count, uint32_t vertex_count,
+    uint32_t cache_size);
+
+/**
+ * @brief Reorders triangles for post-transform cache locality (Tipsify).
+ * @param indices The triangle list to reorder, in place
+ * @param vertex_count The number of vertices the indices reference
+ * @param cache_size The cache size to optimize for
+ */
+void mesh_optimizer_optimize_vertex_cache(std::vector<uint32_t>* indices,
+                                          uint32_t vertex_count,
+                                          uint32_t cache_size);
+
+/**
+ * @brief Reorders clusters of a cache optimized triangle list so outward
+ * facing triangles far from the center are drawn first and occlude the rest.
+ * Clusters are cut where the cache is cold anyway. The order is kept if the
+ * result's ACMR is more than threshold times worse.
+ * @returns true if the triangles were reordered
+ */
+bool mesh_optimizer_optimize_overdraw(std::vector<uint32_t>* indices,
+                                      const std::vector<Vertex>& vertices,
+                                      uint32_t cache_size, float threshold);
+
+/**
+ * @brief Reorders vertices into the order the indices first use them, and
+ * drops vertices that are never used. Indices are rewritten to match.
+ */
+void mesh_optimizer_optimize_vertex_fetch(std::vector<Vertex>* vertices,
+                                          std::vector<uint32_t>* indices);
+
+/**
+ * @brief Runs the vertex cache, overdraw and vertex fetch passes in order.
+ * @param out_stats Optional cache stats before and after
+ */
+void mesh_optimizer_optimize(std::vector<Vertex>* vertices,
+                             std::vector<uint32_t>* indices,
+                             mesh_optimize_stats* out_stats);
+
+#endif
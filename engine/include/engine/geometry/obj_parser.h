@@ -0,0 +1,47 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Zero based attribute indices of one face corner, -1 when absent
+typedef struct obj_index {
+  int vertex_index;
+  int texcoord_index;
+  int normal_index;
+} obj_index;
+
+/**
+ * Raw attributes of an .obj file. indices holds every face triangulated, three
+ * corners per triangle, in file order. This is the same data (and order) the
+ * renderer used to get from flattening tinyobj's shapes.
+ */
+typedef struct obj_data {
+  std::vector<float> positions;  // xyz
+  std::vector<float> texcoords;  // uv
+  std::vector<float> normals;    // xyz
+  std::vector<obj_index> indices;
+} obj_data;
+
+typedef enum obj_parse_result {
+  OBJ_PARSE_SUCCESS = 0,
+  // Valid .obj, but uses something this parser doesn't handle (polygons with
+  // more than 4 corners). The caller should fall back to tinyobj.
+  OBJ_PARSE_UNSUPPORTED = 1,
+  OBJ_PARSE_ERROR = 2
+} obj_parse_result;
+
+/**
+ * @brief Parses the v/vt/vn/f records of an .obj file held in memory, split
+ * into line aligned chunks parsed on thread_count threads. Output is bit
+ * identical to tinyobj for triangle and quad meshes.
+ * @param data The file contents. Does not need to be null terminated
+ * @param size Size of data in bytes
+ * @param thread_count Threads to use, 0 for one per hardware thread
+ * @param out_data The parsed attributes and triangulated indices
+ */
+obj_parse_result obj_parser_parse(const char* data, size_t size,
+                                  uint32_t thread_count, obj_data* out_data);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <cstdint>
+#include <vector>
+
+#include "engine/renderer_types.inl"
+
+// Maps packed positions, which are in [-1, 1], back to mesh space:
+// position = offset + scale * packed
+typedef struct vertex_pack_decode {
+  glm::vec3 offset;
+  glm::vec3 scale;
+} vertex_pack_decode;
+
+/**
+ * @brief Converts a mesh to the PackedVertex layout. Vertex has no normals, so
+ * smooth normals are generated from the triangles.
+ * @param geometry The mesh to pack. Its bounds must be set
+ * @param out_vertices The packed vertices, one per mesh vertex
+ * @param out_decode The transform to apply to the packed positions
+ */
+void vertex_packing_pack(const mesh_geometry* geometry,
+                         std::vector<PackedVertex>* out_vertices,
+                         vertex_pack_decode* out_decode);
+
+/**
+ * @brief Expands a packed vertex back to fp32. The normal is not part of
+ * Vertex and is returned separately if out_normal is set.
+ */
+Vertex vertex_packing_unpack(const PackedVertex* vertex,
+                             const vertex_pack_decode* decode,
+                             glm::vec3* out_normal);
+
+/**
+ * @brief Converts a float to IEEE half precision, rounding to nearest even
+ */
+uint16_t vertex_packing_float_to_half(float value);
+
+float vertex_packing_half_to_float(uint16_t value);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "engine/renderer_types.inl"
+
+typedef struct vertex_weld_config {
+  // 0 welds bit identical vertices only. Otherwise every component is snapped
+  // to a grid of this size and vertices landing in the same cell are welded.
+  float epsilon;
+  // Threads (and table shards) to use, 0 for one per hardware thread
+  uint32_t thread_count;
+} vertex_weld_config;
+
+typedef struct vertex_weld_stats {
+  uint32_t input_vertex_count;
+  uint32_t output_vertex_count;
+  uint32_t thread_count;
+  double elapsed_ms;
+} vertex_weld_stats;
+
+/**
+ * @brief Merges duplicate vertices using flat, pre-sized open addressing hash
+ * tables. Output vertices are in order of first occurrence, so the result is
+ * the same for any thread count.
+ * @param vertices The vertices to weld
+ * @param vertex_count The number of vertices
+ * @param config Welding options, may be null for exact single pass defaults
+ * @param out_vertices The unique vertices
+ * @param out_remap For every input vertex, its index in out_vertices. Passing
+ * an unindexed triangle stream makes this the index buffer.
+ * @param out_stats Optional vertex counts and timing
+ */
+void vertex_welder_weld(const Vertex* vertices, uint32_t vertex_count,
+                        const vertex_weld_config* config,
+                        std::vector<Vertex>* out_vertices,
+                        std::vector<uint32_t>* out_remap,
+                        vertex_weld_stats* out_stats);
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef TLSF_H
+#define TLSF_H
+
+#include <cstdint>
+#include <vector>
+
+// Bins per power of two. Sizes below TLSF_SMALL_SIZE all share the first
+// level, in 8 byte steps.
+#define TLSF_SL_LOG2 5
+#define TLSF_SL_COUNT (1u << TLSF_SL_LOG2)
+#define TLSF_SMALL_SIZE (TLSF_SL_COUNT * 8ull)
+#define TLSF_FL_COUNT 57
+#define TLSF_INVALID_NODE 0xFFFFFFFFu
+
+// A contiguous range of the managed space, free or allocated
+typedef struct tlsf_node {
+  uint64_t offset;
+  uint64_t size;
+  // Neighbours by address, to merge free ranges back together
+  uint32_t prev_physical;
+  uint32_t next_physical;
+  // Neighbours in the free list of the node's size class
+  uint32_t prev_free;
+  uint32_t next_free;
+  bool is_free;
+} tlsf_node;
+
+/**
+ * Two level segregated fit allocator over an abstract range of offsets. It
+ * never touches the memory it manages, so it can suballocate GPU memory.
+ * Allocation and free are O(1): free ranges are binned by a power of two
+ * (first level) and TLSF_SL_COUNT linear steps within it (second level), with
+ * a bitmap per level to find the smallest non-empty bin.
+ */
+typedef struct tlsf_allocator {
+  uint64_t size;
+  uint64_t free_size;
+  uint32_t allocation_count;
+  uint64_t fl_bitmap;
+  uint32_t sl_bitmap[TLSF_FL_COUNT];
+  uint32_t free_heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+  std::vector<tlsf_node> nodes;
+  // Slots in nodes that can be reused
+  std::vector<uint32_t> unused_nodes;
+} tlsf_allocator;
+
+/**
+ * @brief Starts managing the range [0, size) as one free range
+ */
+void tlsf_create(uint64_t size, tlsf_allocator *out_allocator);
+
+/**
+ * @brief Allocates a range
+ * @param alignment A power of two
+ * @param out_node Identifies the allocation for tlsf_free
+ * @param out_offset The start of the range, a multiple of alignment
+ * @returns false if no free range is large enough
+ */
+bool tlsf_allocate(tlsf_allocator *allocator, uint64_t size,
+                   uint64_t alignment, uint32_t *out_node,
+                   uint64_t *out_offset);
+
+/**
+ * @brief Frees an allocation, merging it with free neighbours
+ */
+void tlsf_free(tlsf_allocator *allocator, uint32_t node);
+
+/**
+ * @brief Gets the size of the largest free range
+ */
+uint64_t tlsf_largest_free(const tlsf_allocator *allocator);
+
+#endif
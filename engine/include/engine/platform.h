@@ -22,4 +22,10 @@ void platform_shutdown();
 
 std::vector<char> platform_read_file(const std::string& filename);
 
+/**
+ * @brief Gets a monotonic timestamp, used for timing and benchmarking
+ * @returns time in seconds since an arbitrary fixed point
+ */
+double platform_get_absolute_time();
+
 #endif
@@ -2,6 +2,7 @@
 #define RENDERER_H
 
 #include "engine/platform.h"
+#include "engine/renderer_types.inl"
 
 bool renderer_initialize(platform_state* plat_state);
 
@@ -11,6 +12,21 @@ bool renderer_initialize(platform_state* plat_state);
 void load_object();
 
 void draw_frame();
+
+/**
+ * @brief Picks the present mode and swapchain image count, takes effect from
+ * the next frame
+ */
+void renderer_set_present_config(const renderer_present_config* config);
+
+/**
+ * @brief Sets the depth of the frame ring, takes effect from the next frame
+ */
+void renderer_set_frames_in_flight(uint32_t count);
+
+void renderer_begin_frame_stats();
+void renderer_end_frame_stats(renderer_frame_stats* out_stats);
+
 void renderer_shutdown();
 
 #endif
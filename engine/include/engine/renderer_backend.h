@@ -17,7 +17,38 @@ void renderer_backend_load_geometry();
 vk::Format find_depth_format();
 
 void renderer_backend_draw_frame();
-void renderer_backend_draw_image(uint32_t image_index);
+/**
+ * @brief Records the frame's commands
+ * @param uniform_offset Dynamic offset of the frame's uniforms in its arena
+ */
+void renderer_backend_draw_image(uint32_t image_index,
+                                 uint32_t uniform_offset);
+
+/**
+ * @brief Sets the present mode and swapchain image count. Can be called
+ * before initializing, or at any point after, in which case the swapchain is
+ * recreated before the next frame.
+ */
+void renderer_backend_set_present_config(const renderer_present_config* config);
+
+/**
+ * @brief Sets how many frames the CPU may record ahead of the GPU, clamped
+ * to 1 - RENDERER_MAX_FRAMES_IN_FLIGHT. Can be called before initializing,
+ * or between frames, in which case per frame resources are created for any
+ * new slots.
+ */
+void renderer_backend_set_frames_in_flight(uint32_t count);
+
+/**
+ * @brief Starts timing frames, replacing any previous run
+ */
+void renderer_backend_begin_frame_stats();
+
+/**
+ * @brief Stops timing frames, after waiting for the timed frames the GPU
+ * hasn't finished
+ */
+void renderer_backend_end_frame_stats(renderer_frame_stats* out_stats);
 
 void renderer_backend_shutdown();
 
@@ -5,6 +5,7 @@
 
 #include <array>
 #include <glm/glm.hpp>
+#include <unordered_map>
 #include <vector>
 
 #define GLM_ENABLE_EXPERIMENTAL
@@ -17,12 +18,23 @@
 
 // Renderer 'primitives'
 
+// Per frame, shared by every draw
 typedef struct UniformBufferObject {
-  glm::mat4 model;
   glm::mat4 view;
   glm::mat4 proj;
 } ubo;
 
+// Per draw data, pushed with the draw rather than written to a buffer. Must
+// match the push_constant block in the shaders, and stay within the 128 bytes
+// every device supports.
+typedef struct object_push_constants {
+  glm::mat4 model;
+  uint32_t material_index;
+  // Slots in the bindless tables, see vulkan_bindless.h
+  uint32_t texture_index;
+  uint32_t sampler_index;
+} object_push_constants;
+
 // TODO: Just doing this for convenience for now. Vertex shouldn't be color
 // data
 typedef struct Vertex {
@@ -56,7 +68,7 @@ typedef struct Vertex {
     vk::VertexInputAttributeDescription color_desc = {
         .location = 1,
         .binding = 0,
-        .format = vk::Format::eR32G32Sfloat,
+        .format = vk::Format::eR32G32B32Sfloat,
         .offset = offsetof(Vertex, color)};
 
     vk::VertexInputAttributeDescription tex_desc = {
@@ -84,6 +96,83 @@ struct hash<Vertex> {
   };
 };
 }  // namespace std
+
+// Opt-in compact vertex layout, 20 bytes instead of 32. Positions are
+// quantized to the mesh bounds, and the transform back to mesh space is folded
+// into the model matrix (see vertex_packing_pack). Decoded by packed.vert.
+typedef struct PackedVertex {
+  // snorm16, relative to the bounds center and scaled by the half extent. w is
+  // padding
+  int16_t pos[4];
+  // Half floats
+  uint16_t tex_coord[2];
+  // Octahedral encoded unit normal, snorm16
+  int16_t normal[2];
+  // unorm8 RGBA
+  uint8_t color[4];
+
+  static std::array<vk::VertexInputBindingDescription, 1>
+  get_binding_description() {
+    vk::VertexInputBindingDescription binding_desc{
+        .binding = 0,
+        .stride = sizeof(PackedVertex),
+        .inputRate = vk::VertexInputRate::eVertex,
+    };
+    std::array<vk::VertexInputBindingDescription, 1> binding = {{binding_desc}};
+    return binding;
+  };
+  static std::array<vk::VertexInputAttributeDescription, 4>
+  get_attribute_descriptions() {
+    vk::VertexInputAttributeDescription vert_desc = {
+        .location = 0,
+        .binding = 0,
+        .format = vk::Format::eR16G16B16A16Snorm,
+        .offset = offsetof(PackedVertex, pos)};
+
+    vk::VertexInputAttributeDescription color_desc = {
+        .location = 1,
+        .binding = 0,
+        .format = vk::Format::eR8G8B8A8Unorm,
+        .offset = offsetof(PackedVertex, color)};
+
+    vk::VertexInputAttributeDescription tex_desc = {
+        .location = 2,
+        .binding = 0,
+        .format = vk::Format::eR16G16Sfloat,
+        .offset = offsetof(PackedVertex, tex_coord)};
+
+    vk::VertexInputAttributeDescription normal_desc = {
+        .location = 3,
+        .binding = 0,
+        .format = vk::Format::eR16G16Snorm,
+        .offset = offsetof(PackedVertex, normal)};
+
+    std::array<vk::VertexInputAttributeDescription, 4> attribute_descriptions{
+        vert_desc, color_desc, tex_desc, normal_desc};
+    return attribute_descriptions;
+  }
+} PackedVertex;
+
+typedef enum vertex_format {
+  // Vertex, fp32 everything
+  VERTEX_FORMAT_FULL = 0,
+  // PackedVertex
+  VERTEX_FORMAT_PACKED = 1
+} vertex_format;
+
+// CPU side view of a mesh that is ready for upload. Does not own its storage,
+// which lives either in the loader's vectors or in a mapped mesh cache file.
+typedef struct mesh_geometry {
+  const Vertex* vertices;
+  uint32_t vertex_count;
+  // uint16_t or uint32_t indices, depending on index_stride
+  const void* indices;
+  uint32_t index_count;
+  uint32_t index_stride;
+  glm::vec3 bounds_min;
+  glm::vec3 bounds_max;
+} mesh_geometry;
+
 // TODO: REMOVE THIS. WE JUST WANT TO DRAW SOME GEOMETRY FOR NOW. /MAYBE/ we'll
 // keep it for texture coords interleaved but big if
 /**= {
@@ -102,20 +191,48 @@ struct hash<Vertex> {
 // TODO: Move these all to a 'vulkan types'. We should
 // abstract more so we can
 // support other APIs potentially
-#define MAX_FRAMES_IN_FLIGHT 2
+// Frames the CPU may record ahead of the GPU. More hides CPU spikes, fewer
+// cut latency. Set at runtime, see renderer_backend_set_frames_in_flight.
+#define RENDERER_DEFAULT_FRAMES_IN_FLIGHT 2
+#define RENDERER_MAX_FRAMES_IN_FLIGHT 3
+
+// What device memory is used for, for budget accounting
+typedef enum vulkan_memory_category {
+  VULKAN_MEMORY_MESH = 0,
+  VULKAN_MEMORY_TEXTURE = 1,
+  VULKAN_MEMORY_RENDER_TARGET = 2,
+  VULKAN_MEMORY_STAGING = 3,
+  VULKAN_MEMORY_UNIFORM = 4,
+  VULKAN_MEMORY_CATEGORY_COUNT
+} vulkan_memory_category;
+
+// A range of device memory from vulkan_allocator, either suballocated from a
+// shared block or a dedicated allocation of its own
+typedef struct vulkan_allocation {
+  vk::DeviceMemory memory;
+  vk::DeviceSize offset;
+  vk::DeviceSize size;
+  // Address of offset in the persistent mapping, null unless host visible
+  void* mapped;
+  // Owning block and its range, block is null for dedicated allocations
+  struct vulkan_memory_block* block;
+  uint32_t node;
+  uint32_t memory_type;
+  vulkan_memory_category category;
+} vulkan_allocation;
 
 typedef struct vulkan_image {
   vk::Image handle;
-  vk::DeviceMemory memory;
+  vulkan_allocation allocation;
   vk::ImageView view;
+  uint32_t mip_levels;
 } vulkan_image;
 
 typedef struct vulkan_swapchain_support_info {
   vk::SurfaceCapabilitiesKHR capabilities;
   uint32_t format_count;
   std::vector<vk::SurfaceFormatKHR> formats;
-  uint32_t present_mode_count;
-  vk::PresentModeKHR* present_modes;
+  std::vector<vk::PresentModeKHR> present_modes;
 } vulkan_swapchain_support_info;
 
 typedef struct vulkan_device {
@@ -135,6 +252,10 @@ typedef struct vulkan_device {
   VkPhysicalDeviceProperties properties;
   VkPhysicalDeviceFeatures features;
   VkPhysicalDeviceMemoryProperties memory;
+  // Has the Vulkan 1.2 descriptor indexing features bindless textures need
+  bool descriptor_indexing;
+  // VK_EXT_memory_budget is enabled, the driver reports heap budgets
+  bool memory_budget;
 
   VkFormat depth_format;
 } vulkan_device;
@@ -143,6 +264,43 @@ typedef struct vulkan_renderpass {
   vk::RenderPass handle;
 } vulkan_renderpass;
 
+// How finished frames reach the screen, trading latency against power and
+// tearing
+typedef enum renderer_present_mode {
+  // Waits for vblank, never tears, a full queue blocks the CPU
+  RENDERER_PRESENT_FIFO = 0,
+  // Waits for vblank, newer frames replace queued ones
+  RENDERER_PRESENT_MAILBOX,
+  // Presents right away and tears
+  RENDERER_PRESENT_IMMEDIATE,
+  // Like FIFO, but a late frame presents right away and tears
+  RENDERER_PRESENT_FIFO_RELAXED,
+  RENDERER_PRESENT_MODE_COUNT
+} renderer_present_mode;
+
+typedef struct renderer_present_config {
+  // Falls back to FIFO when the surface doesn't support it
+  renderer_present_mode mode;
+  // Swapchain images to request, 0 picks one over the surface's minimum
+  uint32_t image_count;
+} renderer_present_config;
+
+// Frame timings gathered between renderer_backend_begin_frame_stats and
+// renderer_backend_end_frame_stats
+typedef struct renderer_frame_stats {
+  uint32_t frames_in_flight;
+  uint32_t frame_count;
+  double seconds;
+  double frames_per_second;
+  // Seconds from the start of a frame, right after input is polled, to the
+  // GPU finishing it. Completion is seen at a later frame's start at the
+  // latest, so these are upper bounds.
+  double latency_average;
+  double latency_p50;
+  double latency_p99;
+  double latency_max;
+} renderer_frame_stats;
+
 typedef struct vulkan_swapchain {
   vk::Format image_format;
   vk::SwapchainKHR handle;
@@ -151,6 +309,12 @@ typedef struct vulkan_swapchain {
   std::vector<vk::Image> images;
   std::vector<vk::ImageView> views;  // images not accessed directly in Vulkan
   std::vector<vk::Framebuffer> framebuffers;
+  vk::PresentModeKHR present_mode;
+  // Recreated before the next acquire. Set on resize, since some platforms
+  // never report out of date, and on suboptimal or out of date results.
+  bool out_of_date;
+  uint32_t recreate_count;
+  double recreate_seconds;
 } vulkan_swapchain;
 
 typedef struct vulkan_pipeline {
@@ -169,9 +333,212 @@ typedef struct vulkan_shader_stage {
 
 typedef struct vulkan_buffer {
   vk::Buffer handle;
-  vk::DeviceMemory memory;
+  vulkan_allocation allocation;
 } vulkan_buffer;
 
+// A timeline semaphore and the values handed out on it, see
+// vulkan_timeline.h
+typedef struct vulkan_timeline {
+  vk::Semaphore semaphore;
+  const char* name;
+  // Last value handed to a submission
+  uint64_t submitted;
+  // Highest value known to have been signaled
+  uint64_t completed;
+
+  // CPU time spent in sync calls
+  double wait_seconds;
+  double query_seconds;
+  uint32_t wait_count;
+  uint32_t query_count;
+} vulkan_timeline;
+
+// Part of the staging ring the GPU may still be reading from
+typedef struct vulkan_staging_span {
+  // The GPU is done with the span once timeline reaches value, timeline is
+  // null if it already is
+  vulkan_timeline* timeline;
+  uint64_t value;
+  uint64_t end;
+} vulkan_staging_span;
+
+// Persistently mapped host buffer that every upload is written into, see
+// vulkan_staging.h
+typedef struct vulkan_staging_ring {
+  vulkan_buffer buffer;
+  char* mapped;
+  vk::DeviceSize size;
+  // Byte positions that only ever grow, the offset in the buffer is
+  // position % size
+  uint64_t write_position;
+  uint64_t read_position;
+  // Writes before this have been handed to vulkan_staging_retire
+  uint64_t retired_position;
+  // Oldest first
+  std::vector<vulkan_staging_span> in_flight;
+
+  // For throughput reporting
+  uint64_t bytes_uploaded;
+  double upload_seconds;
+  uint32_t split_upload_count;
+} vulkan_staging_ring;
+
+// Copies and layout transitions recorded on the transfer queue and handed to
+// the graphics queue together, see vulkan_upload.h
+typedef struct vulkan_upload_batch {
+  // On the transfer queue's family
+  vk::CommandPool transfer_pool;
+  vk::CommandBuffer transfer_commands;
+  // Ownership acquires and graphics only commands, from the graphics pool
+  vk::CommandBuffer graphics_commands;
+  // Values each half signals on the transfer and graphics timelines when it
+  // completes. The graphics half waits for transfer_value.
+  uint64_t transfer_value;
+  uint64_t graphics_value;
+  // Staging space written for the batch is retired with transfer_value
+  vulkan_staging_ring* staging;
+
+  bool transfer_recording;
+  bool graphics_recording;
+  // Transfer half submitted, but not yet handed to the graphics queue
+  bool transfer_pending;
+  // Graphics half submitted, and maybe still running
+  bool graphics_pending;
+  // Acquires matching the releases in the transfer half
+  std::vector<vk::ImageMemoryBarrier> image_acquires;
+  std::vector<vk::BufferMemoryBarrier> buffer_acquires;
+  vk::PipelineStageFlags acquire_stages;
+  // Commands recorded since the last submission
+  uint32_t command_count;
+
+  uint32_t total_commands;
+  // Queue submissions, both halves
+  uint32_t submit_count;
+} vulkan_upload_batch;
+
+// Persistently mapped buffer that per frame uniform and storage data is
+// bump allocated from, see vulkan_frame_arena.h
+typedef struct vulkan_frame_arena {
+  vulkan_buffer buffer;
+  char* mapped;
+  vk::DeviceSize size;
+  // Every allocation starts at a multiple of this, so its offset can be
+  // used as a dynamic offset
+  vk::DeviceSize alignment;
+  vk::DeviceSize offset;
+  // Most used in one frame, for sizing
+  vk::DeviceSize high_water;
+} vulkan_frame_arena;
+
+// How many descriptors of a type a pool holds per set it holds
+typedef struct vulkan_descriptor_pool_ratio {
+  vk::DescriptorType type;
+  float per_set;
+} vulkan_descriptor_pool_ratio;
+
+// Hands out descriptor sets from a chain of pools, adding a pool whenever
+// the current ones run out, see vulkan_descriptor.h
+typedef struct vulkan_descriptor_allocator {
+  std::vector<vulkan_descriptor_pool_ratio> ratios;
+  // Pools that may have room, the last one is allocated from
+  std::vector<vk::DescriptorPool> ready_pools;
+  // Pools that ran out since the last reset
+  std::vector<vk::DescriptorPool> full_pools;
+  // Sets the next pool is created for, doubles with each pool
+  uint32_t sets_per_pool;
+  // Since the last reset
+  uint32_t allocated_sets;
+} vulkan_descriptor_allocator;
+
+// One descriptor of a cached set. buffer is used by buffer descriptor types,
+// image by the rest.
+typedef struct vulkan_descriptor_binding {
+  uint32_t binding;
+  vk::DescriptorType type;
+  vk::DescriptorBufferInfo buffer;
+  vk::DescriptorImageInfo image;
+} vulkan_descriptor_binding;
+
+typedef struct vulkan_descriptor_cache_entry {
+  vk::DescriptorSetLayout layout;
+  std::vector<vulkan_descriptor_binding> bindings;
+  vk::DescriptorSet set;
+} vulkan_descriptor_cache_entry;
+
+// Sets that are never written after creation, shared by everything that asks
+// for the same layout and bindings
+typedef struct vulkan_descriptor_cache {
+  vulkan_descriptor_allocator allocator;
+  // Keyed by a hash of the layout and bindings
+  std::unordered_map<uint64_t, vulkan_descriptor_cache_entry> sets;
+  uint32_t hits;
+  uint32_t misses;
+} vulkan_descriptor_cache;
+
+// Frees some or all of a resource's memory to get back under budget
+// @param wanted Bytes the residency list would like freed
+// @returns Bytes actually freed, the whole size if the resource was unloaded
+typedef vk::DeviceSize (*vulkan_evict_callback)(vk::DeviceSize wanted,
+                                                void* user_data);
+
+// A resource that may be evicted, see vulkan_memory_budget.h
+typedef struct vulkan_resident {
+  vulkan_memory_category category;
+  vk::DeviceSize size;
+  // vulkan_residency::frame when last drawn with
+  uint64_t last_used;
+  vulkan_evict_callback evict;
+  void* user_data;
+  bool registered;
+} vulkan_resident;
+
+// Device local heap usage against the budget, over every device local heap
+typedef struct vulkan_memory_budget {
+  vk::DeviceSize budget;
+  vk::DeviceSize usage;
+  // Whether the numbers came from VK_EXT_memory_budget or are estimates
+  bool from_driver;
+} vulkan_memory_budget;
+
+typedef struct vulkan_residency {
+  std::vector<vulkan_resident> entries;
+  std::vector<uint32_t> free_entries;
+  // Counts renderer frames, for least recently used order
+  uint64_t frame;
+  vulkan_memory_budget last_budget;
+  // Over budget with nothing left to evict, logged once per episode
+  bool over_budget;
+  uint32_t eviction_count;
+  vk::DeviceSize evicted_bytes;
+} vulkan_residency;
+
+typedef enum vulkan_deletion_kind {
+  VULKAN_DELETION_BUFFER = 0,
+  VULKAN_DELETION_IMAGE,
+  VULKAN_DELETION_IMAGE_VIEW,
+  VULKAN_DELETION_SAMPLER,
+  VULKAN_DELETION_PIPELINE,
+  VULKAN_DELETION_PIPELINE_LAYOUT,
+  VULKAN_DELETION_FRAMEBUFFER,
+  VULKAN_DELETION_SWAPCHAIN
+} vulkan_deletion_kind;
+
+// A destroy call waiting for the GPU to be done with the object
+typedef struct vulkan_deletion {
+  vulkan_deletion_kind kind;
+  // The Vulkan handle, as its C type
+  uint64_t handle;
+  // Returned to the allocator for buffers and images
+  vulkan_allocation allocation;
+} vulkan_deletion;
+
+// Destroy calls per frame in flight, run once the frame has completed,
+// see vulkan_deletion_queue.h
+typedef struct vulkan_deletion_queue {
+  std::vector<std::vector<vulkan_deletion>> frames;
+  uint64_t total_deletions;
+} vulkan_deletion_queue;
+
 typedef struct vulkan_object_shader {
   // vertex, fragment
   vulkan_shader_stage stages[OBJECT_SHADER_STAGE_COUNT];
@@ -181,11 +548,32 @@ typedef struct vulkan_object_shader {
 typedef struct vulkan_texture {
   vulkan_image image;
   vk::Sampler sampler;
+  // Slots in the bindless tables, if registered
+  uint32_t bindless_index;
+  uint32_t sampler_index;
+  // Entry in the residency list, see vulkan_memory_budget.h
+  uint32_t residency_id;
 } vulkan_texture;
 
+// One update after bind descriptor set holding every sampled image and
+// sampler, indexed by shaders, see vulkan_bindless.h
+typedef struct vulkan_bindless_table {
+  vk::DescriptorSetLayout layout;
+  vk::DescriptorPool pool;
+  vk::DescriptorSet set;
+  uint32_t texture_capacity;
+  uint32_t sampler_capacity;
+  // Slots below this have been handed out at some point
+  uint32_t texture_count;
+  std::vector<uint32_t> free_textures;
+  std::vector<vk::Sampler> samplers;
+} vulkan_bindless_table;
+
 typedef struct backend_context {
   vk::UniqueInstance instance;
   vulkan_device device;
+  // Device memory for every buffer and image, see vulkan_allocator.h
+  struct vulkan_allocator* allocator;
   GLFWwindow* window;
   vk::SurfaceKHR surface;
   vulkan_pipeline pipeline;
@@ -193,22 +581,54 @@ typedef struct backend_context {
   vk::CommandPool command_pool;
   std::vector<vk::CommandBuffer> command_buffer;
   vulkan_image depth_image;
+  vulkan_staging_ring staging;
+  // Where copies and transitions are recorded until the next submit
+  vulkan_upload_batch upload;
   vulkan_buffer vert_buff;
   vulkan_buffer index_buff;
+  // Width of the indices in index_buff, per mesh
+  vk::IndexType index_type;
+  // Layout of vert_buff, picks the pipeline's vertex input and shader
+  vertex_format mesh_vertex_format;
+  // Maps the vertex buffer's positions to mesh space, identity unless packed
+  glm::mat4 mesh_decode_transform;
 #ifndef NDEBUG
   vk::DebugUtilsMessengerEXT debug_messenger;
 #endif
   vulkan_swapchain swapchain;
+  // Applied when the swapchain is next created
+  renderer_present_config present_config;
   std::vector<vk::Semaphore> image_available_semaphore;
   std::vector<vk::Semaphore> render_finished_semaphore;
-  std::vector<vk::Fence> in_flight_fence;
+  // Frames and the graphics half of uploads signal graphics_timeline, the
+  // transfer half of uploads signals transfer_timeline
+  vulkan_timeline graphics_timeline;
+  vulkan_timeline transfer_timeline;
+  // graphics_timeline value each frame in flight signals when done
+  std::vector<uint64_t> frame_values;
+  // Depth of the frame ring. Per frame resources exist for at least this
+  // many slots, more if it was deeper before.
+  uint32_t frames_in_flight;
   uint32_t current_frame;
   vulkan_object_shader object_shader;
-  vk::DescriptorPool descriptor_pool;
+  // Transient sets, one allocator per frame in flight, reset once the
+  // frame has completed
+  std::vector<vulkan_descriptor_allocator> frame_descriptors;
+  // Sets that live until shutdown
+  vulkan_descriptor_cache descriptor_cache;
   std::vector<vk::DescriptorSet> descriptor_sets;
-  std::vector<vulkan_buffer> uniform_buffers;
-  std::vector<void*> uniform_buffer_memory;
+  // One per frame in flight, reset once the frame has completed
+  std::vector<vulkan_frame_arena> frame_arenas;
   vulkan_texture default_texture;
+  // Only created when the device has descriptor indexing
+  vulkan_bindless_table bindless;
+  // Resources that are evicted least recently used first when device memory
+  // is over budget
+  vulkan_residency residency;
+  // Residency entry of vert_buff and index_buff
+  uint32_t mesh_residency;
+  // Objects destroyed while frames may still be using them
+  vulkan_deletion_queue deletion_queue;
 } backend_context;
 
 #define VK_CHECK(expr)                         \
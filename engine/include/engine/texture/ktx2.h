@@ -0,0 +1,109 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "engine/filesystem.h"
+
+// «KTX 20»\r\n\x1A\n
+#define KTX2_IDENTIFIER \
+  {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A}
+#define KTX2_IDENTIFIER_SIZE 12
+
+// The VkFormat values the cooker writes
+#define KTX2_VK_FORMAT_R8G8B8A8_UNORM 37
+#define KTX2_VK_FORMAT_R8G8B8A8_SRGB 43
+#define KTX2_VK_FORMAT_BC1_RGB_UNORM 131
+#define KTX2_VK_FORMAT_BC1_RGB_SRGB 132
+#define KTX2_VK_FORMAT_BC3_UNORM 137
+#define KTX2_VK_FORMAT_BC3_SRGB 138
+#define KTX2_VK_FORMAT_BC7_UNORM 145
+#define KTX2_VK_FORMAT_BC7_SRGB 146
+
+/**
+ * File header, directly after the identifier. The level index follows it,
+ * then the data format descriptor and the level data. The 64 bit fields are
+ * only 4 byte aligned in the file.
+ */
+#pragma pack(push, 4)
+typedef struct ktx2_header {
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+
+  uint32_t dfd_byte_offset;
+  uint32_t dfd_byte_length;
+  uint32_t kvd_byte_offset;
+  uint32_t kvd_byte_length;
+  uint64_t sgd_byte_offset;
+  uint64_t sgd_byte_length;
+} ktx2_header;
+#pragma pack(pop)
+static_assert(sizeof(ktx2_header) == 68, "ktx2_header must match the file");
+
+typedef struct ktx2_level_index {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+} ktx2_level_index;
+
+typedef struct ktx2_level {
+  uint32_t width;
+  uint32_t height;
+  // Into the mapping, ready to be copied to a staging buffer as is
+  const void* data;
+  size_t size;
+} ktx2_level;
+
+// A KTX2 file, memory mapped by ktx2_load
+typedef struct ktx2_texture {
+  file_mapping mapping;
+  uint32_t vk_format;
+  uint32_t width;
+  uint32_t height;
+  std::vector<ktx2_level> levels;
+} ktx2_texture;
+
+/**
+ * @brief Maps a KTX2 file. Only what the cooker writes is supported: a single
+ * 2D image with any number of mip levels and no supercompression.
+ * @param path The path of the .ktx2 file
+ * @param out_texture The mapped texture, its levels point into the mapping
+ * @returns true on success
+ */
+bool ktx2_load(const char* path, ktx2_texture* out_texture);
+
+/**
+ * @brief Parses a KTX2 file already in memory, for instance read with
+ * filesystem_read_async. Accepts the same files as ktx2_load.
+ * @param data The file contents, which must outlive the texture's levels
+ * @param name Used in error messages
+ * @param out_texture The parsed texture, its levels point into data
+ * @returns true on success
+ */
+bool ktx2_load_memory(const void* data, size_t size, const char* name,
+                      ktx2_texture* out_texture);
+
+/**
+ * @brief Unmaps a texture loaded with ktx2_load, invalidating its levels
+ */
+void ktx2_close(ktx2_texture* texture);
+
+/**
+ * @brief Gets the size of one texel block of a format ktx2_load accepts, or 0
+ * if the format isn't one of them.
+ * @param vk_format The VkFormat
+ * @param out_block_dimension Optional width/height of a block in texels
+ */
+uint32_t ktx2_format_block_size(uint32_t vk_format,
+                                uint32_t* out_block_dimension);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Levels smaller than this many texels are downsampled on one thread
+#define MIPMAP_MIN_TEXELS_PER_THREAD (256 * 256)
+
+typedef struct mip_level {
+  uint32_t width;
+  uint32_t height;
+  // Byte offset of the level in mip_chain::pixels
+  size_t offset;
+  size_t size;
+} mip_level;
+
+// A full RGBA8 mip chain, every level packed back to back in one allocation
+// so it can be uploaded with a single staging copy
+typedef struct mip_chain {
+  std::vector<uint8_t> pixels;
+  std::vector<mip_level> levels;
+} mip_chain;
+
+/**
+ * @brief Gets the number of levels in a full mip chain, down to 1x1
+ */
+uint32_t mipmap_level_count(uint32_t width, uint32_t height);
+
+/**
+ * @brief Builds a full mip chain from RGBA8 pixels with a 2x2 box filter.
+ * @param pixels The base level, tightly packed RGBA8
+ * @param width The width of the base level
+ * @param height The height of the base level
+ * @param srgb Whether the color channels are sRGB encoded. They are then
+ * filtered in linear space, alpha is always linear
+ * @param thread_count Threads to downsample with, 0 for one per hardware
+ * thread
+ * @param out_chain The mip chain, level 0 being a copy of pixels
+ */
+void mipmap_generate(const uint8_t* pixels, uint32_t width, uint32_t height,
+                     bool srgb, uint32_t thread_count, mip_chain* out_chain);
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef VULKAN_ALLOCATOR_H
+#define VULKAN_ALLOCATOR_H
+
+#include "engine/renderer_types.inl"
+
+// Size of the blocks resources are suballocated from, smaller heaps use an
+// eighth of the heap instead
+#define VULKAN_ALLOCATOR_BLOCK_SIZE (64ull * 1024 * 1024)
+
+// Buffers and optimally tiled images can't share a bufferImageGranularity
+// page, so they're kept in separate blocks when the granularity matters
+typedef enum vulkan_resource_kind {
+  VULKAN_RESOURCE_BUFFER = 0,
+  VULKAN_RESOURCE_IMAGE = 1
+} vulkan_resource_kind;
+
+typedef struct vulkan_allocator_stats {
+  // Live vkDeviceMemory objects, blocks plus dedicated allocations
+  uint32_t device_allocation_count;
+  uint32_t block_count;
+  uint32_t dedicated_count;
+  // Live resources
+  uint32_t allocation_count;
+  // Calls over the allocator's lifetime
+  uint64_t total_allocations;
+  uint64_t total_frees;
+
+  vk::DeviceSize block_bytes;
+  vk::DeviceSize block_used_bytes;
+  vk::DeviceSize dedicated_bytes;
+  // Largest allocation that fits in an existing block without a new one
+  vk::DeviceSize largest_free_range;
+  // 1 - largest free range / free bytes in blocks, 0 when free space is one
+  // contiguous range
+  float fragmentation;
+
+  // Bytes of live resources, by what they're used for
+  vk::DeviceSize category_bytes[VULKAN_MEMORY_CATEGORY_COUNT];
+  // vkDeviceMemory bytes allocated from each heap, blocks and dedicated
+  vk::DeviceSize heap_bytes[VK_MAX_MEMORY_HEAPS];
+} vulkan_allocator_stats;
+
+/**
+ * @brief Creates the allocator. Needs the physical and logical device.
+ * @returns true on success
+ */
+bool vulkan_allocator_create(backend_context* context);
+
+/**
+ * @brief Frees every block. Anything still allocated is reported as leaked.
+ */
+void vulkan_allocator_destroy(backend_context* context);
+
+/**
+ * @brief Allocates memory for a resource. Host visible memory is persistently
+ * mapped, see vulkan_allocation::mapped.
+ * @param requirements From get*MemoryRequirements for the resource
+ * @param dedicated_image Set when the driver prefers the image to have a
+ * vkDeviceMemory of its own. Large resources get one regardless.
+ * @param category What the memory is for, counted against in the stats
+ * @returns false if the device is out of memory
+ */
+bool vulkan_allocator_allocate(backend_context* context,
+                               const vk::MemoryRequirements& requirements,
+                               vk::MemoryPropertyFlags properties,
+                               vulkan_resource_kind kind,
+                               vk::Image dedicated_image,
+                               vulkan_memory_category category,
+                               vulkan_allocation* out_allocation);
+
+/**
+ * @brief Returns memory to its block, or frees it if it was dedicated
+ */
+void vulkan_allocator_free(backend_context* context,
+                           vulkan_allocation* allocation);
+
+void vulkan_allocator_get_stats(backend_context* context,
+                                vulkan_allocator_stats* out_stats);
+
+void vulkan_allocator_log_stats(backend_context* context);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef VULKAN_BINDLESS_H
+#define VULKAN_BINDLESS_H
+
+#include "engine/renderer_types.inl"
+
+// Upper bounds, the device's update after bind limits may lower them
+#define VULKAN_BINDLESS_MAX_TEXTURES 4096
+#define VULKAN_BINDLESS_MAX_SAMPLERS 16
+
+// The set the table is bound to, after the per frame set
+#define VULKAN_BINDLESS_SET 1
+
+#define VULKAN_BINDLESS_INVALID_INDEX 0xFFFFFFFFu
+
+/**
+ * The bindless table is one descriptor set with an array of sampled images at
+ * binding 0 and a small array of samplers at binding 1. Textures register
+ * into a slot and shaders index the arrays with it, so drawing with any
+ * texture needs no descriptor set switch. The set is update after bind and
+ * partially bound: slots can be filled while it's bound, and unused slots
+ * may stay empty.
+ */
+
+/**
+ * @brief Creates the table's layout, pool and set. Needs
+ * device.descriptor_indexing.
+ */
+bool vulkan_bindless_create(backend_context* context,
+                            vulkan_bindless_table* out_table);
+
+void vulkan_bindless_destroy(backend_context* context,
+                             vulkan_bindless_table* table);
+
+/**
+ * @brief Puts an image view in a free slot
+ * @param layout The layout the image is in when shaders sample it
+ * @returns The slot, or VULKAN_BINDLESS_INVALID_INDEX if the table is full
+ */
+uint32_t vulkan_bindless_register_texture(backend_context* context,
+                                          vulkan_bindless_table* table,
+                                          vk::ImageView view,
+                                          vk::ImageLayout layout);
+
+/**
+ * @brief Frees a texture's slot for reuse. The GPU must be done with any draw
+ * that reads it.
+ */
+void vulkan_bindless_release_texture(vulkan_bindless_table* table,
+                                     uint32_t index);
+
+/**
+ * @brief Gets the slot of a sampler, adding it if it isn't in the table. The
+ * table doesn't own the sampler.
+ * @returns The slot, or VULKAN_BINDLESS_INVALID_INDEX if the table is full
+ */
+uint32_t vulkan_bindless_register_sampler(backend_context* context,
+                                          vulkan_bindless_table* table,
+                                          vk::Sampler sampler);
+
+#endif
@@ -5,12 +5,17 @@
 
 void vulkan_buffer_create(backend_context* context, vk::BufferUsageFlags usage,
                           vk::MemoryPropertyFlags properties,
-                          vk::DeviceSize size, vulkan_buffer* out_buffer);
+                          vk::DeviceSize size, vulkan_memory_category category,
+                          vulkan_buffer* out_buffer);
 
 void vulkan_buffer_destroy(backend_context* context, vulkan_buffer* buffer);
 
-void vulkan_buffer_copy(backend_context* context, vulkan_buffer* source,
-                        vulkan_buffer* target, vk::DeviceSize size);
+/**
+ * @brief Records copying the start of one buffer into another
+ */
+void vulkan_buffer_copy(backend_context* context, vulkan_upload_batch* batch,
+                        vulkan_buffer* source, vulkan_buffer* target,
+                        vk::DeviceSize size);
 
 void vulkan_buffer_load_data(backend_context* context, vulkan_buffer* buffer,
                              long offset, uint32_t flags, long size,
@@ -0,0 +1,78 @@
+#ifndef VULKAN_DELETION_QUEUE_H
+#define VULKAN_DELETION_QUEUE_H
+
+#include "engine/renderer_types.inl"
+
+/**
+ * The deletion queue lets resources be destroyed while the renderer is
+ * running, without waiting for the device to go idle. A destroy call is
+ * tagged with context->current_frame and only runs once graphics_timeline
+ * reaches that frame's value, by which point no submitted work can still
+ * reference the object.
+ */
+
+/**
+ * @param frame_count Frames in flight, one list of pending calls each
+ */
+void vulkan_deletion_queue_create(uint32_t frame_count,
+                                  vulkan_deletion_queue* out_queue);
+
+/**
+ * @brief Runs every pending destroy call. The device must be idle.
+ */
+void vulkan_deletion_queue_destroy(backend_context* context,
+                                   vulkan_deletion_queue* queue);
+
+/**
+ * @brief Runs the calls tagged with a frame. Call once the frame has
+ * completed, before recording the frame again.
+ */
+void vulkan_deletion_queue_flush(backend_context* context,
+                                 vulkan_deletion_queue* queue,
+                                 uint32_t frame);
+
+/**
+ * @brief Queues destroying a buffer and freeing its memory. *buffer is
+ * cleared, the handle must not be used again.
+ */
+void vulkan_deletion_queue_push_buffer(backend_context* context,
+                                       vulkan_deletion_queue* queue,
+                                       vulkan_buffer* buffer);
+
+/**
+ * @brief Queues destroying an image, its view and its memory. *image is
+ * cleared.
+ */
+void vulkan_deletion_queue_push_image(backend_context* context,
+                                      vulkan_deletion_queue* queue,
+                                      vulkan_image* image);
+
+void vulkan_deletion_queue_push_image_view(backend_context* context,
+                                           vulkan_deletion_queue* queue,
+                                           vk::ImageView view);
+
+void vulkan_deletion_queue_push_sampler(backend_context* context,
+                                        vulkan_deletion_queue* queue,
+                                        vk::Sampler sampler);
+
+void vulkan_deletion_queue_push_pipeline(backend_context* context,
+                                         vulkan_deletion_queue* queue,
+                                         vk::Pipeline pipeline);
+
+void vulkan_deletion_queue_push_pipeline_layout(backend_context* context,
+                                                vulkan_deletion_queue* queue,
+                                                vk::PipelineLayout layout);
+
+void vulkan_deletion_queue_push_framebuffer(backend_context* context,
+                                            vulkan_deletion_queue* queue,
+                                            vk::Framebuffer framebuffer);
+
+/**
+ * @brief Queues destroying a retired swapchain. Queue its views and
+ * framebuffers first.
+ */
+void vulkan_deletion_queue_push_swapchain(backend_context* context,
+                                          vulkan_deletion_queue* queue,
+                                          vk::SwapchainKHR swapchain);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef VULKAN_DESCRIPTOR_H
+#define VULKAN_DESCRIPTOR_H
+
+#include "engine/renderer_types.inl"
+
+// Sets the first pool of an allocator holds, later pools double up to the max
+#define VULKAN_DESCRIPTOR_SETS_PER_POOL 32
+#define VULKAN_DESCRIPTOR_MAX_SETS_PER_POOL 4096
+
+/**
+ * A descriptor allocator never fails for lack of pool space: when a pool runs
+ * out another, larger one is created. Sets aren't freed one by one, the
+ * allocator is reset as a whole, which makes every set it handed out invalid.
+ * Use one per frame in flight for transient sets, and a descriptor cache for
+ * sets that live on, ie. a material's.
+ */
+
+/**
+ * @brief Sets up an allocator, its first pool is created on first use
+ * @param ratios Descriptors of each type a pool holds per set
+ */
+void vulkan_descriptor_allocator_create(
+    const vulkan_descriptor_pool_ratio* ratios, uint32_t ratio_count,
+    vulkan_descriptor_allocator* out_allocator);
+
+void vulkan_descriptor_allocator_destroy(
+    backend_context* context, vulkan_descriptor_allocator* allocator);
+
+/**
+ * @brief Frees every set handed out. The GPU must be done with all of them.
+ */
+void vulkan_descriptor_allocator_reset(backend_context* context,
+                                       vulkan_descriptor_allocator* allocator);
+
+/**
+ * @brief Allocates a set, adding a pool if the current one is full
+ * @returns false if the device is out of memory, or the layout needs more
+ * descriptors than a pool holds
+ */
+bool vulkan_descriptor_allocator_allocate(
+    backend_context* context, vulkan_descriptor_allocator* allocator,
+    vk::DescriptorSetLayout layout, vk::DescriptorSet* out_set);
+
+void vulkan_descriptor_cache_create(const vulkan_descriptor_pool_ratio* ratios,
+                                    uint32_t ratio_count,
+                                    vulkan_descriptor_cache* out_cache);
+
+/**
+ * @brief Frees every cached set, logging how often the cache was hit
+ */
+void vulkan_descriptor_cache_destroy(backend_context* context,
+                                     vulkan_descriptor_cache* cache);
+
+/**
+ * @brief Gets the set with the given layout and bindings, allocating and
+ * writing it the first time it's asked for. Cached sets must not be written
+ * again, since anything else asking for the same bindings shares them.
+ * @returns The set, or a null handle if it couldn't be allocated
+ */
+vk::DescriptorSet vulkan_descriptor_cache_get(
+    backend_context* context, vulkan_descriptor_cache* cache,
+    vk::DescriptorSetLayout layout, const vulkan_descriptor_binding* bindings,
+    uint32_t binding_count);
+
+#endif
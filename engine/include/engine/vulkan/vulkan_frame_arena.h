@@ -0,0 +1,48 @@
+#ifndef VULKAN_FRAME_ARENA_H
+#define VULKAN_FRAME_ARENA_H
+
+#include "engine/renderer_types.inl"
+
+#define VULKAN_FRAME_ARENA_SIZE (4ull * 1024 * 1024)
+
+/**
+ * A frame arena hands out uniform and storage data front to back, and is
+ * reset as a whole once the GPU is done with the frame that used it. Each
+ * allocation is aligned for use as the dynamic offset of an
+ * eUniformBufferDynamic or eStorageBufferDynamic descriptor, so any number of
+ * objects can share one descriptor set.
+ */
+
+/**
+ * @brief Creates a host visible, persistently mapped arena
+ */
+void vulkan_frame_arena_create(backend_context* context, vk::DeviceSize size,
+                               vulkan_frame_arena* out_arena);
+
+void vulkan_frame_arena_destroy(backend_context* context,
+                                vulkan_frame_arena* arena);
+
+/**
+ * @brief Frees everything allocated from the arena. The GPU must be done with
+ * it, ie. the frame that used it has completed.
+ */
+void vulkan_frame_arena_reset(vulkan_frame_arena* arena);
+
+/**
+ * @brief Takes size bytes from the arena
+ * @param out_offset Offset of the data in arena->buffer, for a dynamic offset
+ * @param out_data Where to write the data
+ * @returns false if the arena is full
+ */
+bool vulkan_frame_arena_allocate(vulkan_frame_arena* arena,
+                                 vk::DeviceSize size, uint32_t* out_offset,
+                                 void** out_data);
+
+/**
+ * @brief Allocates and copies data into the arena
+ * @returns false if the arena is full
+ */
+bool vulkan_frame_arena_push(vulkan_frame_arena* arena, const void* data,
+                             vk::DeviceSize size, uint32_t* out_offset);
+
+#endif
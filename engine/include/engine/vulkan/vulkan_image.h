@@ -5,23 +5,52 @@
 
 #include "engine/renderer_types.inl"
 
+/**
+ * @brief Records copying a buffer into mip level 0 of an image. The image
+ * must be in eTransferDstOptimal when the batch runs.
+ */
 void vulkan_image_copy_from_buffer(backend_context* context,
+                                   vulkan_upload_batch* batch,
                                    vulkan_buffer buffer, vulkan_image image,
                                    uint32_t height, uint32_t width);
 
+/**
+ * @brief Records copying several regions (ie. every mip level) from a buffer
+ * into an image. The image must be in eTransferDstOptimal when the batch runs.
+ */
+void vulkan_image_copy_regions_from_buffer(backend_context* context,
+                                           vulkan_upload_batch* batch,
+                                           vulkan_buffer buffer,
+                                           vulkan_image image,
+                                           uint32_t region_count,
+                                           const vk::BufferImageCopy* regions);
+
 void vulkan_image_create(backend_context* context, uint32_t height,
-                         uint32_t width, vk::Format format,
+                         uint32_t width, uint32_t mip_levels,
+                         vk::Format format,
                          vk::Flags<vk::ImageUsageFlagBits> usage,
+                         vulkan_memory_category category,
                          vulkan_image* out_image);
 
+/**
+ * @brief Destroys an image and its view, and returns its memory
+ */
+void vulkan_image_destroy(backend_context* context, vulkan_image* image);
+
 void vulkan_image_create_view(backend_context* context, vk::Format format,
                               vk::ImageAspectFlagBits flags, vk::Image* image,
+                              uint32_t mip_levels,
                               vk::ImageView* out_image_view);
 
 void vulkan_image_create_sampler(backend_context* context, vulkan_image* image,
                                  vk::Sampler* out_sampler);
 
+/**
+ * @brief Records a layout transition barrier into the batch. Transitions to
+ * eShaderReadOnlyOptimal also hand the image to the graphics queue.
+ */
 void vulkan_image_transition_layout(backend_context* context,
+                                    vulkan_upload_batch* batch,
                                     vulkan_image* image, vk::Format format,
                                     vk::ImageLayout oldLayout,
                                     vk::ImageLayout newLayout);
@@ -0,0 +1,76 @@
+#ifndef VULKAN_MEMORY_BUDGET_H
+#define VULKAN_MEMORY_BUDGET_H
+
+#include "engine/renderer_types.inl"
+
+// Share of the device local heaps assumed usable without VK_EXT_memory_budget
+#define VULKAN_MEMORY_BUDGET_FALLBACK 0.8f
+// Eviction frees memory until usage is under this share of the budget, so
+// it doesn't run again on the next allocation
+#define VULKAN_MEMORY_BUDGET_TARGET 0.9f
+// Frames between budget checks
+#define VULKAN_RESIDENCY_CHECK_INTERVAL 8
+
+#define VULKAN_RESIDENCY_INVALID_ID 0xFFFFFFFFu
+
+/**
+ * The residency list tracks textures and meshes by when they were last drawn
+ * with. When device local memory goes over budget, the least recently used
+ * ones are evicted through their owner's callback, which may drop to lower
+ * mips or unload entirely. Anything drawn within the frames in flight is
+ * left alone, since the GPU may still be reading it.
+ */
+
+/**
+ * @brief Gets device local usage and budget, from VK_EXT_memory_budget when
+ * enabled, otherwise from the allocator's totals and the heap sizes
+ */
+void vulkan_memory_budget_query(backend_context* context,
+                                vulkan_memory_budget* out_budget);
+
+/**
+ * @brief Adds a resource to the list
+ * @param size Bytes it holds, the most evicting it can free
+ * @param evict Called to free memory, on the render thread
+ * @returns The resource's id
+ */
+uint32_t vulkan_residency_register(vulkan_residency* residency,
+                                   vulkan_memory_category category,
+                                   vk::DeviceSize size,
+                                   vulkan_evict_callback evict,
+                                   void* user_data);
+
+/**
+ * @brief Removes a resource, its owner is about to destroy it
+ */
+void vulkan_residency_unregister(vulkan_residency* residency, uint32_t id);
+
+/**
+ * @brief Marks a resource as used by the frame being recorded
+ */
+void vulkan_residency_touch(vulkan_residency* residency, uint32_t id);
+
+/**
+ * @brief Updates a resource's size after its owner reloaded it
+ */
+void vulkan_residency_set_size(vulkan_residency* residency, uint32_t id,
+                               vk::DeviceSize size);
+
+/**
+ * @returns false once a resource has been unloaded by eviction
+ */
+bool vulkan_residency_is_resident(const vulkan_residency* residency,
+                                  uint32_t id);
+
+/**
+ * @brief Starts a frame, and every few frames checks the budget and evicts
+ * least recently used resources if over it. Call after waiting for the
+ * frame's previous use to complete.
+ */
+void vulkan_residency_begin_frame(backend_context* context,
+                                  vulkan_residency* residency);
+
+void vulkan_residency_log_stats(backend_context* context,
+                                vulkan_residency* residency);
+
+#endif
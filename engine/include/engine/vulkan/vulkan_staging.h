@@ -0,0 +1,80 @@
+#ifndef VULKAN_STAGING_H
+#define VULKAN_STAGING_H
+
+#include "engine/renderer_types.inl"
+
+#define VULKAN_STAGING_RING_SIZE (32ull * 1024 * 1024)
+
+/**
+ * The staging ring hands out space front to back and wraps around. Space
+ * written since the last vulkan_staging_retire is tagged with the timeline
+ * value of the submission that reads it, and is reclaimed once the timeline
+ * reaches it.
+ */
+
+void vulkan_staging_create(backend_context* context, vk::DeviceSize size,
+                           vulkan_staging_ring* out_ring);
+
+void vulkan_staging_destroy(backend_context* context,
+                            vulkan_staging_ring* ring);
+
+/**
+ * @brief Takes contiguous space in the ring without blocking
+ * @param alignment A power of two
+ * @param out_offset Offset of the space in ring->buffer
+ * @param out_data Where to write the data
+ * @returns false if the ring has no room until more submissions complete
+ */
+bool vulkan_staging_allocate(backend_context* context,
+                             vulkan_staging_ring* ring, vk::DeviceSize size,
+                             vk::DeviceSize alignment,
+                             vk::DeviceSize* out_offset, void** out_data);
+
+/**
+ * @brief Tags everything allocated since the last call with a timeline value
+ * @param timeline The timeline of the submission that reads the space, or
+ * null if the GPU is already done with it
+ * @param value Signaled when the GPU is done reading
+ */
+void vulkan_staging_retire(backend_context* context, vulkan_staging_ring* ring,
+                           vulkan_timeline* timeline, uint64_t value);
+
+/**
+ * @brief Reclaims the space of every span whose timeline value has been
+ * reached, oldest first
+ */
+void vulkan_staging_reclaim(backend_context* context,
+                            vulkan_staging_ring* ring);
+
+/**
+ * @brief Records copying data into a buffer through the batch's ring. Data
+ * larger than the free space is split into several copies, submitting the
+ * batch and waiting on earlier copies for room.
+ */
+void vulkan_staging_upload_buffer(backend_context* context,
+                                  vulkan_upload_batch* batch,
+                                  vulkan_buffer* buffer,
+                                  vk::DeviceSize buffer_offset,
+                                  const void* data, vk::DeviceSize size);
+
+/**
+ * @brief Records copying one tightly packed mip level into an image through
+ * the batch's ring, split by rows of texel blocks if it doesn't fit at once.
+ * The image must be in eTransferDstOptimal when the batch runs.
+ * @param block_size Bytes per texel block, ie. 4 for RGBA8 or 16 for BC7
+ * @param block_dimension Width and height of a texel block, 1 if uncompressed
+ */
+void vulkan_staging_upload_image(backend_context* context,
+                                 vulkan_upload_batch* batch,
+                                 vulkan_image* image, uint32_t level,
+                                 uint32_t width, uint32_t height,
+                                 uint32_t block_size, uint32_t block_dimension,
+                                 const void* data);
+
+/**
+ * @brief Logs how much was written into the ring and how long that took,
+ * including waiting for room
+ */
+void vulkan_staging_log_stats(vulkan_staging_ring* ring);
+
+#endif
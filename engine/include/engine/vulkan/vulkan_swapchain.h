@@ -5,6 +5,14 @@
 
 void vulkan_swapchain_create(backend_context* context);
 void vulkan_swapchain_destroy(backend_context* context);
+/**
+ * @brief Replaces the swapchain with one sized to the window, passing the old
+ * one as oldSwapchain. The old swapchain, its views and framebuffers are
+ * retired through the deletion queue rather than waiting for the device.
+ * Framebuffers are left for the caller to rebuild.
+ * @returns false while the window has no area, the old swapchain is kept
+ */
+bool vulkan_swapchain_recreate(backend_context* context);
 void vulkan_swapchain_create_image_views(backend_context* context);
 
 #endif
@@ -0,0 +1,42 @@
+#ifndef VULKAN_TIMELINE_H
+#define VULKAN_TIMELINE_H
+
+#include "engine/renderer_types.inl"
+
+/**
+ * A timeline is a Vulkan 1.2 timeline semaphore whose value only grows. Each
+ * submission to the timeline's queue signals the next value, and anything
+ * that needs to know when that work is done keeps the value and waits on or
+ * queries it, rather than owning a fence that has to be reset. Values are
+ * only signaled from one queue, so they complete in order.
+ */
+
+void vulkan_timeline_create(backend_context* context, const char* name,
+                            vulkan_timeline* out_timeline);
+
+void vulkan_timeline_destroy(backend_context* context,
+                             vulkan_timeline* timeline);
+
+/**
+ * @brief Hands out the value for a submission to signal
+ */
+uint64_t vulkan_timeline_next(vulkan_timeline* timeline);
+
+/**
+ * @returns true once the GPU has signaled value, without blocking
+ */
+bool vulkan_timeline_reached(backend_context* context,
+                             vulkan_timeline* timeline, uint64_t value);
+
+/**
+ * @brief Blocks until the GPU has signaled value
+ */
+void vulkan_timeline_wait(backend_context* context, vulkan_timeline* timeline,
+                          uint64_t value);
+
+/**
+ * @brief Logs the CPU time spent waiting on and querying the timeline
+ */
+void vulkan_timeline_log_stats(vulkan_timeline* timeline);
+
+#endif
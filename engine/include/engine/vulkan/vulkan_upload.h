@@ -0,0 +1,95 @@
+#ifndef VULKAN_UPLOAD_H
+#define VULKAN_UPLOAD_H
+
+#include "engine/renderer_types.inl"
+
+/**
+ * An upload batch records any number of copies and barriers and submits them
+ * together, instead of a submit and a queue wait per operation. Copies run on
+ * the transfer queue so they overlap rendering. Once they complete the batch
+ * is handed to the graphics queue: a submission that waits on the transfer
+ * half's semaphore, acquires ownership of what was released to it and makes
+ * every write visible to graphics work submitted after it.
+ */
+
+// Which half of the batch a command is recorded into
+typedef enum vulkan_upload_queue {
+  // Copies and transfer stage barriers
+  VULKAN_UPLOAD_QUEUE_TRANSFER = 0,
+  // Anything the transfer queue can't do, ie. depth attachment transitions
+  VULKAN_UPLOAD_QUEUE_GRAPHICS = 1
+} vulkan_upload_queue;
+
+/**
+ * @brief Creates the batch's command pool, command buffers and sync objects.
+ * Needs context->command_pool for the graphics half.
+ * @param staging The ring the batch's copies read from
+ */
+void vulkan_upload_batch_create(backend_context* context,
+                                vulkan_staging_ring* staging,
+                                vulkan_upload_batch* out_batch);
+
+/**
+ * @brief Waits for the batch, then frees everything it created
+ */
+void vulkan_upload_batch_destroy(backend_context* context,
+                                 vulkan_upload_batch* batch);
+
+/**
+ * @brief Gets the command buffer to record one operation into, beginning it
+ * if needed. Recording a new transfer half waits for the previous one.
+ */
+vk::CommandBuffer vulkan_upload_batch_record(backend_context* context,
+                                             vulkan_upload_batch* batch,
+                                             vulkan_upload_queue queue);
+
+/**
+ * @brief Records releasing an image to the graphics queue, and the matching
+ * acquire for the graphics half. A layout transition in the barrier happens
+ * as part of the transfer.
+ * @param barrier Layouts, subresources and access masks as a barrier on a
+ * single queue would have them. Queue families are filled in.
+ * @param dst_stage Where the graphics queue first uses the image
+ */
+void vulkan_upload_batch_release_image(backend_context* context,
+                                       vulkan_upload_batch* batch,
+                                       const vk::ImageMemoryBarrier& barrier,
+                                       vk::PipelineStageFlags dst_stage);
+
+/**
+ * @brief Records releasing a whole buffer written by the transfer half to the
+ * graphics queue, and the matching acquire
+ * @param dst_access How the graphics queue first reads it
+ * @param dst_stage Where the graphics queue first reads it
+ */
+void vulkan_upload_batch_release_buffer(backend_context* context,
+                                        vulkan_upload_batch* batch,
+                                        vk::Buffer buffer,
+                                        vk::AccessFlags dst_access,
+                                        vk::PipelineStageFlags dst_stage);
+
+/**
+ * @brief Submits everything recorded since the last submit, without waiting.
+ * The graphics half follows once the transfer half completes, see
+ * vulkan_upload_batch_poll.
+ * @returns false if there was nothing to submit
+ */
+bool vulkan_upload_batch_submit(backend_context* context,
+                                vulkan_upload_batch* batch);
+
+/**
+ * @brief Hands the transfer half to the graphics queue if it has completed
+ * @returns true once everything submitted so far is usable by graphics work
+ * submitted after this call
+ */
+bool vulkan_upload_batch_poll(backend_context* context,
+                              vulkan_upload_batch* batch);
+
+/**
+ * @brief Submits anything still recording, blocks until the transfer half
+ * completes and hands it to the graphics queue
+ */
+void vulkan_upload_batch_wait(backend_context* context,
+                              vulkan_upload_batch* batch);
+
+#endif
@@ -1,6 +1,11 @@
 
 #include "engine/application.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include "engine/assets/assets.h"
+#include "engine/frame_limiter.h"
 #include "engine/logger.h"
 #include "engine/renderer.h"
 
@@ -8,7 +13,57 @@
 
 #include <GLFW/glfw3.h>
 
+// Frames run at each depth before timing starts, so the GPU clocks and the
+// swapchain settle
+#define BENCHMARK_WARMUP_FRAMES 60
+
 static platform_state *plat_state;
+static renderer_present_config present_config;
+static frame_limiter limiter;
+// Frames timed at each frame ring depth, 0 when not benchmarking
+static uint32_t benchmark_frames;
+
+static const char *present_mode_names[RENDERER_PRESENT_MODE_COUNT] = {
+    "fifo", "mailbox", "immediate", "fifo_relaxed"};
+
+// Presentation is set per deployment through the environment:
+// ORION_PRESENT_MODE is one of present_mode_names, ORION_SWAPCHAIN_IMAGES an
+// image count, ORION_FPS_LIMIT a frame rate cap, unlimited when unset, and
+// ORION_FRAMES_IN_FLIGHT the frame ring depth. ORION_BENCHMARK times that many
+// frames at every depth and exits.
+static void read_settings() {
+  present_config = {};
+  const char *mode = getenv("ORION_PRESENT_MODE");
+  if (mode) {
+    bool found = false;
+    for (uint32_t i = 0; i < RENDERER_PRESENT_MODE_COUNT; i++) {
+      if (strcmp(mode, present_mode_names[i]) == 0) {
+        present_config.mode = (renderer_present_mode)i;
+        found = true;
+      }
+    }
+    if (!found) {
+      OE_LOG(LOG_LEVEL_WARN, "Unknown ORION_PRESENT_MODE %s, using fifo",
+             mode);
+    }
+  }
+  const char *images = getenv("ORION_SWAPCHAIN_IMAGES");
+  if (images) {
+    present_config.image_count = (uint32_t)strtoul(images, nullptr, 10);
+  }
+  const char *fps_limit = getenv("ORION_FPS_LIMIT");
+  frame_limiter_create(fps_limit ? strtod(fps_limit, nullptr) : 0.0,
+                       &limiter);
+  renderer_set_present_config(&present_config);
+
+  const char *frames_in_flight = getenv("ORION_FRAMES_IN_FLIGHT");
+  if (frames_in_flight) {
+    renderer_set_frames_in_flight(
+        (uint32_t)strtoul(frames_in_flight, nullptr, 10));
+  }
+  const char *benchmark = getenv("ORION_BENCHMARK");
+  benchmark_frames = benchmark ? (uint32_t)strtoul(benchmark, nullptr, 10) : 0;
+}
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action,
                   int mods) {
@@ -16,26 +71,84 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action,
     OE_LOG(LOG_LEVEL_DEBUG, "E KEY PRESSED");
 
   if (key == GLFW_KEY_Q && action == GLFW_PRESS) application_shutdown();
+
+  // Cycles present modes to compare latency at runtime
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    present_config.mode = (renderer_present_mode)((present_config.mode + 1) %
+                                                  RENDERER_PRESENT_MODE_COUNT);
+    OE_LOG(LOG_LEVEL_INFO, "Present mode: %s",
+           present_mode_names[present_config.mode]);
+    renderer_set_present_config(&present_config);
+  }
 }
 void application_initialize(platform_state *state) {
   plat_state = state;
 
   glfwSetKeyCallback(plat_state->window, key_callback);
+  read_settings();
 
+  assets_mount(ASSETS_PACK_PATH);
   load_object();
   OE_LOG(LOG_LEVEL_INFO, "Application initialized!");
 }
 
+// @returns false once the window is closing
+static bool run_frame() {
+  if (glfwWindowShouldClose(plat_state->window)) {
+    return false;
+  }
+  // Waiting before polling rather than after drawing keeps the input the
+  // frame is drawn with as fresh as possible
+  frame_limiter_wait(&limiter);
+  glfwPollEvents();
+  draw_frame();
+  return true;
+}
+
+// Times each frame ring depth in turn with the deployment's present mode and
+// frame limit, then closes the window
+static void run_benchmark() {
+  OE_LOG(LOG_LEVEL_INFO, "Benchmarking %u frames at each frame ring depth",
+         benchmark_frames);
+  for (uint32_t depth = 1; depth <= RENDERER_MAX_FRAMES_IN_FLIGHT; depth++) {
+    renderer_set_frames_in_flight(depth);
+    for (uint32_t i = 0; i < BENCHMARK_WARMUP_FRAMES; i++) {
+      run_frame();
+    }
+    renderer_begin_frame_stats();
+    uint32_t frame = 0;
+    while (frame < benchmark_frames && run_frame()) {
+      frame++;
+    }
+    renderer_frame_stats stats;
+    renderer_end_frame_stats(&stats);
+    if (frame < benchmark_frames) {
+      OE_LOG(LOG_LEVEL_WARN, "Benchmark stopped, the window was closed");
+      return;
+    }
+    OE_LOG(LOG_LEVEL_INFO,
+           "%u frames in flight: %.1f fps, latency %.2f ms average, %.2f ms "
+           "p50, %.2f ms p99, %.2f ms max",
+           stats.frames_in_flight, stats.frames_per_second,
+           stats.latency_average * 1000.0, stats.latency_p50 * 1000.0,
+           stats.latency_p99 * 1000.0, stats.latency_max * 1000.0);
+  }
+  glfwSetWindowShouldClose(plat_state->window, GLFW_TRUE);
+}
+
 bool application_run() {
-  while (!glfwWindowShouldClose(plat_state->window)) {
-    glfwPollEvents();
-    draw_frame();
+  if (benchmark_frames > 0) {
+    run_benchmark();
+  }
+  while (run_frame()) {
   }
   OE_LOG(LOG_LEVEL_DEBUG, "Application terminating");
   return false;
 }
 
 void application_shutdown() {
+  frame_limiter_log_stats(&limiter);
   renderer_shutdown();
+  assets_unmount();
   glfwTerminate();
 }
@@ -0,0 +1,189 @@
+#include "engine/assets/asset_compression.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#define LZ_MIN_MATCH 4
+// Format rules: the last 5 bytes are always literals and no match starts in
+// the last 12
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+#define LZ_MAX_OFFSET 65535
+// Hash table size range, smaller inputs get smaller tables to clear
+#define LZ_MIN_HASH_BITS 8
+#define LZ_MAX_HASH_BITS 16
+
+static inline uint32_t read_u32(const uint8_t *p) {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline uint32_t hash_u32(uint32_t value, uint32_t bits) {
+  return (value * 2654435761u) >> (32 - bits);
+}
+
+// Writes a length's continuation bytes after its 15 in the token
+static inline uint8_t *write_length(uint8_t *out, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *out++ = 255;
+  }
+  *out++ = (uint8_t)length;
+  return out;
+}
+
+size_t asset_compress_bound(size_t size) { return size + size / 255 + 16; }
+
+size_t asset_compress(const void *source, size_t size, void *destination,
+                      size_t capacity) {
+  const uint8_t *input = (const uint8_t *)source;
+  const uint8_t *input_end = input + size;
+  uint8_t *out = (uint8_t *)destination;
+  uint8_t *out_end = out + capacity;
+
+  // Positions of the last occurrence of each 4 byte hash
+  uint32_t hash_bits = LZ_MIN_HASH_BITS;
+  while (hash_bits < LZ_MAX_HASH_BITS && ((size_t)1 << hash_bits) < size) {
+    hash_bits++;
+  }
+  std::vector<uint32_t> table((size_t)1 << hash_bits, UINT32_MAX);
+  const uint8_t *literal_start = input;
+  const uint8_t *p = input;
+  const uint8_t *match_limit =
+      size > LZ_MATCH_LIMIT ? input_end - LZ_MATCH_LIMIT : input;
+
+  while (p < match_limit) {
+    uint32_t hash = hash_u32(read_u32(p), hash_bits);
+    uint32_t candidate = table[hash];
+    table[hash] = (uint32_t)(p - input);
+    if (candidate == UINT32_MAX ||
+        (size_t)(p - input) - candidate > LZ_MAX_OFFSET ||
+        read_u32(input + candidate) != read_u32(p)) {
+      p++;
+      continue;
+    }
+
+    const uint8_t *match = input + candidate;
+    const uint8_t *match_end = p + LZ_MIN_MATCH;
+    const uint8_t *match_end_limit = input_end - LZ_LAST_LITERALS;
+    while (match_end < match_end_limit &&
+           *match_end == match[match_end - p]) {
+      match_end++;
+    }
+
+    size_t literal_length = (size_t)(p - literal_start);
+    size_t match_length = (size_t)(match_end - p) - LZ_MIN_MATCH;
+    // Token, lengths, literals and offset in the worst case
+    if ((size_t)(out_end - out) <
+        1 + literal_length / 255 + 1 + literal_length + 2 +
+            match_length / 255 + 1) {
+      return 0;
+    }
+    uint8_t *token = out++;
+    *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+    if (literal_length >= 15) {
+      out = write_length(out, literal_length - 15);
+    }
+    memcpy(out, literal_start, literal_length);
+    out += literal_length;
+    uint16_t offset = (uint16_t)(p - match);
+    out[0] = (uint8_t)(offset & 0xff);
+    out[1] = (uint8_t)(offset >> 8);
+    out += 2;
+    *token |= (uint8_t)(match_length < 15 ? match_length : 15);
+    if (match_length >= 15) {
+      out = write_length(out, match_length - 15);
+    }
+
+    p = match_end;
+    literal_start = p;
+  }
+
+  // Everything left is literals
+  size_t literal_length = (size_t)(input_end - literal_start);
+  if ((size_t)(out_end - out) < 1 + literal_length / 255 + 1 + literal_length) {
+    return 0;
+  }
+  uint8_t *token = out++;
+  *token = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+  if (literal_length >= 15) {
+    out = write_length(out, literal_length - 15);
+  }
+  if (literal_length > 0) {
+    memcpy(out, literal_start, literal_length);
+    out += literal_length;
+  }
+  return (size_t)(out - (uint8_t *)destination);
+}
+
+// Reads a length's continuation bytes, false if they run past the end
+static inline bool read_length(const uint8_t **in, const uint8_t *in_end,
+                               size_t *length) {
+  uint8_t byte;
+  do {
+    if (*in >= in_end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool asset_decompress(const void *source, size_t source_size,
+                      void *destination, size_t size) {
+  const uint8_t *in = (const uint8_t *)source;
+  const uint8_t *in_end = in + source_size;
+  uint8_t *out = (uint8_t *)destination;
+  uint8_t *out_start = out;
+  uint8_t *out_end = out + size;
+
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !read_length(&in, in_end, &literal_length)) {
+      return false;
+    }
+    if (literal_length > (size_t)(in_end - in) ||
+        literal_length > (size_t)(out_end - out)) {
+      return false;
+    }
+    if (literal_length > 0) {
+      memcpy(out, in, literal_length);
+      in += literal_length;
+      out += literal_length;
+    }
+
+    // The last sequence has no match
+    if (in == in_end) {
+      break;
+    }
+    if (in_end - in < 2) {
+      return false;
+    }
+    size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+    in += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !read_length(&in, in_end, &match_length)) {
+      return false;
+    }
+    match_length += LZ_MIN_MATCH;
+    if (offset == 0 || offset > (size_t)(out - out_start) ||
+        match_length > (size_t)(out_end - out)) {
+      return false;
+    }
+    // Matches may overlap their own output, so copy forwards byte by byte
+    // unless they're far enough apart
+    const uint8_t *match = out - offset;
+    if (offset >= match_length) {
+      memcpy(out, match, match_length);
+      out += match_length;
+    } else {
+      for (size_t i = 0; i < match_length; i++) {
+        *out++ = match[i];
+      }
+    }
+  }
+  return out == out_end;
+}
@@ -0,0 +1,234 @@
+#include "engine/assets/asset_pack.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "engine/assets/asset_compression.h"
+#include "engine/logger.h"
+
+// Entries smaller than this aren't worth decompressing
+#define ASSET_PACK_MIN_COMPRESS_SIZE 64
+
+static uint64_t align_offset(uint64_t offset) {
+  return (offset + ASSET_PACK_BLOB_ALIGNMENT - 1) &
+         ~(uint64_t)(ASSET_PACK_BLOB_ALIGNMENT - 1);
+}
+
+uint64_t asset_pack_hash_path(const char *path, size_t length) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= (unsigned char)path[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool asset_pack_write(const char *path, const asset_pack_source *sources,
+                      uint32_t source_count, bool compress) {
+  std::vector<uint32_t> order(source_count);
+  std::vector<uint64_t> hashes(source_count);
+  for (uint32_t i = 0; i < source_count; i++) {
+    order[i] = i;
+    hashes[i] = asset_pack_hash_path(sources[i].path, strlen(sources[i].path));
+  }
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    if (hashes[a] != hashes[b]) {
+      return hashes[a] < hashes[b];
+    }
+    return strcmp(sources[a].path, sources[b].path) < 0;
+  });
+
+  asset_pack_header header{};
+  header.magic = ASSET_PACK_MAGIC;
+  header.version = ASSET_PACK_VERSION;
+  header.entry_count = source_count;
+  header.index_offset = sizeof(asset_pack_header);
+  header.strings_offset =
+      header.index_offset + (uint64_t)source_count * sizeof(asset_pack_entry);
+
+  std::vector<asset_pack_entry> entries(source_count);
+  std::vector<std::vector<uint8_t>> compressed(source_count);
+  std::string strings;
+  for (uint32_t i = 0; i < source_count; i++) {
+    const asset_pack_source *source = &sources[order[i]];
+    if (i > 0 && hashes[order[i]] == hashes[order[i - 1]] &&
+        strcmp(source->path, sources[order[i - 1]].path) == 0) {
+      OE_LOG(LOG_LEVEL_ERROR, "Asset '%s' is in the pack twice", source->path);
+      return false;
+    }
+
+    asset_pack_entry *entry = &entries[i];
+    entry->path_hash = hashes[order[i]];
+    entry->path_offset = (uint32_t)strings.size();
+    entry->path_length = (uint32_t)strlen(source->path);
+    entry->size = source->size;
+    entry->stored_size = source->size;
+    entry->compression = ASSET_PACK_COMPRESSION_NONE;
+    strings.append(source->path, entry->path_length);
+
+    // Only keep the compressed copy if it saves at least an eighth
+    if (compress && source->size >= ASSET_PACK_MIN_COMPRESS_SIZE) {
+      std::vector<uint8_t> *block = &compressed[i];
+      block->resize(source->size - source->size / 8);
+      size_t size = asset_compress(source->data, source->size, block->data(),
+                                   block->size());
+      if (size > 0) {
+        block->resize(size);
+        entry->stored_size = size;
+        entry->compression = ASSET_PACK_COMPRESSION_LZ4;
+      } else {
+        std::vector<uint8_t>().swap(*block);
+      }
+    }
+  }
+  header.strings_size = strings.size();
+
+  uint64_t offset = header.strings_offset + header.strings_size;
+  for (auto &entry : entries) {
+    offset = align_offset(offset);
+    entry.offset = offset;
+    offset += entry.stored_size;
+  }
+
+  std::string temp_path = std::string(path) + ".tmp";
+  file_handle handle;
+  if (!filesystem_open(temp_path.c_str(), FILE_MODE_WRITE, true, &handle)) {
+    return false;
+  }
+  static const char padding[ASSET_PACK_BLOB_ALIGNMENT] = {};
+  long written = 0;
+  bool ok =
+      filesystem_write(&handle, sizeof(header), &header, &written) &&
+      (source_count == 0 ||
+       filesystem_write(&handle, (long)(entries.size() * sizeof(entries[0])),
+                        entries.data(), &written)) &&
+      (strings.empty() || filesystem_write(&handle, (long)strings.size(),
+                                           strings.data(), &written));
+  offset = header.strings_offset + header.strings_size;
+  for (uint32_t i = 0; ok && i < source_count; i++) {
+    const asset_pack_entry *entry = &entries[i];
+    long padding_size = (long)(entry->offset - offset);
+    const void *data = entry->compression == ASSET_PACK_COMPRESSION_NONE
+                           ? sources[order[i]].data
+                           : compressed[i].data();
+    ok = (padding_size == 0 ||
+          filesystem_write(&handle, padding_size, padding, &written)) &&
+         (entry->stored_size == 0 ||
+          filesystem_write(&handle, (long)entry->stored_size, data, &written));
+    offset = entry->offset + entry->stored_size;
+  }
+  filesystem_close(&handle);
+
+  if (!ok || rename(temp_path.c_str(), path) != 0) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to write asset pack: '%s'", path);
+    remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool asset_pack_mount(const char *path, asset_pack *out_pack) {
+  *out_pack = {};
+  file_mapping mapping;
+  if (!filesystem_map(path, FILE_MAP_HINT_NONE, &mapping)) {
+    return false;
+  }
+
+  const asset_pack_header *header = (const asset_pack_header *)mapping.data;
+  uint64_t size = mapping.size;
+  bool valid =
+      size >= sizeof(asset_pack_header) && header->magic == ASSET_PACK_MAGIC &&
+      header->version == ASSET_PACK_VERSION &&
+      header->index_offset % alignof(asset_pack_entry) == 0 &&
+      header->index_offset +
+              (uint64_t)header->entry_count * sizeof(asset_pack_entry) <=
+          size &&
+      header->strings_offset + header->strings_size <= size;
+  const asset_pack_entry *entries =
+      valid ? (const asset_pack_entry *)((const char *)mapping.data +
+                                         header->index_offset)
+            : nullptr;
+  // Check every entry once here so lookups don't have to
+  for (uint32_t i = 0; valid && i < header->entry_count; i++) {
+    const asset_pack_entry *entry = &entries[i];
+    valid = entry->offset + entry->stored_size <= size &&
+            (uint64_t)entry->path_offset + entry->path_length <=
+                header->strings_size &&
+            entry->compression <= ASSET_PACK_COMPRESSION_LZ4 &&
+            (entry->compression != ASSET_PACK_COMPRESSION_NONE ||
+             entry->stored_size == entry->size) &&
+            (i == 0 || entries[i - 1].path_hash <= entry->path_hash);
+  }
+  if (!valid) {
+    OE_LOG(LOG_LEVEL_ERROR, "Invalid asset pack: '%s'", path);
+    filesystem_unmap(&mapping);
+    return false;
+  }
+
+  out_pack->mapping = mapping;
+  out_pack->header = header;
+  out_pack->entries = entries;
+  out_pack->strings = (const char *)mapping.data + header->strings_offset;
+  return true;
+}
+
+void asset_pack_unmount(asset_pack *pack) {
+  filesystem_unmap(&pack->mapping);
+  *pack = {};
+}
+
+const asset_pack_entry *asset_pack_find(const asset_pack *pack,
+                                        const char *path) {
+  if (!pack->header) {
+    return nullptr;
+  }
+  size_t length = strlen(path);
+  uint64_t hash = asset_pack_hash_path(path, length);
+  const asset_pack_entry *end = pack->entries + pack->header->entry_count;
+  const asset_pack_entry *entry = std::lower_bound(
+      pack->entries, end, hash,
+      [](const asset_pack_entry &e, uint64_t h) { return e.path_hash < h; });
+  // Colliding hashes are adjacent, the path tells them apart
+  for (; entry != end && entry->path_hash == hash; entry++) {
+    if (entry->path_length == length &&
+        memcmp(pack->strings + entry->path_offset, path, length) == 0) {
+      return entry;
+    }
+  }
+  return nullptr;
+}
+
+bool asset_pack_read(const asset_pack *pack, const asset_pack_entry *entry,
+                     asset_data *out_data) {
+  *out_data = {};
+  const char *blob = (const char *)pack->mapping.data + entry->offset;
+  if (entry->compression == ASSET_PACK_COMPRESSION_NONE) {
+    out_data->data = blob;
+    out_data->size = entry->size;
+    return true;
+  }
+
+  void *buffer = malloc(entry->size ? entry->size : 1);
+  if (!buffer ||
+      !asset_decompress(blob, entry->stored_size, buffer, entry->size)) {
+    OE_LOG(LOG_LEVEL_ERROR, "Corrupt asset '%.*s' in pack",
+           (int)entry->path_length, pack->strings + entry->path_offset);
+    free(buffer);
+    return false;
+  }
+  out_data->data = buffer;
+  out_data->size = entry->size;
+  out_data->owned = buffer;
+  return true;
+}
+
+void asset_data_release(asset_data *data) {
+  free(data->owned);
+  filesystem_unmap(&data->mapping);
+  *data = {};
+}
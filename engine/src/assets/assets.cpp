@@ -0,0 +1,50 @@
+#include "engine/assets/assets.h"
+
+#include <string>
+
+#include "engine/filesystem.h"
+#include "engine/logger.h"
+
+static asset_pack pack;
+
+bool assets_mount(const char *pack_path) {
+  assets_unmount();
+  if (!filesystem_exists(pack_path)) {
+    OE_LOG(LOG_LEVEL_INFO, "No asset pack, loading loose assets from '%s'",
+           ASSETS_ROOT);
+    return false;
+  }
+  if (!asset_pack_mount(pack_path, &pack)) {
+    return false;
+  }
+  OE_LOG(LOG_LEVEL_INFO, "Mounted asset pack '%s' (%u assets)", pack_path,
+         pack.header->entry_count);
+  return true;
+}
+
+void assets_unmount() {
+  if (pack.header) {
+    asset_pack_unmount(&pack);
+  }
+}
+
+bool assets_is_packed(const char *name) {
+  return asset_pack_find(&pack, name) != nullptr;
+}
+
+bool assets_load(const char *name, asset_data *out_data) {
+  *out_data = {};
+  const asset_pack_entry *entry = asset_pack_find(&pack, name);
+  if (entry) {
+    return asset_pack_read(&pack, entry, out_data);
+  }
+
+  std::string path = std::string(ASSETS_ROOT) + name;
+  if (!filesystem_map(path.c_str(), FILE_MAP_HINT_NONE, &out_data->mapping)) {
+    OE_LOG(LOG_LEVEL_ERROR, "Unable to load asset '%s'", name);
+    return false;
+  }
+  out_data->data = out_data->mapping.data;
+  out_data->size = out_data->mapping.size;
+  return true;
+}
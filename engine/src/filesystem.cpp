@@ -5,6 +5,7 @@
 // TODO: REFACTOR
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 #include <cstdint>
@@ -105,9 +106,11 @@ bool filesystem_read_all_bytes(file_handle *handle, char **out_bytes,
     long size = ftell((FILE *)handle->handle);
     rewind((FILE *)handle->handle);
 
-    *out_bytes = (char *)malloc(sizeof(bool) * size);
+    *out_bytes = (char *)malloc(size);
     *out_bytes_read = fread(*out_bytes, 1, size, (FILE *)handle->handle);
     if (*out_bytes_read != size) {
+      free(*out_bytes);
+      *out_bytes = 0;
       return false;
     }
     return true;
@@ -127,3 +130,53 @@ bool filesystem_write(file_handle *handle, long data_size, const void *data,
   }
   return false;
 }
+
+bool filesystem_map(const char *path, uint32_t hints,
+                    file_mapping *out_mapping) {
+  out_mapping->data = 0;
+  out_mapping->size = 0;
+
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fileno(file), &file_stat) != 0) {
+    fclose(file);
+    return false;
+  }
+  size_t size = (size_t)file_stat.st_size;
+  if (size == 0) {
+    // mmap rejects empty ranges
+    fclose(file);
+    return true;
+  }
+
+  void *data = mmap(0, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+  // The mapping keeps its own reference to the file
+  fclose(file);
+  if (data == MAP_FAILED) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to map file: '%s'", path);
+    return false;
+  }
+
+  // Advice values aren't flags, each needs its own call
+  if (hints & FILE_MAP_HINT_SEQUENTIAL) {
+    madvise(data, size, MADV_SEQUENTIAL);
+  }
+  if (hints & FILE_MAP_HINT_WILLNEED) {
+    madvise(data, size, MADV_WILLNEED);
+  }
+
+  out_mapping->data = data;
+  out_mapping->size = size;
+  return true;
+}
+
+void filesystem_unmap(file_mapping *mapping) {
+  if (mapping->data) {
+    munmap((void *)mapping->data, mapping->size);
+  }
+  mapping->data = 0;
+  mapping->size = 0;
+}
@@ -0,0 +1,458 @@
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "engine/filesystem.h"
+#include "engine/logger.h"
+
+#define FILE_IO_DEFAULT_DEPTH 64
+#define FILE_IO_MAX_THREADS 8
+// Keeps every completion's byte count within its 32 bit result
+#define FILE_IO_MAX_READ_SIZE (1u << 30)
+
+typedef struct file_read_request {
+  file_read_id id;
+  std::string path;
+  file_read_callback callback;
+  void *user_data;
+  file_read_result result;
+  FILE *file;
+  size_t bytes_read;
+  struct iovec iov;
+  bool complete;
+  bool claimed;
+} file_read_request;
+
+// The mapped submission and completion rings of an io_uring instance
+typedef struct io_ring {
+  int fd;
+  void *sq_mapping;
+  size_t sq_mapping_size;
+  void *cq_mapping;
+  size_t cq_mapping_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+
+  uint32_t *sq_tail;
+  uint32_t sq_mask;
+  uint32_t *sq_array;
+  uint32_t sq_entries;
+
+  uint32_t *cq_head;
+  uint32_t *cq_tail;
+  uint32_t cq_mask;
+  struct io_uring_cqe *cqes;
+} io_ring;
+
+struct file_io_queue {
+  file_io_backend backend;
+  uint32_t depth;
+  std::mutex mutex;
+  // Signals the backend threads that there is new work or shutdown
+  std::condition_variable work_ready;
+  // Signals waiters that a read finished
+  std::condition_variable read_complete;
+  // Indexed by file_read_id. A deque so requests never move.
+  std::deque<file_read_request> requests;
+  // Queued by filesystem_read_async, not submitted yet
+  std::vector<file_read_id> queued;
+  // Submitted, not yet picked up by a backend thread
+  std::vector<file_read_id> submitted;
+  std::vector<std::thread> threads;
+  bool shutting_down;
+  io_ring ring;
+};
+
+// Request setup and completion, shared by both backends. Requests are only
+// looked up in the deque under the lock, the backends pass pointers around.
+
+static void finish_request(file_io_queue *queue, file_read_request *request,
+                           bool success) {
+  if (request->file) {
+    fclose(request->file);
+    request->file = nullptr;
+  }
+  request->result.success = success;
+  if (!success) {
+    free(request->result.data);
+    request->result.data = nullptr;
+    request->result.size = 0;
+  }
+
+  if (request->callback) {
+    request->callback(request->id, &request->result, request->user_data);
+  }
+
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  request->complete = true;
+  queue->read_complete.notify_all();
+}
+
+// Opens the file and allocates its buffer. Returns false if the request
+// already completed, either failed or empty.
+static bool begin_request(file_io_queue *queue, file_read_request *request) {
+  request->file = fopen(request->path.c_str(), "rb");
+  if (!request->file) {
+    finish_request(queue, request, false);
+    return false;
+  }
+  struct stat file_stat;
+  if (fstat(fileno(request->file), &file_stat) != 0) {
+    finish_request(queue, request, false);
+    return false;
+  }
+  request->result.size = (size_t)file_stat.st_size;
+  if (request->result.size == 0) {
+    finish_request(queue, request, true);
+    return false;
+  }
+  request->result.data = (char *)malloc(request->result.size);
+  if (!request->result.data) {
+    finish_request(queue, request, false);
+    return false;
+  }
+  return true;
+}
+
+// Thread pool backend
+
+static void read_worker(file_io_queue *queue) {
+  for (;;) {
+    file_read_request *request;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      queue->work_ready.wait(lock, [queue] {
+        return !queue->submitted.empty() || queue->shutting_down;
+      });
+      if (queue->submitted.empty()) {
+        return;
+      }
+      request = &queue->requests[queue->submitted.back()];
+      queue->submitted.pop_back();
+    }
+
+    if (!begin_request(queue, request)) {
+      continue;
+    }
+    int fd = fileno(request->file);
+    bool success = true;
+    while (request->bytes_read < request->result.size) {
+      ssize_t count = pread(fd, request->result.data + request->bytes_read,
+                            request->result.size - request->bytes_read,
+                            (off_t)request->bytes_read);
+      if (count <= 0) {
+        // Errors and files truncated since fstat
+        success = false;
+        break;
+      }
+      request->bytes_read += (size_t)count;
+    }
+    finish_request(queue, request, success);
+  }
+}
+
+// io_uring backend, driven through the raw syscalls
+
+static bool io_ring_create(uint32_t entries, io_ring *out_ring) {
+  *out_ring = {};
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    // Old kernels and sandboxes that block io_uring
+    return false;
+  }
+  out_ring->fd = fd;
+
+  out_ring->sq_mapping_size =
+      params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  out_ring->cq_mapping_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  bool single_mapping = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mapping) {
+    size_t size = out_ring->sq_mapping_size > out_ring->cq_mapping_size
+                      ? out_ring->sq_mapping_size
+                      : out_ring->cq_mapping_size;
+    out_ring->sq_mapping_size = size;
+    out_ring->cq_mapping_size = size;
+  }
+
+  out_ring->sq_mapping =
+      mmap(nullptr, out_ring->sq_mapping_size, PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  out_ring->cq_mapping =
+      single_mapping
+          ? out_ring->sq_mapping
+          : mmap(nullptr, out_ring->cq_mapping_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+  out_ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(nullptr, out_ring->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (out_ring->sq_mapping == MAP_FAILED ||
+      out_ring->cq_mapping == MAP_FAILED || sqes == MAP_FAILED) {
+    if (out_ring->sq_mapping != MAP_FAILED) {
+      munmap(out_ring->sq_mapping, out_ring->sq_mapping_size);
+    }
+    if (!single_mapping && out_ring->cq_mapping != MAP_FAILED) {
+      munmap(out_ring->cq_mapping, out_ring->cq_mapping_size);
+    }
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, out_ring->sqes_size);
+    }
+    close(fd);
+    *out_ring = {};
+    return false;
+  }
+  out_ring->sqes = (struct io_uring_sqe *)sqes;
+
+  char *sq = (char *)out_ring->sq_mapping;
+  out_ring->sq_tail = (uint32_t *)(sq + params.sq_off.tail);
+  out_ring->sq_mask = *(uint32_t *)(sq + params.sq_off.ring_mask);
+  out_ring->sq_array = (uint32_t *)(sq + params.sq_off.array);
+  out_ring->sq_entries = params.sq_entries;
+
+  char *cq = (char *)out_ring->cq_mapping;
+  out_ring->cq_head = (uint32_t *)(cq + params.cq_off.head);
+  out_ring->cq_tail = (uint32_t *)(cq + params.cq_off.tail);
+  out_ring->cq_mask = *(uint32_t *)(cq + params.cq_off.ring_mask);
+  out_ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+  return true;
+}
+
+static void io_ring_destroy(io_ring *ring) {
+  if (!ring->sqes) {
+    return;
+  }
+  munmap(ring->sqes, ring->sqes_size);
+  if (ring->cq_mapping != ring->sq_mapping) {
+    munmap(ring->cq_mapping, ring->cq_mapping_size);
+  }
+  munmap(ring->sq_mapping, ring->sq_mapping_size);
+  close(ring->fd);
+  *ring = {};
+}
+
+// Queues a read of the rest of the request's file, up to the size cap
+static void io_ring_prepare_read(io_ring *ring, file_read_request *request) {
+  size_t remaining = request->result.size - request->bytes_read;
+  request->iov.iov_base = request->result.data + request->bytes_read;
+  request->iov.iov_len =
+      remaining < FILE_IO_MAX_READ_SIZE ? remaining : FILE_IO_MAX_READ_SIZE;
+
+  // Only this thread writes the tail, the kernel reads it
+  uint32_t tail = *ring->sq_tail;
+  uint32_t index = tail & ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  // READV rather than READ, it's supported since io_uring was introduced
+  sqe->opcode = IORING_OP_READV;
+  sqe->fd = fileno(request->file);
+  sqe->off = request->bytes_read;
+  sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+  sqe->len = 1;
+  sqe->user_data = (uint64_t)(uintptr_t)request;
+  ring->sq_array[index] = index;
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void ring_worker(file_io_queue *queue) {
+  io_ring *ring = &queue->ring;
+  // Reads in the ring, submitted or not
+  uint32_t in_flight = 0;
+  // Prepared since the last io_uring_enter
+  uint32_t unsubmitted = 0;
+  std::vector<file_read_request *> batch;
+  for (;;) {
+    batch.clear();
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      // Only sleep here when there's nothing to reap from the kernel
+      if (in_flight == 0) {
+        queue->work_ready.wait(lock, [queue] {
+          return !queue->submitted.empty() || queue->shutting_down;
+        });
+        if (queue->submitted.empty()) {
+          return;
+        }
+      }
+      // Take as much as fits in the ring, oldest first
+      size_t count = queue->submitted.size();
+      size_t space = ring->sq_entries - in_flight;
+      count = count < space ? count : space;
+      for (size_t i = 0; i < count; i++) {
+        batch.push_back(&queue->requests[queue->submitted[i]]);
+      }
+      queue->submitted.erase(queue->submitted.begin(),
+                             queue->submitted.begin() + count);
+    }
+
+    for (file_read_request *request : batch) {
+      if (begin_request(queue, request)) {
+        io_ring_prepare_read(ring, request);
+        in_flight++;
+        unsubmitted++;
+      }
+    }
+    if (in_flight == 0) {
+      continue;
+    }
+
+    // Submits the whole batch and waits for at least one completion in a
+    // single syscall
+    int result = (int)syscall(__NR_io_uring_enter, ring->fd, unsubmitted, 1,
+                              IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (result >= 0) {
+      unsubmitted -= (uint32_t)result < unsubmitted ? (uint32_t)result
+                                                    : unsubmitted;
+    } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      OE_LOG(LOG_LEVEL_ERROR, "io_uring_enter failed: %s", strerror(errno));
+    }
+
+    uint32_t head = *ring->cq_head;
+    uint32_t tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    std::vector<file_read_request *> short_reads;
+    for (; head != tail; head++) {
+      const struct io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+      file_read_request *request =
+          (file_read_request *)(uintptr_t)cqe->user_data;
+      in_flight--;
+      if (cqe->res <= 0) {
+        // Errors and files truncated since fstat
+        finish_request(queue, request, false);
+        continue;
+      }
+      request->bytes_read += (size_t)cqe->res;
+      if (request->bytes_read < request->result.size) {
+        short_reads.push_back(request);
+      } else {
+        finish_request(queue, request, true);
+      }
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    // The rest of short reads go out with the next submit
+    for (file_read_request *request : short_reads) {
+      io_ring_prepare_read(ring, request);
+      in_flight++;
+      unsubmitted++;
+    }
+  }
+}
+
+bool filesystem_io_queue_create(file_io_backend backend, uint32_t depth,
+                                file_io_queue **out_queue) {
+  file_io_queue *queue = new file_io_queue();
+  queue->depth = depth ? depth : FILE_IO_DEFAULT_DEPTH;
+  queue->shutting_down = false;
+
+  if (backend != FILE_IO_BACKEND_THREADS &&
+      io_ring_create(queue->depth, &queue->ring)) {
+    queue->backend = FILE_IO_BACKEND_IO_URING;
+    queue->threads.emplace_back(ring_worker, queue);
+  } else if (backend == FILE_IO_BACKEND_IO_URING) {
+    OE_LOG(LOG_LEVEL_ERROR, "io_uring is not available");
+    delete queue;
+    return false;
+  } else {
+    queue->backend = FILE_IO_BACKEND_THREADS;
+    uint32_t thread_count = std::thread::hardware_concurrency();
+    thread_count = thread_count > 2 ? thread_count : 2;
+    thread_count =
+        thread_count < FILE_IO_MAX_THREADS ? thread_count : FILE_IO_MAX_THREADS;
+    thread_count = thread_count < queue->depth ? thread_count : queue->depth;
+    for (uint32_t i = 0; i < thread_count; i++) {
+      queue->threads.emplace_back(read_worker, queue);
+    }
+  }
+
+  *out_queue = queue;
+  return true;
+}
+
+void filesystem_io_queue_destroy(file_io_queue *queue) {
+  filesystem_io_submit(queue);
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->shutting_down = true;
+  }
+  queue->work_ready.notify_all();
+  for (auto &thread : queue->threads) {
+    thread.join();
+  }
+  io_ring_destroy(&queue->ring);
+
+  for (auto &request : queue->requests) {
+    if (!request.claimed) {
+      free(request.result.data);
+    }
+  }
+  delete queue;
+}
+
+file_io_backend filesystem_io_queue_backend(file_io_queue *queue) {
+  return queue->backend;
+}
+
+file_read_id filesystem_read_async(file_io_queue *queue, const char *path,
+                                   file_read_callback callback,
+                                   void *user_data) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  file_read_id id = (file_read_id)queue->requests.size();
+  queue->requests.emplace_back();
+  file_read_request *request = &queue->requests.back();
+  request->id = id;
+  request->path = path;
+  request->callback = callback;
+  request->user_data = user_data;
+  request->result = {};
+  request->file = nullptr;
+  request->bytes_read = 0;
+  request->complete = false;
+  request->claimed = false;
+  queue->queued.push_back(id);
+  return id;
+}
+
+void filesystem_io_submit(file_io_queue *queue) {
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->queued.empty()) {
+      return;
+    }
+    queue->submitted.insert(queue->submitted.end(), queue->queued.begin(),
+                            queue->queued.end());
+    queue->queued.clear();
+  }
+  queue->work_ready.notify_all();
+}
+
+bool filesystem_io_wait(file_io_queue *queue, file_read_id id,
+                        file_read_result *out_result) {
+  filesystem_io_submit(queue);
+
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  if (id >= queue->requests.size() || queue->requests[id].claimed) {
+    *out_result = {};
+    return false;
+  }
+  file_read_request *request = &queue->requests[id];
+  queue->read_complete.wait(lock, [request] { return request->complete; });
+  request->claimed = true;
+  *out_result = request->result;
+  request->result.data = nullptr;
+  return out_result->success;
+}
@@ -0,0 +1,72 @@
+#include "engine/frame_limiter.h"
+
+#include <chrono>
+#include <thread>
+
+#include "engine/logger.h"
+#include "engine/platform.h"
+
+void frame_limiter_create(double frames_per_second,
+                          frame_limiter* out_limiter) {
+  *out_limiter = {};
+  frame_limiter_set_rate(out_limiter, frames_per_second);
+}
+
+void frame_limiter_set_rate(frame_limiter* limiter, double frames_per_second) {
+  limiter->interval = frames_per_second > 0.0 ? 1.0 / frames_per_second : 0.0;
+  // Starts the schedule over from the next wait
+  limiter->deadline = 0.0;
+}
+
+void frame_limiter_wait(frame_limiter* limiter) {
+  limiter->frame_count++;
+  if (limiter->interval == 0.0) {
+    return;
+  }
+
+  double now = platform_get_absolute_time();
+  if (limiter->deadline == 0.0) {
+    limiter->deadline = now + limiter->interval;
+    return;
+  }
+
+  double remaining = limiter->deadline - now;
+  if (remaining > FRAME_LIMITER_SPIN_SECONDS) {
+    std::this_thread::sleep_for(std::chrono::duration<double>(
+        remaining - FRAME_LIMITER_SPIN_SECONDS));
+    double slept = platform_get_absolute_time();
+    limiter->sleep_seconds += slept - now;
+    now = slept;
+  }
+  if (now < limiter->deadline) {
+    double spin_start = now;
+    while (now < limiter->deadline) {
+      now = platform_get_absolute_time();
+    }
+    limiter->spin_seconds += now - spin_start;
+  }
+
+  // Deadlines advance by the interval so the rate doesn't drift, but a frame
+  // that's over a whole interval late restarts the schedule rather than
+  // letting the next ones run uncapped to catch up
+  if (now - limiter->deadline > limiter->interval) {
+    limiter->late_count++;
+    limiter->deadline = now + limiter->interval;
+  } else {
+    limiter->deadline += limiter->interval;
+  }
+}
+
+void frame_limiter_log_stats(const frame_limiter* limiter) {
+  if (limiter->interval == 0.0) {
+    OE_LOG(LOG_LEVEL_INFO, "Frame limiter: unlimited, %llu frames",
+           (unsigned long long)limiter->frame_count);
+    return;
+  }
+  OE_LOG(LOG_LEVEL_INFO,
+         "Frame limiter: %.1f fps cap, %llu frames, %llu late, slept %.3f s, "
+         "spun %.3f s",
+         1.0 / limiter->interval, (unsigned long long)limiter->frame_count,
+         (unsigned long long)limiter->late_count, limiter->sleep_seconds,
+         limiter->spin_seconds);
+}
@@ -0,0 +1,187 @@
+#include "engine/geometry/mesh_cache.h"
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <cstring>
+
+#include "engine/filesystem.h"
+#include "engine/logger.h"
+
+// FNV-1a, only used to tie a cache back to the path it was built from
+static uint64_t hash_path(const std::string &path) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : path) {
+    hash ^= c;
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static uint64_t align_offset(uint64_t offset) {
+  return (offset + MESH_CACHE_BLOB_ALIGNMENT - 1) &
+         ~(uint64_t)(MESH_CACHE_BLOB_ALIGNMENT - 1);
+}
+
+static bool stat_source(const std::string &source_path, int64_t *out_mtime,
+                        uint64_t *out_size) {
+  struct stat source_stat;
+  if (stat(source_path.c_str(), &source_stat) != 0) {
+    return false;
+  }
+  *out_mtime = (int64_t)source_stat.st_mtime;
+  *out_size = (uint64_t)source_stat.st_size;
+  return true;
+}
+
+// Checks the layout of a cache and points geometry into it
+static bool read_geometry(const void *data, size_t size,
+                          mesh_geometry *out_geometry) {
+  if (size < sizeof(mesh_cache_header)) {
+    return false;
+  }
+  const mesh_cache_header *header = (const mesh_cache_header *)data;
+  bool valid = header->magic == MESH_CACHE_MAGIC &&
+               header->version == MESH_CACHE_VERSION &&
+               header->vertex_stride == sizeof(Vertex) &&
+               (header->index_stride == sizeof(uint16_t) ||
+                header->index_stride == sizeof(uint32_t)) &&
+               header->vertex_offset + (uint64_t)header->vertex_count *
+                                           header->vertex_stride <=
+                   size &&
+               header->index_offset + (uint64_t)header->index_count *
+                                          header->index_stride <=
+                   size;
+  if (!valid) {
+    return false;
+  }
+
+  const char *base = (const char *)data;
+  out_geometry->vertices = (const Vertex *)(base + header->vertex_offset);
+  out_geometry->vertex_count = header->vertex_count;
+  out_geometry->indices = base + header->index_offset;
+  out_geometry->index_count = header->index_count;
+  out_geometry->index_stride = header->index_stride;
+  out_geometry->bounds_min = {header->bounds_min[0], header->bounds_min[1],
+                              header->bounds_min[2]};
+  out_geometry->bounds_max = {header->bounds_max[0], header->bounds_max[1],
+                              header->bounds_max[2]};
+  return true;
+}
+
+std::string mesh_cache_path(const std::string &source_path) {
+  return source_path + MESH_CACHE_EXTENSION;
+}
+
+bool mesh_cache_load(const std::string &source_path,
+                     mesh_cache_file *out_file) {
+  *out_file = {};
+
+  int64_t source_mtime;
+  uint64_t source_size;
+  if (!stat_source(source_path, &source_mtime, &source_size)) {
+    return false;
+  }
+
+  std::string cache_path = mesh_cache_path(source_path);
+  // We're about to stream the whole thing into a staging buffer
+  file_mapping mapping;
+  if (!filesystem_map(cache_path.c_str(),
+                      FILE_MAP_HINT_SEQUENTIAL | FILE_MAP_HINT_WILLNEED,
+                      &mapping)) {
+    // No cache yet, not an error
+    return false;
+  }
+  const mesh_cache_header *header = (const mesh_cache_header *)mapping.data;
+  bool valid = mapping.size >= sizeof(mesh_cache_header) &&
+               header->source_path_hash == hash_path(source_path) &&
+               header->source_mtime == source_mtime &&
+               header->source_size == source_size &&
+               read_geometry(mapping.data, mapping.size, &out_file->geometry);
+  if (!valid) {
+    OE_LOG(LOG_LEVEL_INFO, "Mesh cache '%s' is stale, rebuilding",
+           cache_path.c_str());
+    filesystem_unmap(&mapping);
+    out_file->geometry = {};
+    return false;
+  }
+
+  out_file->mapping = mapping;
+  out_file->is_valid = true;
+  return true;
+}
+
+bool mesh_cache_load_memory(const void *data, size_t size,
+                            mesh_geometry *out_geometry) {
+  *out_geometry = {};
+  if (!read_geometry(data, size, out_geometry)) {
+    *out_geometry = {};
+    return false;
+  }
+  return true;
+}
+
+bool mesh_cache_write(const std::string &source_path,
+                      const mesh_geometry *geometry) {
+  mesh_cache_header header{};
+  header.magic = MESH_CACHE_MAGIC;
+  header.version = MESH_CACHE_VERSION;
+  header.source_path_hash = hash_path(source_path);
+  if (!stat_source(source_path, &header.source_mtime, &header.source_size)) {
+    OE_LOG(LOG_LEVEL_ERROR, "Unable to stat mesh source: '%s'",
+           source_path.c_str());
+    return false;
+  }
+  header.vertex_stride = sizeof(Vertex);
+  header.vertex_count = geometry->vertex_count;
+  header.index_stride = geometry->index_stride;
+  header.index_count = geometry->index_count;
+  header.vertex_offset = align_offset(sizeof(mesh_cache_header));
+  header.index_offset = align_offset(
+      header.vertex_offset + (uint64_t)header.vertex_count * sizeof(Vertex));
+  for (int i = 0; i < 3; i++) {
+    header.bounds_min[i] = geometry->bounds_min[i];
+    header.bounds_max[i] = geometry->bounds_max[i];
+  }
+
+  std::string cache_path = mesh_cache_path(source_path);
+  std::string temp_path = cache_path + ".tmp";
+  file_handle handle;
+  if (!filesystem_open(temp_path.c_str(), FILE_MODE_WRITE, true, &handle)) {
+    return false;
+  }
+
+  static const char padding[MESH_CACHE_BLOB_ALIGNMENT] = {};
+  long written = 0;
+  long vertex_bytes = (long)(header.vertex_count * sizeof(Vertex));
+  long index_bytes = (long)(header.index_count * header.index_stride);
+  long vertex_padding =
+      (long)(header.vertex_offset - sizeof(mesh_cache_header));
+  long index_padding =
+      (long)(header.index_offset - header.vertex_offset - vertex_bytes);
+
+  bool ok =
+      filesystem_write(&handle, sizeof(header), &header, &written) &&
+      (vertex_padding == 0 ||
+       filesystem_write(&handle, vertex_padding, padding, &written)) &&
+      (vertex_bytes == 0 ||
+       filesystem_write(&handle, vertex_bytes, geometry->vertices, &written)) &&
+      (index_padding == 0 ||
+       filesystem_write(&handle, index_padding, padding, &written)) &&
+      (index_bytes == 0 ||
+       filesystem_write(&handle, index_bytes, geometry->indices, &written));
+  filesystem_close(&handle);
+
+  if (!ok || rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to write mesh cache: '%s'",
+           cache_path.c_str());
+    remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void mesh_cache_close(mesh_cache_file *file) {
+  filesystem_unmap(&file->mapping);
+  *file = {};
+}
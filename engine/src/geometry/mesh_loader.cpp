@@ -0,0 +1,241 @@
+#include "engine/geometry/mesh_loader.h"
+
+#include "engine/filesystem.h"
+#include "engine/geometry/mesh_optimizer.h"
+#include "engine/geometry/obj_parser.h"
+#include "engine/geometry/vertex_welder.h"
+#include "engine/logger.h"
+#include "engine/platform.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "engine/resources/tiny_obj_loader.h"
+
+static bool parse_obj_tinyobj(const std::string& path, obj_data* out_data) {
+  tinyobj::attrib_t attributes;
+  std::vector<tinyobj::shape_t> shapes;
+  std::vector<tinyobj::material_t> materials;
+  std::string warn, err;
+
+  if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err,
+                        path.c_str())) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to load mesh '%s': %s%s", path.c_str(),
+           warn.c_str(), err.c_str());
+    return false;
+  }
+
+  out_data->positions.swap(attributes.vertices);
+  out_data->texcoords.swap(attributes.texcoords);
+  out_data->normals.swap(attributes.normals);
+  out_data->indices.clear();
+  for (const auto& shape : shapes) {
+    for (const auto& index : shape.mesh.indices) {
+      out_data->indices.push_back(
+          {index.vertex_index, index.texcoord_index, index.normal_index});
+    }
+  }
+  return true;
+}
+
+static bool parse_obj_parallel(const std::string& path, obj_data* out_data) {
+  file_mapping mapping;
+  if (!filesystem_map(path.c_str(), FILE_MAP_HINT_SEQUENTIAL, &mapping)) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to open mesh '%s'", path.c_str());
+    return false;
+  }
+
+  obj_parse_result result = obj_parser_parse((const char*)mapping.data,
+                                             mapping.size, 0, out_data);
+  filesystem_unmap(&mapping);
+
+  if (result == OBJ_PARSE_UNSUPPORTED) {
+    OE_LOG(LOG_LEVEL_INFO,
+           "Mesh '%s' has polygons the parallel parser can't triangulate, "
+           "using tinyobj",
+           path.c_str());
+    return parse_obj_tinyobj(path, out_data);
+  }
+  return result == OBJ_PARSE_SUCCESS;
+}
+
+// Builds the vertex and index buffers from the flattened face corners. Every
+// corner becomes a vertex, which the welder then deduplicates.
+static bool build_vertices(const obj_data* data, std::vector<Vertex>* vertices,
+                           std::vector<uint32_t>* indices) {
+  size_t position_count = data->positions.size() / 3;
+  size_t texcoord_count = data->texcoords.size() / 2;
+
+  std::vector<Vertex> corners;
+  corners.reserve(data->indices.size());
+  for (const auto& index : data->indices) {
+    if (index.vertex_index < 0 ||
+        (size_t)index.vertex_index >= position_count ||
+        (index.texcoord_index >= 0 &&
+         (size_t)index.texcoord_index >= texcoord_count)) {
+      OE_LOG(LOG_LEVEL_ERROR, "Mesh face index out of range");
+      return false;
+    }
+
+    Vertex vertex{};
+
+    vertex.pos = {data->positions[3 * index.vertex_index + 0],
+                  data->positions[3 * index.vertex_index + 1],
+                  data->positions[3 * index.vertex_index + 2]};
+
+    // Faces without texture coordinates get (0, 0)
+    if (index.texcoord_index >= 0) {
+      vertex.tex_coord = {
+          data->texcoords[2 * index.texcoord_index + 0],
+          1.0f - data->texcoords[2 * index.texcoord_index + 1]};
+    } else {
+      vertex.tex_coord = {0.0f, 1.0f};
+    }
+
+    vertex.color = {1.0f, 1.0f, 1.0f};
+    corners.push_back(vertex);
+  }
+
+  vertex_weld_config config = {};
+  config.epsilon = 0.0f;
+  config.thread_count = 0;
+  vertex_weld_stats stats;
+  vertex_welder_weld(corners.data(), static_cast<uint32_t>(corners.size()),
+                     &config, vertices, indices, &stats);
+  OE_LOG(LOG_LEVEL_INFO, "Welded %u vertices into %u in %.3f ms (%u threads)",
+         stats.input_vertex_count, stats.output_vertex_count, stats.elapsed_ms,
+         stats.thread_count);
+  return true;
+}
+
+bool mesh_loader_parse_obj(const std::string& path, mesh_obj_parser parser,
+                           std::vector<Vertex>* out_vertices,
+                           std::vector<uint32_t>* out_indices) {
+  out_vertices->clear();
+  out_indices->clear();
+
+  obj_data data;
+  bool parsed = parser == MESH_OBJ_PARSER_TINYOBJ
+                    ? parse_obj_tinyobj(path, &data)
+                    : parse_obj_parallel(path, &data);
+  if (!parsed) {
+    return false;
+  }
+  return build_vertices(&data, out_vertices, out_indices);
+}
+
+// Narrows the indices to 16 bits when the mesh is small enough, halving the
+// index buffer. The 32 bit indices are freed in that case.
+static void select_index_width(mesh_asset* mesh) {
+  if (mesh->vertices.size() > (size_t)UINT16_MAX + 1) {
+    mesh->geometry.indices = mesh->indices.data();
+    mesh->geometry.index_stride = sizeof(uint32_t);
+    return;
+  }
+  mesh->short_indices.assign(mesh->indices.begin(), mesh->indices.end());
+  std::vector<uint32_t>().swap(mesh->indices);
+  mesh->geometry.indices = mesh->short_indices.data();
+  mesh->geometry.index_stride = sizeof(uint16_t);
+}
+
+static void compute_bounds(mesh_geometry* geometry) {
+  if (geometry->vertex_count == 0) {
+    geometry->bounds_min = glm::vec3(0.0f);
+    geometry->bounds_max = glm::vec3(0.0f);
+    return;
+  }
+  geometry->bounds_min = geometry->vertices[0].pos;
+  geometry->bounds_max = geometry->vertices[0].pos;
+  for (uint32_t i = 1; i < geometry->vertex_count; i++) {
+    geometry->bounds_min =
+        glm::min(geometry->bounds_min, geometry->vertices[i].pos);
+    geometry->bounds_max =
+        glm::max(geometry->bounds_max, geometry->vertices[i].pos);
+  }
+}
+
+bool mesh_loader_load(const std::string& path, bool use_cache,
+                      mesh_asset* out_mesh) {
+  double start_time = platform_get_absolute_time();
+
+  out_mesh->vertices.clear();
+  out_mesh->indices.clear();
+  out_mesh->short_indices.clear();
+  out_mesh->cache = {};
+  out_mesh->geometry = {};
+  out_mesh->from_cache = false;
+
+  // Warm path, the mapped cache is uploaded from directly
+  if (use_cache && mesh_cache_load(path, &out_mesh->cache)) {
+    out_mesh->geometry = out_mesh->cache.geometry;
+    out_mesh->from_cache = true;
+    OE_LOG(LOG_LEVEL_INFO,
+           "Loaded mesh '%s' from cache in %.3f ms (%u vertices, %u %u-bit "
+           "indices)",
+           path.c_str(), (platform_get_absolute_time() - start_time) * 1000.0,
+           out_mesh->geometry.vertex_count, out_mesh->geometry.index_count,
+           out_mesh->geometry.index_stride * 8);
+    return true;
+  }
+
+  // Cold path
+  if (!mesh_loader_parse_obj(path, MESH_OBJ_PARSER_PARALLEL,
+                             &out_mesh->vertices, &out_mesh->indices)) {
+    return false;
+  }
+
+  mesh_optimize_stats optimize_stats;
+  mesh_optimizer_optimize(&out_mesh->vertices, &out_mesh->indices,
+                          &optimize_stats);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Optimized mesh '%s' in %.3f ms: ACMR %.3f -> %.3f, ATVR %.3f -> "
+         "%.3f%s",
+         path.c_str(), optimize_stats.elapsed_ms, optimize_stats.before.acmr,
+         optimize_stats.after.acmr, optimize_stats.before.atvr,
+         optimize_stats.after.atvr,
+         optimize_stats.overdraw_applied ? "" : " (overdraw pass skipped)");
+
+  mesh_geometry* geometry = &out_mesh->geometry;
+  geometry->vertices = out_mesh->vertices.data();
+  geometry->vertex_count = static_cast<uint32_t>(out_mesh->vertices.size());
+  geometry->index_count = static_cast<uint32_t>(out_mesh->indices.size());
+  select_index_width(out_mesh);
+  compute_bounds(geometry);
+
+  if (use_cache && !mesh_cache_write(path, geometry)) {
+    OE_LOG(LOG_LEVEL_WARN, "Unable to cache mesh '%s'", path.c_str());
+  }
+
+  OE_LOG(LOG_LEVEL_INFO,
+         "Parsed mesh '%s' in %.3f ms (%u vertices, %u %u-bit indices)",
+         path.c_str(), (platform_get_absolute_time() - start_time) * 1000.0,
+         geometry->vertex_count, geometry->index_count,
+         geometry->index_stride * 8);
+  return true;
+}
+
+bool mesh_loader_load_memory(const char* name, const void* data, size_t size,
+                             mesh_asset* out_mesh) {
+  out_mesh->vertices.clear();
+  out_mesh->indices.clear();
+  out_mesh->short_indices.clear();
+  out_mesh->cache = {};
+  out_mesh->from_cache = false;
+
+  if (!mesh_cache_load_memory(data, size, &out_mesh->geometry)) {
+    OE_LOG(LOG_LEVEL_ERROR, "Mesh '%s' is not a valid mesh cache", name);
+    return false;
+  }
+  out_mesh->from_cache = true;
+  OE_LOG(LOG_LEVEL_INFO, "Loaded mesh '%s' (%u vertices, %u %u-bit indices)",
+         name, out_mesh->geometry.vertex_count, out_mesh->geometry.index_count,
+         out_mesh->geometry.index_stride * 8);
+  return true;
+}
+
+void mesh_loader_release(mesh_asset* mesh) {
+  mesh_cache_close(&mesh->cache);
+  std::vector<Vertex>().swap(mesh->vertices);
+  std::vector<uint32_t>().swap(mesh->indices);
+  std::vector<uint16_t>().swap(mesh->short_indices);
+  mesh->geometry.vertices = nullptr;
+  mesh->geometry.indices = nullptr;
+}
@@ -0,0 +1,292 @@
+#include "engine/geometry/mesh_optimizer.h"
+
+#include <algorithm>
+
+#include "engine/platform.h"
+
+#define MESH_OPTIMIZER_UNUSED UINT32_MAX
+
+vertex_cache_stats mesh_optimizer_analyze_vertex_cache(
+    const uint32_t *indices, uint32_t index_count, uint32_t vertex_count,
+    uint32_t cache_size) {
+  vertex_cache_stats stats = {};
+  if (index_count < 3 || vertex_count == 0) {
+    return stats;
+  }
+
+  // A vertex is cached if fewer than cache_size misses happened since it was
+  // last loaded. Timestamps start far enough back to be a miss.
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  uint32_t misses = 0;
+  std::vector<bool> used(vertex_count, false);
+  uint32_t used_count = 0;
+  for (uint32_t i = 0; i < index_count; i++) {
+    uint32_t vertex = indices[i];
+    if (time - cache_time[vertex] > cache_size) {
+      cache_time[vertex] = time++;
+      misses++;
+    }
+    if (!used[vertex]) {
+      used[vertex] = true;
+      used_count++;
+    }
+  }
+
+  stats.acmr = (float)misses / (float)(index_count / 3);
+  stats.atvr = (float)misses / (float)used_count;
+  return stats;
+}
+
+// Tipsify's next fanning vertex. Prefers the candidate whose remaining
+// triangles will still find it in the cache, else the most recently used.
+static uint32_t tipsify_next_vertex(
+    const std::vector<uint32_t> &candidates,
+    const std::vector<uint32_t> &live_triangles,
+    const std::vector<uint32_t> &cache_time, uint32_t time,
+    uint32_t cache_size, std::vector<uint32_t> *dead_ends,
+    uint32_t *cursor) {
+  uint32_t best = MESH_OPTIMIZER_UNUSED;
+  int64_t best_priority = -1;
+  for (uint32_t vertex : candidates) {
+    if (live_triangles[vertex] == 0) {
+      continue;
+    }
+    int64_t priority = 0;
+    // Would the vertex still be cached after emitting its remaining fan?
+    if (time - cache_time[vertex] + 2 * live_triangles[vertex] <= cache_size) {
+      priority = time - cache_time[vertex];
+    }
+    if (priority > best_priority) {
+      best_priority = priority;
+      best = vertex;
+    }
+  }
+  if (best != MESH_OPTIMIZER_UNUSED) {
+    return best;
+  }
+
+  // Dead end, back up to a recently emitted vertex with triangles left
+  while (!dead_ends->empty()) {
+    uint32_t vertex = dead_ends->back();
+    dead_ends->pop_back();
+    if (live_triangles[vertex] > 0) {
+      return vertex;
+    }
+  }
+  // Then scan forward through the input order
+  while (*cursor < live_triangles.size()) {
+    if (live_triangles[*cursor] > 0) {
+      return *cursor;
+    }
+    (*cursor)++;
+  }
+  return MESH_OPTIMIZER_UNUSED;
+}
+
+void mesh_optimizer_optimize_vertex_cache(std::vector<uint32_t> *indices,
+                                          uint32_t vertex_count,
+                                          uint32_t cache_size) {
+  uint32_t triangle_count = (uint32_t)(indices->size() / 3);
+  if (triangle_count == 0 || vertex_count == 0) {
+    return;
+  }
+  const uint32_t *source = indices->data();
+
+  // Vertex to triangle adjacency, as offsets into one flat array
+  std::vector<uint32_t> live_triangles(vertex_count, 0);
+  for (uint32_t i = 0; i < triangle_count * 3; i++) {
+    live_triangles[source[i]]++;
+  }
+  std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+  for (uint32_t i = 0; i < vertex_count; i++) {
+    adjacency_offsets[i + 1] = adjacency_offsets[i] + live_triangles[i];
+  }
+  std::vector<uint32_t> adjacency(triangle_count * 3);
+  std::vector<uint32_t> fill(adjacency_offsets.begin(),
+                             adjacency_offsets.end() - 1);
+  for (uint32_t triangle = 0; triangle < triangle_count; triangle++) {
+    for (uint32_t corner = 0; corner < 3; corner++) {
+      adjacency[fill[source[triangle * 3 + corner]]++] = triangle;
+    }
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangle_count * 3);
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  std::vector<bool> emitted(triangle_count, false);
+  std::vector<uint32_t> dead_ends;
+  std::vector<uint32_t> candidates;
+  uint32_t cursor = 0;
+
+  uint32_t fan = 0;
+  while (fan != MESH_OPTIMIZER_UNUSED) {
+    candidates.clear();
+    for (uint32_t i = adjacency_offsets[fan]; i < adjacency_offsets[fan + 1];
+         i++) {
+      uint32_t triangle = adjacency[i];
+      if (emitted[triangle]) {
+        continue;
+      }
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        uint32_t vertex = source[triangle * 3 + corner];
+        output.push_back(vertex);
+        dead_ends.push_back(vertex);
+        candidates.push_back(vertex);
+        live_triangles[vertex]--;
+        if (time - cache_time[vertex] > cache_size) {
+          cache_time[vertex] = time++;
+        }
+      }
+      emitted[triangle] = true;
+    }
+    fan = tipsify_next_vertex(candidates, live_triangles, cache_time, time,
+                              cache_size, &dead_ends, &cursor);
+  }
+
+  indices->swap(output);
+}
+
+typedef struct overdraw_cluster {
+  uint32_t first_triangle;
+  uint32_t triangle_count;
+  float sort_key;
+} overdraw_cluster;
+
+bool mesh_optimizer_optimize_overdraw(std::vector<uint32_t> *indices,
+                                      const std::vector<Vertex> &vertices,
+                                      uint32_t cache_size, float threshold) {
+  uint32_t triangle_count = (uint32_t)(indices->size() / 3);
+  uint32_t vertex_count = (uint32_t)vertices.size();
+  if (triangle_count == 0) {
+    return false;
+  }
+  const uint32_t *source = indices->data();
+
+  // Cut a cluster wherever a triangle misses the cache on all three
+  // vertices, moving it elsewhere then barely changes the miss count
+  std::vector<overdraw_cluster> clusters;
+  std::vector<uint32_t> cache_time(vertex_count, 0);
+  uint32_t time = cache_size + 1;
+  for (uint32_t triangle = 0; triangle < triangle_count; triangle++) {
+    uint32_t misses = 0;
+    for (uint32_t corner = 0; corner < 3; corner++) {
+      uint32_t vertex = source[triangle * 3 + corner];
+      if (time - cache_time[vertex] > cache_size) {
+        cache_time[vertex] = time++;
+        misses++;
+      }
+    }
+    if (clusters.empty() || misses == 3) {
+      clusters.push_back({triangle, 0, 0.0f});
+    }
+    clusters.back().triangle_count++;
+  }
+  if (clusters.size() < 2) {
+    return false;
+  }
+
+  // Area weighted centroids and normals
+  glm::vec3 mesh_centroid(0.0f);
+  float mesh_area = 0.0f;
+  std::vector<glm::vec3> cluster_centroids(clusters.size(), glm::vec3(0.0f));
+  std::vector<glm::vec3> cluster_normals(clusters.size(), glm::vec3(0.0f));
+  for (size_t c = 0; c < clusters.size(); c++) {
+    float cluster_area = 0.0f;
+    uint32_t end = clusters[c].first_triangle + clusters[c].triangle_count;
+    for (uint32_t triangle = clusters[c].first_triangle; triangle < end;
+         triangle++) {
+      const glm::vec3 &a = vertices[source[triangle * 3 + 0]].pos;
+      const glm::vec3 &b = vertices[source[triangle * 3 + 1]].pos;
+      const glm::vec3 &p = vertices[source[triangle * 3 + 2]].pos;
+      glm::vec3 normal = glm::cross(b - a, p - a);
+      float area = glm::length(normal);
+      glm::vec3 centroid = (a + b + p) * (area / 3.0f);
+      cluster_centroids[c] += centroid;
+      cluster_normals[c] += normal;
+      cluster_area += area;
+    }
+    mesh_centroid += cluster_centroids[c];
+    mesh_area += cluster_area;
+    if (cluster_area > 0.0f) {
+      cluster_centroids[c] = cluster_centroids[c] / cluster_area;
+    }
+  }
+  if (mesh_area > 0.0f) {
+    mesh_centroid = mesh_centroid / mesh_area;
+  }
+
+  for (size_t c = 0; c < clusters.size(); c++) {
+    float normal_length = glm::length(cluster_normals[c]);
+    if (normal_length > 0.0f) {
+      clusters[c].sort_key =
+          glm::dot(cluster_centroids[c] - mesh_centroid,
+                   cluster_normals[c] / normal_length);
+    }
+  }
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const overdraw_cluster &a, const overdraw_cluster &b) {
+                     return a.sort_key > b.sort_key;
+                   });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices->size());
+  for (const auto &cluster : clusters) {
+    output.insert(output.end(), source + cluster.first_triangle * 3,
+                  source + (cluster.first_triangle + cluster.triangle_count) *
+                               3);
+  }
+
+  vertex_cache_stats before = mesh_optimizer_analyze_vertex_cache(
+      source, (uint32_t)indices->size(), vertex_count, cache_size);
+  vertex_cache_stats after = mesh_optimizer_analyze_vertex_cache(
+      output.data(), (uint32_t)output.size(), vertex_count, cache_size);
+  if (after.acmr > before.acmr * threshold) {
+    return false;
+  }
+  indices->swap(output);
+  return true;
+}
+
+void mesh_optimizer_optimize_vertex_fetch(std::vector<Vertex> *vertices,
+                                          std::vector<uint32_t> *indices) {
+  std::vector<uint32_t> remap(vertices->size(), MESH_OPTIMIZER_UNUSED);
+  std::vector<Vertex> output;
+  output.reserve(vertices->size());
+  for (uint32_t &index : *indices) {
+    if (remap[index] == MESH_OPTIMIZER_UNUSED) {
+      remap[index] = (uint32_t)output.size();
+      output.push_back((*vertices)[index]);
+    }
+    index = remap[index];
+  }
+  vertices->swap(output);
+}
+
+void mesh_optimizer_optimize(std::vector<Vertex> *vertices,
+                             std::vector<uint32_t> *indices,
+                             mesh_optimize_stats *out_stats) {
+  double start_time = platform_get_absolute_time();
+  uint32_t vertex_count = (uint32_t)vertices->size();
+  vertex_cache_stats before = mesh_optimizer_analyze_vertex_cache(
+      indices->data(), (uint32_t)indices->size(), vertex_count,
+      MESH_OPTIMIZER_CACHE_SIZE);
+
+  mesh_optimizer_optimize_vertex_cache(indices, vertex_count,
+                                       MESH_OPTIMIZER_CACHE_SIZE);
+  bool overdraw_applied = mesh_optimizer_optimize_overdraw(
+      indices, *vertices, MESH_OPTIMIZER_CACHE_SIZE,
+      MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+  mesh_optimizer_optimize_vertex_fetch(vertices, indices);
+
+  if (out_stats) {
+    out_stats->before = before;
+    out_stats->after = mesh_optimizer_analyze_vertex_cache(
+        indices->data(), (uint32_t)indices->size(),
+        (uint32_t)vertices->size(), MESH_OPTIMIZER_CACHE_SIZE);
+    out_stats->overdraw_applied = overdraw_applied;
+    out_stats->elapsed_ms =
+        (platform_get_absolute_time() - start_time) * 1000.0;
+  }
+}
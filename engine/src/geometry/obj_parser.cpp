@@ -0,0 +1,521 @@
+#include "engine/geometry/obj_parser.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "engine/logger.h"
+
+// Chunks smaller than this aren't worth a thread
+#define OBJ_PARSER_MIN_CHUNK_SIZE (1 << 20)
+
+#define IS_SPACE(x) (((x) == ' ') || ((x) == '\t'))
+#define IS_DIGIT(x) \
+  (static_cast<unsigned int>((x) - '0') < static_cast<unsigned int>(10))
+
+typedef enum obj_record {
+  OBJ_RECORD_NONE,
+  OBJ_RECORD_POSITION,
+  OBJ_RECORD_TEXCOORD,
+  OBJ_RECORD_NORMAL,
+  OBJ_RECORD_FACE
+} obj_record;
+
+// A line aligned slice of the file, parsed by one thread
+typedef struct obj_chunk {
+  const char *begin;
+  const char *end;
+
+  // Record counts, so every chunk knows where its attributes land globally
+  size_t position_count;
+  size_t texcoord_count;
+  size_t normal_count;
+  size_t position_base;
+  size_t texcoord_base;
+  size_t normal_base;
+
+  // Face corners before triangulation and the size (3 or 4) of each face
+  std::vector<obj_index> corners;
+  std::vector<uint8_t> face_sizes;
+  std::vector<obj_index> triangles;
+  size_t index_base;
+
+  obj_parse_result result;
+} obj_chunk;
+
+// Finds the end of the line starting at p, and the start of the next one.
+// Lines end at '\n', '\r' or "\r\n", same as tinyobj's safeGetline.
+static const char *next_line(const char *p, const char *end,
+                             const char **out_line_end) {
+  const char *newline = (const char *)memchr(p, '\n', end - p);
+  const char *line_end = newline ? newline : end;
+  const char *carriage_return = (const char *)memchr(p, '\r', line_end - p);
+  if (carriage_return) {
+    *out_line_end = carriage_return;
+    if (carriage_return + 1 == newline) {
+      return newline + 1;
+    }
+    return carriage_return + 1;
+  }
+  *out_line_end = line_end;
+  return newline ? newline + 1 : end;
+}
+
+static const char *skip_space(const char *p, const char *end) {
+  while (p < end && IS_SPACE(*p)) p++;
+  return p;
+}
+
+static obj_record classify_line(const char *p, const char *end,
+                                const char **out_token) {
+  p = skip_space(p, end);
+  if (end - p < 2) {
+    return OBJ_RECORD_NONE;
+  }
+  if (p[0] == 'v') {
+    if (IS_SPACE(p[1])) {
+      *out_token = p + 2;
+      return OBJ_RECORD_POSITION;
+    }
+    if (end - p >= 3 && IS_SPACE(p[2])) {
+      *out_token = p + 3;
+      if (p[1] == 't') return OBJ_RECORD_TEXCOORD;
+      if (p[1] == 'n') return OBJ_RECORD_NORMAL;
+    }
+    return OBJ_RECORD_NONE;
+  }
+  if (p[0] == 'f' && IS_SPACE(p[1])) {
+    *out_token = p + 2;
+    return OBJ_RECORD_FACE;
+  }
+  return OBJ_RECORD_NONE;
+}
+
+// Mirrors tinyobj's tryParseDouble so both parsers produce the exact same
+// floats. Don't "improve" this without also dropping the tinyobj comparison.
+static bool try_parse_double(const char *s, const char *s_end,
+                             double *result) {
+  if (s >= s_end) {
+    return false;
+  }
+
+  double mantissa = 0.0;
+  int exponent = 0;
+  char sign = '+';
+  char exp_sign = '+';
+  const char *curr = s;
+  int read = 0;
+  bool end_not_reached = false;
+  bool leading_decimal_dots = false;
+
+  if (*curr == '+' || *curr == '-') {
+    sign = *curr;
+    curr++;
+    if ((curr != s_end) && (*curr == '.')) {
+      leading_decimal_dots = true;
+    }
+  } else if (IS_DIGIT(*curr)) {
+  } else if (*curr == '.') {
+    leading_decimal_dots = true;
+  } else {
+    return false;
+  }
+
+  end_not_reached = (curr != s_end);
+  if (!leading_decimal_dots) {
+    while (end_not_reached && IS_DIGIT(*curr)) {
+      mantissa *= 10;
+      mantissa += static_cast<int>(*curr - 0x30);
+      curr++;
+      read++;
+      end_not_reached = (curr != s_end);
+    }
+    if (read == 0) return false;
+  }
+
+  if (!end_not_reached) goto assemble;
+
+  if (*curr == '.') {
+    curr++;
+    read = 1;
+    end_not_reached = (curr != s_end);
+    while (end_not_reached && IS_DIGIT(*curr)) {
+      static const double pow_lut[] = {
+          1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001,
+      };
+      const int lut_entries = sizeof pow_lut / sizeof pow_lut[0];
+      mantissa += static_cast<int>(*curr - 0x30) *
+                  (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+      read++;
+      curr++;
+      end_not_reached = (curr != s_end);
+    }
+  } else if (*curr == 'e' || *curr == 'E') {
+  } else {
+    goto assemble;
+  }
+
+  if (!end_not_reached) goto assemble;
+
+  if (*curr == 'e' || *curr == 'E') {
+    curr++;
+    end_not_reached = (curr != s_end);
+    if (end_not_reached && (*curr == '+' || *curr == '-')) {
+      exp_sign = *curr;
+      curr++;
+    } else if (end_not_reached && IS_DIGIT(*curr)) {
+    } else {
+      return false;
+    }
+
+    read = 0;
+    end_not_reached = (curr != s_end);
+    while (end_not_reached && IS_DIGIT(*curr)) {
+      if (exponent > (2147483647 / 10)) {
+        return false;
+      }
+      exponent *= 10;
+      exponent += static_cast<int>(*curr - 0x30);
+      curr++;
+      read++;
+      end_not_reached = (curr != s_end);
+    }
+    exponent *= (exp_sign == '+' ? 1 : -1);
+    if (read == 0) return false;
+  }
+
+assemble:
+  *result = (sign == '+' ? 1 : -1) *
+            (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent)
+                      : mantissa);
+  return true;
+}
+
+static float parse_real(const char **token, const char *end) {
+  const char *p = skip_space(*token, end);
+  const char *value_end = p;
+  while (value_end < end && !IS_SPACE(*value_end)) value_end++;
+  double value = 0.0;
+  try_parse_double(p, value_end, &value);
+  *token = value_end;
+  return static_cast<float>(value);
+}
+
+// Bounded atoi
+static int parse_int(const char *p, const char *end) {
+  while (p < end && (IS_SPACE(*p) || *p == '\v' || *p == '\f')) p++;
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    p++;
+  }
+  long value = 0;
+  while (p < end && IS_DIGIT(*p)) {
+    value = value * 10 + (*p - '0');
+    p++;
+  }
+  return static_cast<int>(negative ? -value : value);
+}
+
+static const char *skip_index(const char *p, const char *end) {
+  while (p < end && *p != '/' && !IS_SPACE(*p)) p++;
+  return p;
+}
+
+// Make index zero based, and resolve relative (negative) indices
+static bool fix_index(int idx, size_t n, int *ret, bool allow_zero) {
+  if (idx > 0) {
+    *ret = idx - 1;
+    return true;
+  }
+  if (idx == 0) {
+    *ret = -1;
+    return allow_zero;
+  }
+  long resolved = static_cast<long>(n) + idx;
+  *ret = static_cast<int>(resolved);
+  return resolved >= 0;
+}
+
+// i, i/j, i//k, i/j/k
+static bool parse_triple(const char **token, const char *end, size_t v_count,
+                         size_t vt_count, size_t vn_count, obj_index *out) {
+  const char *p = *token;
+  obj_index corner = {-1, -1, -1};
+
+  if (!fix_index(parse_int(p, end), v_count, &corner.vertex_index, false)) {
+    return false;
+  }
+  p = skip_index(p, end);
+  if (p < end && *p == '/') {
+    p++;
+    if (p < end && *p == '/') {
+      // i//k
+      p++;
+      if (!fix_index(parse_int(p, end), vn_count, &corner.normal_index,
+                     true)) {
+        return false;
+      }
+      p = skip_index(p, end);
+    } else {
+      // i/j or i/j/k
+      if (!fix_index(parse_int(p, end), vt_count, &corner.texcoord_index,
+                     true)) {
+        return false;
+      }
+      p = skip_index(p, end);
+      if (p < end && *p == '/') {
+        p++;
+        if (!fix_index(parse_int(p, end), vn_count, &corner.normal_index,
+                       true)) {
+          return false;
+        }
+        p = skip_index(p, end);
+      }
+    }
+  }
+
+  *out = corner;
+  *token = p;
+  return true;
+}
+
+static void count_records(obj_chunk *chunk) {
+  const char *p = chunk->begin;
+  while (p < chunk->end) {
+    const char *line_end;
+    const char *next = next_line(p, chunk->end, &line_end);
+    const char *token;
+    switch (classify_line(p, line_end, &token)) {
+      case OBJ_RECORD_POSITION:
+        chunk->position_count++;
+        break;
+      case OBJ_RECORD_TEXCOORD:
+        chunk->texcoord_count++;
+        break;
+      case OBJ_RECORD_NORMAL:
+        chunk->normal_count++;
+        break;
+      default:
+        break;
+    }
+    p = next;
+  }
+}
+
+static void parse_records(obj_chunk *chunk, obj_data *out_data) {
+  float *positions = out_data->positions.data() + 3 * chunk->position_base;
+  float *texcoords = out_data->texcoords.data() + 2 * chunk->texcoord_base;
+  float *normals = out_data->normals.data() + 3 * chunk->normal_base;
+  // Counts as of the current line, for resolving relative indices
+  size_t v_count = chunk->position_base;
+  size_t vt_count = chunk->texcoord_base;
+  size_t vn_count = chunk->normal_base;
+
+  const char *p = chunk->begin;
+  while (p < chunk->end) {
+    const char *line_end;
+    const char *next = next_line(p, chunk->end, &line_end);
+    const char *token;
+    switch (classify_line(p, line_end, &token)) {
+      case OBJ_RECORD_POSITION:
+        for (int i = 0; i < 3; i++) *positions++ = parse_real(&token, line_end);
+        v_count++;
+        break;
+      case OBJ_RECORD_TEXCOORD:
+        for (int i = 0; i < 2; i++) *texcoords++ = parse_real(&token, line_end);
+        vt_count++;
+        break;
+      case OBJ_RECORD_NORMAL:
+        for (int i = 0; i < 3; i++) *normals++ = parse_real(&token, line_end);
+        vn_count++;
+        break;
+      case OBJ_RECORD_FACE: {
+        token = skip_space(token, line_end);
+        size_t corner_count = 0;
+        while (token < line_end) {
+          obj_index corner;
+          if (!parse_triple(&token, line_end, v_count, vt_count, vn_count,
+                            &corner)) {
+            OE_LOG(LOG_LEVEL_ERROR, "Invalid face index in .obj: '%.*s'",
+                   (int)(line_end - p), p);
+            chunk->result = OBJ_PARSE_ERROR;
+            return;
+          }
+          chunk->corners.push_back(corner);
+          corner_count++;
+          while (token < line_end && (IS_SPACE(*token) || *token == '\r')) {
+            token++;
+          }
+        }
+        if (corner_count > 4) {
+          chunk->result = OBJ_PARSE_UNSUPPORTED;
+          return;
+        }
+        if (corner_count < 3) {
+          // Degenerate, tinyobj drops these too
+          chunk->corners.resize(chunk->corners.size() - corner_count);
+        } else {
+          chunk->face_sizes.push_back(static_cast<uint8_t>(corner_count));
+        }
+        break;
+      }
+      default:
+        break;
+    }
+    p = next;
+  }
+}
+
+static void triangulate(obj_chunk *chunk, const std::vector<float> &v) {
+  chunk->triangles.reserve(chunk->corners.size() * 3 / 2);
+  const obj_index *corner = chunk->corners.data();
+  for (uint8_t face_size : chunk->face_sizes) {
+    if (face_size == 3) {
+      chunk->triangles.insert(chunk->triangles.end(), corner, corner + 3);
+      corner += 3;
+      continue;
+    }
+
+    // Quads are split along the shorter diagonal, exactly like tinyobj
+    const obj_index &i0 = corner[0];
+    const obj_index &i1 = corner[1];
+    const obj_index &i2 = corner[2];
+    const obj_index &i3 = corner[3];
+    corner += 4;
+
+    size_t vi0 = size_t(i0.vertex_index);
+    size_t vi1 = size_t(i1.vertex_index);
+    size_t vi2 = size_t(i2.vertex_index);
+    size_t vi3 = size_t(i3.vertex_index);
+    if (((3 * vi0 + 2) >= v.size()) || ((3 * vi1 + 2) >= v.size()) ||
+        ((3 * vi2 + 2) >= v.size()) || ((3 * vi3 + 2) >= v.size())) {
+      // Invalid quad, tinyobj skips it
+      continue;
+    }
+
+    float e02x = v[vi2 * 3 + 0] - v[vi0 * 3 + 0];
+    float e02y = v[vi2 * 3 + 1] - v[vi0 * 3 + 1];
+    float e02z = v[vi2 * 3 + 2] - v[vi0 * 3 + 2];
+    float e13x = v[vi3 * 3 + 0] - v[vi1 * 3 + 0];
+    float e13y = v[vi3 * 3 + 1] - v[vi1 * 3 + 1];
+    float e13z = v[vi3 * 3 + 2] - v[vi1 * 3 + 2];
+    float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+    float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+    if (sqr02 < sqr13) {
+      // [0, 1, 2], [0, 2, 3]
+      obj_index split[6] = {i0, i1, i2, i0, i2, i3};
+      chunk->triangles.insert(chunk->triangles.end(), split, split + 6);
+    } else {
+      // [0, 1, 3], [1, 2, 3]
+      obj_index split[6] = {i0, i1, i3, i1, i2, i3};
+      chunk->triangles.insert(chunk->triangles.end(), split, split + 6);
+    }
+  }
+  std::vector<obj_index>().swap(chunk->corners);
+}
+
+// Runs fn over every chunk, one thread per chunk
+template <typename F>
+static void for_each_chunk(std::vector<obj_chunk> &chunks, F fn) {
+  std::vector<std::thread> threads;
+  threads.reserve(chunks.size() - 1);
+  for (size_t i = 1; i < chunks.size(); i++) {
+    threads.emplace_back(fn, &chunks[i]);
+  }
+  fn(&chunks[0]);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+obj_parse_result obj_parser_parse(const char *data, size_t size,
+                                  uint32_t thread_count, obj_data *out_data) {
+  out_data->positions.clear();
+  out_data->texcoords.clear();
+  out_data->normals.clear();
+  out_data->indices.clear();
+
+  if (thread_count == 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  size_t max_chunks = size / OBJ_PARSER_MIN_CHUNK_SIZE + 1;
+  size_t chunk_count = thread_count < max_chunks ? thread_count : max_chunks;
+  if (chunk_count == 0) {
+    chunk_count = 1;
+  }
+
+  // Split on line boundaries. A '\n' always ends a line, so cut just after
+  // one.
+  std::vector<obj_chunk> chunks(chunk_count);
+  const char *end = data + size;
+  const char *chunk_begin = data;
+  for (size_t i = 0; i < chunk_count; i++) {
+    const char *chunk_end = end;
+    if (i + 1 < chunk_count) {
+      chunk_end = data + size * (i + 1) / chunk_count;
+      if (chunk_end < chunk_begin) {
+        chunk_end = chunk_begin;
+      }
+      const char *newline =
+          (const char *)memchr(chunk_end, '\n', end - chunk_end);
+      chunk_end = newline ? newline + 1 : end;
+    }
+    chunks[i].begin = chunk_begin;
+    chunks[i].end = chunk_end;
+    chunks[i].result = OBJ_PARSE_SUCCESS;
+    chunk_begin = chunk_end;
+  }
+
+  // Pass 1: count attributes so every chunk can write straight into the
+  // output arrays and resolve relative indices.
+  for_each_chunk(chunks, count_records);
+
+  size_t position_count = 0, texcoord_count = 0, normal_count = 0;
+  for (auto &chunk : chunks) {
+    chunk.position_base = position_count;
+    chunk.texcoord_base = texcoord_count;
+    chunk.normal_base = normal_count;
+    position_count += chunk.position_count;
+    texcoord_count += chunk.texcoord_count;
+    normal_count += chunk.normal_count;
+  }
+  out_data->positions.resize(3 * position_count);
+  out_data->texcoords.resize(2 * texcoord_count);
+  out_data->normals.resize(3 * normal_count);
+
+  // Pass 2: parse attributes and face corners
+  for_each_chunk(chunks, [out_data](obj_chunk *chunk) {
+    parse_records(chunk, out_data);
+  });
+
+  for (auto &chunk : chunks) {
+    if (chunk.result != OBJ_PARSE_SUCCESS) {
+      return chunk.result;
+    }
+  }
+
+  // Pass 3: triangulate. Quads need positions from anywhere in the file, so
+  // this waits until every chunk is parsed.
+  const std::vector<float> &positions = out_data->positions;
+  for_each_chunk(chunks, [&positions](obj_chunk *chunk) {
+    triangulate(chunk, positions);
+  });
+
+  // Merge the per chunk triangles in file order
+  size_t index_count = 0;
+  for (auto &chunk : chunks) {
+    chunk.index_base = index_count;
+    index_count += chunk.triangles.size();
+  }
+  out_data->indices.resize(index_count);
+  obj_index *indices = out_data->indices.data();
+  for_each_chunk(chunks, [indices](obj_chunk *chunk) {
+    memcpy(indices + chunk->index_base, chunk->triangles.data(),
+           chunk->triangles.size() * sizeof(obj_index));
+    std::vector<obj_index>().swap(chunk->triangles);
+  });
+
+  return OBJ_PARSE_SUCCESS;
+}
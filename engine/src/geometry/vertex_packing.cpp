@@ -0,0 +1,189 @@
+#include "engine/geometry/vertex_packing.h"
+
+#include <cmath>
+#include <cstring>
+
+uint16_t vertex_packing_float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xff;
+  uint32_t mantissa = bits & 0x7fffff;
+
+  // Inf and NaN, keeping NaNs quiet
+  if (exponent == 0xff) {
+    return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+  }
+
+  int32_t half_exponent = (int32_t)exponent - 127 + 15;
+  if (half_exponent >= 0x1f) {
+    return (uint16_t)(sign | 0x7c00);
+  }
+  if (half_exponent <= 0) {
+    // Denormal or zero. Shift the implicit bit in and round
+    if (half_exponent < -10) {
+      return (uint16_t)sign;
+    }
+    mantissa |= 0x800000;
+    uint32_t shift = (uint32_t)(14 - half_exponent);
+    uint32_t half_mantissa = mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (remainder > halfway || (remainder == halfway && (half_mantissa & 1))) {
+      half_mantissa++;
+    }
+    return (uint16_t)(sign | half_mantissa);
+  }
+
+  uint32_t half = sign | ((uint32_t)half_exponent << 10) | (mantissa >> 13);
+  uint32_t remainder = mantissa & 0x1fff;
+  // A carry out of the mantissa correctly bumps the exponent
+  if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+    half++;
+  }
+  return (uint16_t)half;
+}
+
+float vertex_packing_half_to_float(uint16_t value) {
+  uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+  uint32_t bits;
+  if (exponent == 0x1f) {
+    bits = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent != 0) {
+    bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+  } else if (mantissa == 0) {
+    bits = sign;
+  } else {
+    // Denormal, renormalize
+    exponent = 127 - 15 + 1;
+    while (!(mantissa & 0x400)) {
+      mantissa <<= 1;
+      exponent--;
+    }
+    bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  float result;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+static inline int16_t float_to_snorm16(float value) {
+  value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+  return (int16_t)lroundf(value * 32767.0f);
+}
+
+static inline float snorm16_to_float(int16_t value) {
+  float result = (float)value / 32767.0f;
+  return result < -1.0f ? -1.0f : result;
+}
+
+static inline uint8_t float_to_unorm8(float value) {
+  value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+  return (uint8_t)lroundf(value * 255.0f);
+}
+
+// Octahedral normal encoding. Must stay in sync with oct_decode in
+// packed.vert.glsl
+static void oct_encode(glm::vec3 normal, int16_t out[2]) {
+  float length =
+      std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+  if (length == 0.0f) {
+    out[0] = 0;
+    out[1] = 0;
+    return;
+  }
+  float x = normal.x / length;
+  float y = normal.y / length;
+  if (normal.z < 0.0f) {
+    float folded_x = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float folded_y = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = folded_x;
+    y = folded_y;
+  }
+  out[0] = float_to_snorm16(x);
+  out[1] = float_to_snorm16(y);
+}
+
+static glm::vec3 oct_decode(const int16_t encoded[2]) {
+  glm::vec3 normal(snorm16_to_float(encoded[0]), snorm16_to_float(encoded[1]),
+                   0.0f);
+  normal.z = 1.0f - std::fabs(normal.x) - std::fabs(normal.y);
+  float t = normal.z < 0.0f ? -normal.z : 0.0f;
+  normal.x += normal.x >= 0.0f ? -t : t;
+  normal.y += normal.y >= 0.0f ? -t : t;
+  float length = glm::length(normal);
+  return length > 0.0f ? normal / length : normal;
+}
+
+static inline uint32_t index_at(const mesh_geometry *geometry, uint32_t i) {
+  if (geometry->index_stride == sizeof(uint16_t)) {
+    return ((const uint16_t *)geometry->indices)[i];
+  }
+  return ((const uint32_t *)geometry->indices)[i];
+}
+
+void vertex_packing_pack(const mesh_geometry *geometry,
+                         std::vector<PackedVertex> *out_vertices,
+                         vertex_pack_decode *out_decode) {
+  // Area weighted smooth normals
+  std::vector<glm::vec3> normals(geometry->vertex_count, glm::vec3(0.0f));
+  for (uint32_t i = 0; i + 2 < geometry->index_count; i += 3) {
+    uint32_t a = index_at(geometry, i + 0);
+    uint32_t b = index_at(geometry, i + 1);
+    uint32_t c = index_at(geometry, i + 2);
+    const glm::vec3 &pa = geometry->vertices[a].pos;
+    glm::vec3 normal = glm::cross(geometry->vertices[b].pos - pa,
+                                  geometry->vertices[c].pos - pa);
+    normals[a] += normal;
+    normals[b] += normal;
+    normals[c] += normal;
+  }
+
+  out_decode->offset = (geometry->bounds_min + geometry->bounds_max) * 0.5f;
+  out_decode->scale = (geometry->bounds_max - geometry->bounds_min) * 0.5f;
+  glm::vec3 inverse_scale;
+  for (int axis = 0; axis < 3; axis++) {
+    // A flat axis only has one value, anything non-zero will do
+    if (out_decode->scale[axis] <= 0.0f) {
+      out_decode->scale[axis] = 1.0f;
+    }
+    inverse_scale[axis] = 1.0f / out_decode->scale[axis];
+  }
+
+  out_vertices->resize(geometry->vertex_count);
+  for (uint32_t i = 0; i < geometry->vertex_count; i++) {
+    const Vertex &vertex = geometry->vertices[i];
+    PackedVertex &packed = (*out_vertices)[i];
+    glm::vec3 position = (vertex.pos - out_decode->offset) * inverse_scale;
+    for (int axis = 0; axis < 3; axis++) {
+      packed.pos[axis] = float_to_snorm16(position[axis]);
+    }
+    packed.pos[3] = 0;
+    packed.tex_coord[0] = vertex_packing_float_to_half(vertex.tex_coord.x);
+    packed.tex_coord[1] = vertex_packing_float_to_half(vertex.tex_coord.y);
+    oct_encode(normals[i], packed.normal);
+    packed.color[0] = float_to_unorm8(vertex.color.x);
+    packed.color[1] = float_to_unorm8(vertex.color.y);
+    packed.color[2] = float_to_unorm8(vertex.color.z);
+    packed.color[3] = 255;
+  }
+}
+
+Vertex vertex_packing_unpack(const PackedVertex *vertex,
+                             const vertex_pack_decode *decode,
+                             glm::vec3 *out_normal) {
+  Vertex result{};
+  for (int axis = 0; axis < 3; axis++) {
+    float position = snorm16_to_float(vertex->pos[axis]);
+    result.pos[axis] = decode->offset[axis] + decode->scale[axis] * position;
+    result.color[axis] = vertex->color[axis] / 255.0f;
+  }
+  result.tex_coord = {vertex_packing_half_to_float(vertex->tex_coord[0]),
+                      vertex_packing_half_to_float(vertex->tex_coord[1])};
+  if (out_normal) {
+    *out_normal = oct_decode(vertex->normal);
+  }
+  return result;
+}
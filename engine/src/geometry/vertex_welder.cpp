@@ -0,0 +1,235 @@
+#include "engine/geometry/vertex_welder.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "engine/platform.h"
+
+// Vertices are hashed and compared as arrays of float components
+static_assert(sizeof(Vertex) % sizeof(float) == 0,
+              "Vertex must be made of float components");
+#define VERTEX_COMPONENT_COUNT (sizeof(Vertex) / sizeof(float))
+
+// Below this many vertices the threads cost more than they save
+#define VERTEX_WELDER_MIN_VERTICES_PER_THREAD (1 << 16)
+
+#define VERTEX_WELDER_EMPTY_SLOT UINT32_MAX
+
+// Slots keep the top of the hash so most mismatches never touch the vertex
+typedef struct weld_slot {
+  uint32_t vertex;
+  uint32_t tag;
+} weld_slot;
+
+// Per thread state. Hashing works on a contiguous range of the input and
+// buckets it by shard, welding then works on one shard.
+typedef struct weld_shard {
+  uint32_t first;
+  uint32_t end;
+  std::vector<std::vector<uint32_t>> buckets;
+  uint32_t index;
+} weld_shard;
+
+typedef struct weld_context {
+  const Vertex *vertices;
+  float inverse_epsilon;
+  bool snap;
+  uint32_t shard_count;
+  std::vector<uint64_t> hashes;
+  // For every vertex, the first vertex equal to it
+  std::vector<uint32_t> representative;
+  std::vector<weld_shard> shards;
+} weld_context;
+
+// Finalizer from MurmurHash3, every input bit affects every output bit
+static inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// Vertex components as the words that are hashed and compared. Exact welding
+// uses the raw float bits (with -0 folded into 0), epsilon welding the grid
+// cell of each component.
+static inline void vertex_key(const weld_context *context, uint32_t vertex,
+                              uint32_t out_key[VERTEX_COMPONENT_COUNT]) {
+  const float *components = (const float *)&context->vertices[vertex];
+  if (!context->snap) {
+    for (size_t i = 0; i < VERTEX_COMPONENT_COUNT; i++) {
+      float component = components[i] == 0.0f ? 0.0f : components[i];
+      memcpy(&out_key[i], &component, sizeof(float));
+    }
+    return;
+  }
+  for (size_t i = 0; i < VERTEX_COMPONENT_COUNT; i++) {
+    float scaled = components[i] * context->inverse_epsilon + 0.5f;
+    // Keep the conversion defined for values far outside the grid
+    scaled = scaled > -2147483520.0f ? scaled : -2147483520.0f;
+    scaled = scaled < 2147483520.0f ? scaled : 2147483520.0f;
+    // Rounds toward zero, step negative values down to get floor
+    int32_t cell = (int32_t)scaled;
+    cell -= scaled < (float)cell;
+    out_key[i] = (uint32_t)cell;
+  }
+}
+
+static inline uint64_t hash_key(const uint32_t key[VERTEX_COMPONENT_COUNT]) {
+  uint64_t hash = 0x9e3779b97f4a7c15ULL;
+  for (size_t i = 0; i + 1 < VERTEX_COMPONENT_COUNT; i += 2) {
+    hash = mix64(hash ^ (key[i] | ((uint64_t)key[i + 1] << 32)));
+  }
+  if (VERTEX_COMPONENT_COUNT % 2 != 0) {
+    hash = mix64(hash ^ key[VERTEX_COMPONENT_COUNT - 1]);
+  }
+  return hash;
+}
+
+static inline uint32_t shard_of(const weld_context *context, uint64_t hash) {
+  // The low bits pick the slot, so shard on the high ones
+  return (uint32_t)((hash >> 32) % context->shard_count);
+}
+
+static void hash_range(weld_context *context, weld_shard *shard) {
+  shard->buckets.resize(context->shard_count);
+  uint32_t key[VERTEX_COMPONENT_COUNT];
+  for (uint32_t i = shard->first; i < shard->end; i++) {
+    vertex_key(context, i, key);
+    uint64_t hash = hash_key(key);
+    context->hashes[i] = hash;
+    shard->buckets[shard_of(context, hash)].push_back(i);
+  }
+}
+
+static void weld_shard_vertices(weld_context *context, weld_shard *shard) {
+  size_t count = 0;
+  for (const auto &range : context->shards) {
+    count += range.buckets[shard->index].size();
+  }
+
+  // At most half full
+  size_t capacity = 16;
+  while (capacity < count * 2) {
+    capacity <<= 1;
+  }
+  size_t mask = capacity - 1;
+  std::vector<weld_slot> table(capacity, {VERTEX_WELDER_EMPTY_SLOT, 0});
+
+  uint32_t key[VERTEX_COMPONENT_COUNT];
+  uint32_t other_key[VERTEX_COMPONENT_COUNT];
+  // Ranges and their buckets are in input order, so the first vertex inserted
+  // for a key is also its first occurrence
+  for (const auto &range : context->shards) {
+    for (uint32_t vertex : range.buckets[shard->index]) {
+      uint64_t hash = context->hashes[vertex];
+      uint32_t tag = (uint32_t)(hash >> 32);
+      vertex_key(context, vertex, key);
+
+      size_t slot = hash & mask;
+      while (true) {
+        weld_slot *entry = &table[slot];
+        if (entry->vertex == VERTEX_WELDER_EMPTY_SLOT) {
+          entry->vertex = vertex;
+          entry->tag = tag;
+          context->representative[vertex] = vertex;
+          break;
+        }
+        if (entry->tag == tag) {
+          vertex_key(context, entry->vertex, other_key);
+          if (memcmp(key, other_key, sizeof(key)) == 0) {
+            context->representative[vertex] = entry->vertex;
+            break;
+          }
+        }
+        slot = (slot + 1) & mask;
+      }
+    }
+  }
+}
+
+template <typename F>
+static void for_each_shard(std::vector<weld_shard> &shards, F fn) {
+  std::vector<std::thread> threads;
+  threads.reserve(shards.size() - 1);
+  for (size_t i = 1; i < shards.size(); i++) {
+    threads.emplace_back(fn, &shards[i]);
+  }
+  fn(&shards[0]);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void vertex_welder_weld(const Vertex *vertices, uint32_t vertex_count,
+                        const vertex_weld_config *config,
+                        std::vector<Vertex> *out_vertices,
+                        std::vector<uint32_t> *out_remap,
+                        vertex_weld_stats *out_stats) {
+  double start_time = platform_get_absolute_time();
+
+  float epsilon = config ? config->epsilon : 0.0f;
+  uint32_t thread_count = config ? config->thread_count : 1;
+  if (thread_count == 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  uint32_t max_threads =
+      vertex_count / VERTEX_WELDER_MIN_VERTICES_PER_THREAD + 1;
+  thread_count = thread_count < max_threads ? thread_count : max_threads;
+  if (thread_count == 0) {
+    thread_count = 1;
+  }
+
+  weld_context context;
+  context.vertices = vertices;
+  context.snap = epsilon > 0.0f;
+  context.inverse_epsilon = context.snap ? 1.0f / epsilon : 0.0f;
+  context.shard_count = thread_count;
+  context.hashes.resize(vertex_count);
+  context.representative.resize(vertex_count);
+  context.shards.resize(thread_count);
+  for (uint32_t i = 0; i < thread_count; i++) {
+    context.shards[i].first = (uint32_t)((uint64_t)vertex_count * i /
+                                         thread_count);
+    context.shards[i].end = (uint32_t)((uint64_t)vertex_count * (i + 1) /
+                                       thread_count);
+    context.shards[i].index = i;
+  }
+
+  for_each_shard(context.shards, [&context](weld_shard *shard) {
+    hash_range(&context, shard);
+  });
+  for_each_shard(context.shards, [&context](weld_shard *shard) {
+    weld_shard_vertices(&context, shard);
+  });
+
+  // Compact in input order. A representative always comes before the
+  // vertices welded to it, so its remap entry is already written.
+  uint32_t unique_count = 0;
+  for (uint32_t i = 0; i < vertex_count; i++) {
+    unique_count += context.representative[i] == i;
+  }
+  out_vertices->clear();
+  out_vertices->reserve(unique_count);
+  out_remap->resize(vertex_count);
+  uint32_t *remap = out_remap->data();
+  for (uint32_t i = 0; i < vertex_count; i++) {
+    uint32_t representative = context.representative[i];
+    if (representative == i) {
+      remap[i] = (uint32_t)out_vertices->size();
+      out_vertices->push_back(vertices[i]);
+    } else {
+      remap[i] = remap[representative];
+    }
+  }
+
+  if (out_stats) {
+    out_stats->input_vertex_count = vertex_count;
+    out_stats->output_vertex_count = (uint32_t)out_vertices->size();
+    out_stats->thread_count = thread_count;
+    out_stats->elapsed_ms =
+        (platform_get_absolute_time() - start_time) * 1000.0;
+  }
+}
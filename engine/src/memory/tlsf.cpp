@@ -0,0 +1,254 @@
+#include "engine/memory/tlsf.h"
+
+#include <cstring>
+
+static uint32_t highest_bit(uint64_t value) {
+  return 63 - (uint32_t)__builtin_clzll(value);
+}
+
+static uint32_t lowest_bit(uint64_t value) {
+  return (uint32_t)__builtin_ctzll(value);
+}
+
+// The bin a free range of this size is stored in
+static void mapping_insert(uint64_t size, uint32_t *out_fl, uint32_t *out_sl) {
+  if (size < TLSF_SMALL_SIZE) {
+    *out_fl = 0;
+    *out_sl = (uint32_t)(size / (TLSF_SMALL_SIZE / TLSF_SL_COUNT));
+    return;
+  }
+  uint32_t msb = highest_bit(size);
+  *out_fl = msb - (TLSF_SL_LOG2 + 3) + 1;
+  *out_sl = (uint32_t)(size >> (msb - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+}
+
+// The first bin where every range is at least this large
+static void mapping_search(uint64_t size, uint32_t *out_fl, uint32_t *out_sl) {
+  uint64_t step = size < TLSF_SMALL_SIZE
+                      ? TLSF_SMALL_SIZE / TLSF_SL_COUNT
+                      : 1ull << (highest_bit(size) - TLSF_SL_LOG2);
+  if (size <= UINT64_MAX - step) {
+    size += step - 1;
+  }
+  mapping_insert(size, out_fl, out_sl);
+}
+
+static uint32_t new_node(tlsf_allocator *allocator) {
+  if (!allocator->unused_nodes.empty()) {
+    uint32_t node = allocator->unused_nodes.back();
+    allocator->unused_nodes.pop_back();
+    return node;
+  }
+  allocator->nodes.push_back({});
+  return (uint32_t)allocator->nodes.size() - 1;
+}
+
+static void insert_free(tlsf_allocator *allocator, uint32_t index) {
+  tlsf_node *node = &allocator->nodes[index];
+  uint32_t fl, sl;
+  mapping_insert(node->size, &fl, &sl);
+  uint32_t head = allocator->free_heads[fl][sl];
+  node->is_free = true;
+  node->prev_free = TLSF_INVALID_NODE;
+  node->next_free = head;
+  if (head != TLSF_INVALID_NODE) {
+    allocator->nodes[head].prev_free = index;
+  }
+  allocator->free_heads[fl][sl] = index;
+  allocator->fl_bitmap |= 1ull << fl;
+  allocator->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void remove_free(tlsf_allocator *allocator, uint32_t index) {
+  tlsf_node *node = &allocator->nodes[index];
+  uint32_t fl, sl;
+  mapping_insert(node->size, &fl, &sl);
+  if (node->prev_free != TLSF_INVALID_NODE) {
+    allocator->nodes[node->prev_free].next_free = node->next_free;
+  } else {
+    allocator->free_heads[fl][sl] = node->next_free;
+    if (node->next_free == TLSF_INVALID_NODE) {
+      allocator->sl_bitmap[fl] &= ~(1u << sl);
+      if (allocator->sl_bitmap[fl] == 0) {
+        allocator->fl_bitmap &= ~(1ull << fl);
+      }
+    }
+  }
+  if (node->next_free != TLSF_INVALID_NODE) {
+    allocator->nodes[node->next_free].prev_free = node->prev_free;
+  }
+  node->is_free = false;
+}
+
+// Head of the first non-empty bin at or above (fl, sl)
+static uint32_t find_free(const tlsf_allocator *allocator, uint32_t fl,
+                          uint32_t sl) {
+  if (fl >= TLSF_FL_COUNT) {
+    return TLSF_INVALID_NODE;
+  }
+  uint32_t sl_map = allocator->sl_bitmap[fl] & (~0u << sl);
+  if (sl_map == 0) {
+    uint64_t fl_map =
+        fl + 1 < 64 ? allocator->fl_bitmap & (~0ull << (fl + 1)) : 0;
+    if (fl_map == 0) {
+      return TLSF_INVALID_NODE;
+    }
+    fl = lowest_bit(fl_map);
+    sl_map = allocator->sl_bitmap[fl];
+  }
+  return allocator->free_heads[fl][lowest_bit(sl_map)];
+}
+
+static bool fits(const tlsf_node *node, uint64_t size, uint64_t alignment) {
+  uint64_t aligned = (node->offset + alignment - 1) & ~(alignment - 1);
+  return aligned + size <= node->offset + node->size;
+}
+
+// Splits off the range [offset + size, end) of a node as a new free node
+static void split_after(tlsf_allocator *allocator, uint32_t index,
+                        uint64_t size) {
+  uint32_t rest = new_node(allocator);
+  tlsf_node *node = &allocator->nodes[index];
+  tlsf_node *rest_node = &allocator->nodes[rest];
+  rest_node->offset = node->offset + size;
+  rest_node->size = node->size - size;
+  rest_node->prev_physical = index;
+  rest_node->next_physical = node->next_physical;
+  if (node->next_physical != TLSF_INVALID_NODE) {
+    allocator->nodes[node->next_physical].prev_physical = rest;
+  }
+  node->next_physical = rest;
+  node->size = size;
+  insert_free(allocator, rest);
+}
+
+void tlsf_create(uint64_t size, tlsf_allocator *out_allocator) {
+  out_allocator->size = size;
+  out_allocator->free_size = size;
+  out_allocator->allocation_count = 0;
+  out_allocator->fl_bitmap = 0;
+  memset(out_allocator->sl_bitmap, 0, sizeof(out_allocator->sl_bitmap));
+  memset(out_allocator->free_heads, 0xFF, sizeof(out_allocator->free_heads));
+  out_allocator->nodes.clear();
+  out_allocator->unused_nodes.clear();
+  if (size == 0) {
+    return;
+  }
+
+  uint32_t index = new_node(out_allocator);
+  tlsf_node *node = &out_allocator->nodes[index];
+  node->offset = 0;
+  node->size = size;
+  node->prev_physical = TLSF_INVALID_NODE;
+  node->next_physical = TLSF_INVALID_NODE;
+  insert_free(out_allocator, index);
+}
+
+bool tlsf_allocate(tlsf_allocator *allocator, uint64_t size,
+                   uint64_t alignment, uint32_t *out_node,
+                   uint64_t *out_offset) {
+  if (size == 0 || size > allocator->free_size) {
+    return false;
+  }
+  if (alignment == 0) {
+    alignment = 1;
+  }
+
+  // Any range in the bin found by rounding up is large enough, but the
+  // alignment padding may not fit, in which case look again with room for
+  // the worst case padding
+  uint32_t fl, sl;
+  mapping_search(size, &fl, &sl);
+  uint32_t index = find_free(allocator, fl, sl);
+  if (index != TLSF_INVALID_NODE &&
+      !fits(&allocator->nodes[index], size, alignment)) {
+    mapping_search(size + alignment - 1, &fl, &sl);
+    index = find_free(allocator, fl, sl);
+  }
+  // Rounding up skips ranges in the size's own bin that may still fit, which
+  // matters when the space is nearly full
+  if (index == TLSF_INVALID_NODE) {
+    mapping_insert(size, &fl, &sl);
+    for (index = allocator->free_heads[fl][sl]; index != TLSF_INVALID_NODE;
+         index = allocator->nodes[index].next_free) {
+      if (fits(&allocator->nodes[index], size, alignment)) {
+        break;
+      }
+    }
+  }
+  if (index == TLSF_INVALID_NODE) {
+    return false;
+  }
+  remove_free(allocator, index);
+
+  // Give the alignment padding in front back as its own free range. The
+  // range before a free one is always in use, so there's nothing to merge.
+  tlsf_node *node = &allocator->nodes[index];
+  uint64_t padding =
+      ((node->offset + alignment - 1) & ~(alignment - 1)) - node->offset;
+  if (padding > 0) {
+    split_after(allocator, index, padding);
+    uint32_t aligned = allocator->nodes[index].next_physical;
+    remove_free(allocator, aligned);
+    insert_free(allocator, index);
+    index = aligned;
+  }
+  if (allocator->nodes[index].size > size) {
+    split_after(allocator, index, size);
+  }
+
+  allocator->free_size -= size;
+  allocator->allocation_count++;
+  *out_node = index;
+  *out_offset = allocator->nodes[index].offset;
+  return true;
+}
+
+void tlsf_free(tlsf_allocator *allocator, uint32_t index) {
+  tlsf_node *node = &allocator->nodes[index];
+  allocator->free_size += node->size;
+  allocator->allocation_count--;
+
+  uint32_t prev = node->prev_physical;
+  if (prev != TLSF_INVALID_NODE && allocator->nodes[prev].is_free) {
+    remove_free(allocator, prev);
+    tlsf_node *prev_node = &allocator->nodes[prev];
+    prev_node->size += node->size;
+    prev_node->next_physical = node->next_physical;
+    if (node->next_physical != TLSF_INVALID_NODE) {
+      allocator->nodes[node->next_physical].prev_physical = prev;
+    }
+    allocator->unused_nodes.push_back(index);
+    index = prev;
+    node = prev_node;
+  }
+
+  uint32_t next = node->next_physical;
+  if (next != TLSF_INVALID_NODE && allocator->nodes[next].is_free) {
+    remove_free(allocator, next);
+    tlsf_node *next_node = &allocator->nodes[next];
+    node->size += next_node->size;
+    node->next_physical = next_node->next_physical;
+    if (next_node->next_physical != TLSF_INVALID_NODE) {
+      allocator->nodes[next_node->next_physical].prev_physical = index;
+    }
+    allocator->unused_nodes.push_back(next);
+  }
+  insert_free(allocator, index);
+}
+
+uint64_t tlsf_largest_free(const tlsf_allocator *allocator) {
+  if (allocator->fl_bitmap == 0) {
+    return 0;
+  }
+  uint32_t fl = highest_bit(allocator->fl_bitmap);
+  uint32_t sl = highest_bit(allocator->sl_bitmap[fl]);
+  uint64_t largest = 0;
+  for (uint32_t index = allocator->free_heads[fl][sl];
+       index != TLSF_INVALID_NODE; index = allocator->nodes[index].next_free) {
+    if (allocator->nodes[index].size > largest) {
+      largest = allocator->nodes[index].size;
+    }
+  }
+  return largest;
+}
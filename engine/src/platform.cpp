@@ -6,9 +6,11 @@
 
 #include <stdlib.h>
 
-#include <fstream>
+#include <chrono>
+#include <stdexcept>
 #include <vector>
 
+#include "engine/filesystem.h"
 #include "engine/logger.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -75,21 +77,24 @@ void platform_shutdown() {
 }
 
 /**
- * @brief Reads a file and returns the contents as a buffer
+ * @brief Reads a file and returns the contents as a buffer. Use
+ * filesystem_map instead to read without copying.
  * @returns std::vector of chars
  */
 std::vector<char> platform_read_file(const std::string &filename) {
-  std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-  if (!file.is_open()) {
+  file_mapping mapping;
+  if (!filesystem_map(filename.c_str(), FILE_MAP_HINT_SEQUENTIAL, &mapping)) {
     throw std::runtime_error("failed to open file!");
   }
 
-  size_t fileSize = (size_t)file.tellg();
-  std::vector<char> buffer(fileSize);
-  file.seekg(0);
-  file.read(buffer.data(), fileSize);
-  file.close();
+  const char *data = (const char *)mapping.data;
+  std::vector<char> buffer(data, data + mapping.size);
+  filesystem_unmap(&mapping);
 
   return buffer;
 }
+
+double platform_get_absolute_time() {
+  auto now = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(now.time_since_epoch()).count();
+}
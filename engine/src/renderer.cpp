@@ -19,4 +19,18 @@ void draw_frame() {
   // etc. LOTS will happen here
   renderer_backend_draw_frame();
 }
+void renderer_set_present_config(const renderer_present_config *config) {
+  renderer_backend_set_present_config(config);
+}
+
+void renderer_set_frames_in_flight(uint32_t count) {
+  renderer_backend_set_frames_in_flight(count);
+}
+
+void renderer_begin_frame_stats() { renderer_backend_begin_frame_stats(); }
+
+void renderer_end_frame_stats(renderer_frame_stats *out_stats) {
+  renderer_backend_end_frame_stats(out_stats);
+}
+
 void renderer_shutdown() { renderer_backend_shutdown(); }
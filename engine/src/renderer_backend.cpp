@@ -3,33 +3,47 @@
 
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <stdexcept>
 #include <glm/ext/matrix_transform.hpp>
-#include <unordered_map>
 #include <vector>
 #include <vulkan/vulkan_enums.hpp>
 
+#include "engine/assets/assets.h"
+#include "engine/filesystem.h"
+#include "engine/geometry/mesh_loader.h"
+#include "engine/geometry/vertex_packing.h"
 #include "engine/logger.h"
 #include "engine/platform.h"
 #include "engine/renderer_types.inl"
+#include "engine/texture/ktx2.h"
+#include "engine/texture/mipmap.h"
+#include "engine/vulkan/vulkan_allocator.h"
+#include "engine/vulkan/vulkan_bindless.h"
 #include "engine/vulkan/vulkan_buffer.h"
+#include "engine/vulkan/vulkan_deletion_queue.h"
+#include "engine/vulkan/vulkan_descriptor.h"
 #include "engine/vulkan/vulkan_device.h"
+#include "engine/vulkan/vulkan_frame_arena.h"
 #include "engine/vulkan/vulkan_image.h"
+#include "engine/vulkan/vulkan_memory_budget.h"
 #include "engine/vulkan/vulkan_renderpass.h"
 #include "engine/vulkan/vulkan_shader.h"
+#include "engine/vulkan/vulkan_staging.h"
 #include "engine/vulkan/vulkan_swapchain.h"
+#include "engine/vulkan/vulkan_timeline.h"
+#include "engine/vulkan/vulkan_upload.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "engine/resources/tiny_obj_loader.h"
-
 #define GLFW_INCLUDE_VULKAN
 #define VK_USE_PLATFORM_WAYLAND_KHR
 #include <GLFW/glfw3.h>
@@ -39,21 +53,47 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-static backend_context context;
-static std::vector<Vertex> vertices;
-// = {
-//     {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-//     {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-//     {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-//     {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
+// Configure with -DORION_PACKED_VERTICES=ON to upload meshes as PackedVertex
+#ifdef ORION_PACKED_VERTICES
+#define RENDERER_VERTEX_FORMAT VERTEX_FORMAT_PACKED
+#else
+#define RENDERER_VERTEX_FORMAT VERTEX_FORMAT_FULL
+#endif
 
-//     {{-0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-//     {{0.5f, -0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-//     {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-//     {{-0.5f, 0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}};
+// TODO: Hardcoded until there is a material system
+#define RENDERER_COOKED_TEXTURE "textures/viking_room.ktx2"
+#define RENDERER_SOURCE_TEXTURE "textures/viking_room.png"
+#define RENDERER_MESH "models/viking_room.obj"
+
+// Texture file reads in flight, started before the device is created
+typedef struct texture_reads {
+  file_io_queue *queue;
+  file_read_id cooked;
+  file_read_id source;
+  bool source_requested;
+} texture_reads;
+
+// A timed frame that the GPU hasn't been seen to finish yet
+typedef struct pending_frame_timing {
+  uint64_t value;
+  double start;
+} pending_frame_timing;
+
+// See renderer_backend_begin_frame_stats
+typedef struct frame_stats_state {
+  bool enabled;
+  double begin;
+  std::vector<pending_frame_timing> pending;
+  std::vector<double> latencies;
+} frame_stats_state;
 
-static std::vector<uint32_t> indices;
-// = {4, 5, 6, 6, 7, 4, 0, 1, 2, 2, 3, 0};
+static backend_context context;
+static frame_stats_state frame_stats;
+// TODO: Single hardcoded mesh until there is a geometry system
+static mesh_asset scene_mesh;
+static texture_reads pending_texture;
+// Backs scene_mesh when it comes from the asset pack
+static asset_data scene_mesh_data;
 
 PFN_vkCreateDebugUtilsMessengerEXT pfnVkCreateDebugUtilsMessengerEXT;
 PFN_vkDestroyDebugUtilsMessengerEXT pfnVkDestroyDebugUtilsMessengerEXT;
@@ -83,7 +123,7 @@ void renderer_backend_load_geometry() {
 
   // 1. Load the model from file
   // TODO: Make these not hardcoded, but also see above
-  const std::string model_path = "../bin/assets/models/viking_room.obj";
+  const std::string model_path = ASSETS_ROOT RENDERER_MESH;
   // const std::string texture_path = "";
   // int height;
   // int width;
@@ -92,37 +132,20 @@ void renderer_backend_load_geometry() {
   // void *pixels = platform_open_image(texture_path, &height, &width,
   // &channels);
 
-  tinyobj::attrib_t attributes;
-  std::vector<tinyobj::shape_t> shapes;
-  std::vector<tinyobj::material_t> materials;
-  std::string warn, err;
-
-  if (!tinyobj::LoadObj(&attributes, &shapes, &materials, &warn, &err,
-                        model_path.c_str())) {
-    throw std::runtime_error(warn + err);
+  // Packs hold the mesh already baked, so there is nothing to parse
+  const char *packed_mesh = RENDERER_MESH MESH_CACHE_EXTENSION;
+  if (assets_is_packed(packed_mesh)) {
+    if (!assets_load(packed_mesh, &scene_mesh_data) ||
+        !mesh_loader_load_memory(packed_mesh, scene_mesh_data.data,
+                                 scene_mesh_data.size, &scene_mesh)) {
+      throw std::runtime_error(std::string("failed to load model: ") +
+                               packed_mesh);
+    }
+    return;
   }
 
-  std::unordered_map<Vertex, uint32_t> unique_verts{};
-  for (const auto &shape : shapes) {
-    for (const auto &index : shape.mesh.indices) {
-      Vertex vertex{};
-
-      vertex.pos = {attributes.vertices[3 * index.vertex_index + 0],
-                    attributes.vertices[3 * index.vertex_index + 1],
-                    attributes.vertices[3 * index.vertex_index + 2]};
-
-      vertex.tex_coord = {
-          attributes.texcoords[2 * index.texcoord_index + 0],
-          1.0f - attributes.texcoords[2 * index.texcoord_index + 1]};
-
-      vertex.color = {1.0f, 1.0f, 1.0f};
-      vertices.push_back(vertex);
-      if (unique_verts.count(vertex) == 0) {
-        unique_verts[vertex] = static_cast<uint32_t>(vertices.size());
-        vertices.push_back(vertex);
-      }
-      indices.push_back(unique_verts[vertex]);
-    }
+  if (!mesh_loader_load(model_path, true, &scene_mesh)) {
+    throw std::runtime_error("failed to load model: " + model_path);
   }
 }
 
@@ -156,209 +179,406 @@ vk::Format find_depth_format() {
 void create_depth_resources() {
   vk::Format depth_format = find_depth_format();
   vulkan_image_create(&context, context.swapchain.extent.height,
-                      context.swapchain.extent.width, depth_format,
+                      context.swapchain.extent.width, 1, depth_format,
                       vk::ImageUsageFlagBits::eDepthStencilAttachment,
-                      &context.depth_image);
+                      VULKAN_MEMORY_RENDER_TARGET, &context.depth_image);
   vulkan_image_create_view(
       &context, depth_format, vk::ImageAspectFlagBits::eDepth,
-      &context.depth_image.handle, &context.depth_image.view);
-  vulkan_image_transition_layout(
-      &context, &context.depth_image, depth_format, vk::ImageLayout::eUndefined,
-      vk::ImageLayout::eDepthStencilAttachmentOptimal);
+      &context.depth_image.handle, 1, &context.depth_image.view);
+  // No transition, the render pass clears depth from an undefined layout.
+  // That keeps recreating it on resize off the upload queues.
 }
 
-void renderer_create_texture() {
-  // TODO: Temp code
-  int width, height, channels;
-  void *pixels = platform_open_image("textures/viking_room.png", &height,
-                                     &width, &channels);
-
-  vulkan_buffer staging;
-  vulkan_buffer_create(&context, vk::BufferUsageFlagBits::eTransferSrc,
-                       vk::MemoryPropertyFlagBits::eHostVisible |
-                           vk::MemoryPropertyFlagBits::eHostCoherent,
-                       width * height * 4, &staging);
-
-  vulkan_buffer_load_data(&context, &staging, 0, 0, width * height * 4, pixels);
-
-  vulkan_image_create(
-      &context, height, width, vk::Format::eR8G8B8A8Srgb,
-      vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled,
-      &context.default_texture.image);
+// One tightly packed mip level of a texture
+typedef struct texture_level_data {
+  const void *data;
+  uint32_t width;
+  uint32_t height;
+} texture_level_data;
+
+// Creates the default texture and uploads its levels through the staging ring
+static void create_texture_image(
+    vk::Format format, uint32_t block_size, uint32_t block_dimension,
+    const std::vector<texture_level_data> &levels) {
+  uint32_t mip_levels = static_cast<uint32_t>(levels.size());
+  vulkan_image_create(&context, levels[0].height, levels[0].width, mip_levels,
+                      format,
+                      vk::ImageUsageFlagBits::eTransferDst |
+                          vk::ImageUsageFlagBits::eSampled,
+                      VULKAN_MEMORY_TEXTURE, &context.default_texture.image);
   vulkan_image_transition_layout(
-      &context, &context.default_texture.image, vk::Format::eR8G8B8A8Srgb,
+      &context, &context.upload, &context.default_texture.image, format,
       vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-  vulkan_image_copy_from_buffer(&context, staging,
-                                context.default_texture.image, height, width);
-  vulkan_image_transition_layout(&context, &context.default_texture.image,
-                                 vk::Format::eB8G8R8A8Srgb,
-                                 vk::ImageLayout::eTransferDstOptimal,
-                                 vk::ImageLayout::eShaderReadOnlyOptimal);
-
-  vulkan_buffer_destroy(&context, &staging);
-
-  vulkan_image_create_view(&context, vk::Format::eR8G8B8A8Srgb,
-                           vk::ImageAspectFlagBits::eColor,
-                           &context.default_texture.image.handle,
+  for (uint32_t i = 0; i < mip_levels; i++) {
+    vulkan_staging_upload_image(&context, &context.upload,
+                                &context.default_texture.image, i,
+                                levels[i].width, levels[i].height, block_size,
+                                block_dimension, levels[i].data);
+  }
+  vulkan_image_transition_layout(
+      &context, &context.upload, &context.default_texture.image, format,
+      vk::ImageLayout::eTransferDstOptimal,
+      vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  vulkan_image_create_view(&context, format, vk::ImageAspectFlagBits::eColor,
+                           &context.default_texture.image.handle, mip_levels,
                            &context.default_texture.image.view);
 
   vulkan_image_create_sampler(&context, &context.default_texture.image,
                               &context.default_texture.sampler);
 }
 
-void create_descriptor_pool() {
-  vk::DescriptorPoolSize buffer_ps{
-      .type = vk::DescriptorType::eUniformBuffer,
-      .descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
-  };
-  vk::DescriptorPoolSize sampler_ps{
-      .type = vk::DescriptorType::eCombinedImageSampler,
-      .descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
-  };
-  std::array<vk::DescriptorPoolSize, 2> pool_size = {buffer_ps, sampler_ps};
+// Cooked textures already hold every mip level in the GPU's format, so the
+// blocks go from the file contents straight into the staging ring
+static bool create_texture_from_ktx2(const char *path, const void *data,
+                                     size_t size) {
+  double start_time = platform_get_absolute_time();
+  ktx2_texture texture;
+  if (!ktx2_load_memory(data, size, path, &texture)) {
+    return false;
+  }
 
-  vk::DescriptorPoolCreateInfo pool_info{
-      .maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
-      .poolSizeCount = static_cast<uint32_t>(pool_size.size()),
-      .pPoolSizes = pool_size.data(),
-  };
+  vk::Format format = static_cast<vk::Format>(texture.vk_format);
+  vk::FormatProperties properties =
+      context.device.physical_device.getFormatProperties(format);
+  if (!(properties.optimalTilingFeatures &
+        vk::FormatFeatureFlagBits::eSampledImage)) {
+    OE_LOG(LOG_LEVEL_WARN, "Device can't sample the format of '%s'", path);
+    ktx2_close(&texture);
+    return false;
+  }
+
+  uint32_t block_dimension;
+  uint32_t block_size =
+      ktx2_format_block_size(texture.vk_format, &block_dimension);
+  std::vector<texture_level_data> levels(texture.levels.size());
+  for (uint32_t i = 0; i < texture.levels.size(); i++) {
+    levels[i] = {texture.levels[i].data, texture.levels[i].width,
+                 texture.levels[i].height};
+  }
+  create_texture_image(format, block_size, block_dimension, levels);
+  ktx2_close(&texture);
 
-  context.descriptor_pool =
-      context.device.logical_device.createDescriptorPool(pool_info);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Loaded %zu mip levels for %ux%u texture from '%s' in %.3f ms",
+         levels.size(), levels[0].width, levels[0].height, path,
+         (platform_get_absolute_time() - start_time) * 1000.0);
+  return true;
 }
 
-void create_descriptor_set() {
-  std::vector<vk::DescriptorSetLayout> layouts(
-      MAX_FRAMES_IN_FLIGHT, context.pipeline.descriptor_set_layout);
+static void create_texture_from_image(const char *path, const void *data,
+                                      size_t size) {
+  int width, height, channels;
+  stbi_uc *pixels =
+      stbi_load_from_memory((const stbi_uc *)data, (int)size, &width, &height,
+                            &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to decode texture '%s'", path);
+    throw std::runtime_error("failed to load image file!");
+  }
 
-  vk::DescriptorSetAllocateInfo alloc_info{
-      .descriptorPool = context.descriptor_pool,
-      .descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT),
-      .pSetLayouts = layouts.data()
+  double start_time = platform_get_absolute_time();
+  mip_chain chain;
+  mipmap_generate(pixels, width, height, true, 0, &chain);
+  stbi_image_free(pixels);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Generated %zu mip levels for %dx%d texture in %.3f ms",
+         chain.levels.size(), width, height,
+         (platform_get_absolute_time() - start_time) * 1000.0);
+
+  std::vector<texture_level_data> levels(chain.levels.size());
+  for (uint32_t i = 0; i < chain.levels.size(); i++) {
+    levels[i] = {chain.pixels.data() + chain.levels[i].offset,
+                 chain.levels[i].width, chain.levels[i].height};
+  }
+  create_texture_image(vk::Format::eR8G8B8A8Srgb, 4, 1, levels);
+}
 
-  };
-  context.descriptor_sets.resize(MAX_FRAMES_IN_FLIGHT);
-  context.descriptor_sets =
-      context.device.logical_device.allocateDescriptorSets(alloc_info);
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vk::DescriptorBufferInfo buffer_info{
-        .buffer = context.uniform_buffers[i].handle,
-        .offset = 0,
-        .range = sizeof(UniformBufferObject)};
-
-    vk::DescriptorImageInfo image_info{
-        .sampler = context.default_texture.sampler,
-        .imageView = context.default_texture.image.view,
-        .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal,
-    };
+// Starts on the source image as soon as the cooked texture turns out to be
+// missing, while the device is still being created
+static void on_cooked_texture_read(file_read_id id,
+                                   const file_read_result *result,
+                                   void *user_data) {
+  texture_reads *reads = (texture_reads *)user_data;
+  if (!result->success) {
+    reads->source = filesystem_read_async(
+        reads->queue, ASSETS_ROOT RENDERER_SOURCE_TEXTURE, nullptr, nullptr);
+    reads->source_requested = true;
+    filesystem_io_submit(reads->queue);
+  }
+}
+
+static void begin_texture_reads() {
+  // Packed textures are already mapped, there is nothing to read ahead
+  pending_texture.queue = nullptr;
+  if (assets_is_packed(RENDERER_COOKED_TEXTURE) ||
+      assets_is_packed(RENDERER_SOURCE_TEXTURE)) {
+    return;
+  }
+  filesystem_io_queue_create(FILE_IO_BACKEND_AUTO, 0, &pending_texture.queue);
+  pending_texture.source_requested = false;
+  pending_texture.cooked =
+      filesystem_read_async(pending_texture.queue,
+                            ASSETS_ROOT RENDERER_COOKED_TEXTURE,
+                            on_cooked_texture_read, &pending_texture);
+  filesystem_io_submit(pending_texture.queue);
+}
+
+static void create_packed_texture() {
+  asset_data data;
+  bool loaded = false;
+  if (assets_is_packed(RENDERER_COOKED_TEXTURE) &&
+      assets_load(RENDERER_COOKED_TEXTURE, &data)) {
+    loaded = create_texture_from_ktx2(RENDERER_COOKED_TEXTURE, data.data,
+                                      data.size);
+    asset_data_release(&data);
+  }
+  if (!loaded) {
+    if (!assets_load(RENDERER_SOURCE_TEXTURE, &data)) {
+      throw std::runtime_error("failed to load image file!");
+    }
+    create_texture_from_image(RENDERER_SOURCE_TEXTURE, data.data, data.size);
+    asset_data_release(&data);
+  }
+}
+
+void renderer_create_texture() {
+  // TODO: Temp code
+  // Prefer the cooked texture, fall back to decoding the source image
+  if (!pending_texture.queue) {
+    create_packed_texture();
+    return;
+  }
+  double wait_start = platform_get_absolute_time();
+  file_read_result file;
+  bool read = filesystem_io_wait(pending_texture.queue, pending_texture.cooked,
+                                 &file);
+  OE_LOG(LOG_LEVEL_DEBUG, "Waited %.3f ms for the texture read",
+         (platform_get_absolute_time() - wait_start) * 1000.0);
+  bool loaded = false;
+  if (read) {
+    loaded = create_texture_from_ktx2(ASSETS_ROOT RENDERER_COOKED_TEXTURE,
+                                      file.data, file.size);
+    free(file.data);
+  }
 
-    vk::WriteDescriptorSet uniform_buffer_descriptor_write{
-        .dstSet = context.descriptor_sets[i],
-        .dstBinding = 0,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType = vk::DescriptorType::eUniformBuffer,
-        .pImageInfo = nullptr,
-        .pBufferInfo = &buffer_info,
-        .pTexelBufferView = nullptr};
-    vk::WriteDescriptorSet texture_descriptor_write{
-        .dstSet = context.descriptor_sets[i],
-        .dstBinding = 1,
-        .dstArrayElement = 0,
-        .descriptorCount = 1,
-        .descriptorType = vk::DescriptorType::eCombinedImageSampler,
-        .pImageInfo = &image_info};
-    std::array<vk::WriteDescriptorSet, 2> descriptor_write{
-        uniform_buffer_descriptor_write, texture_descriptor_write};
-
-    context.device.logical_device.updateDescriptorSets(descriptor_write, 0);
+  if (!loaded) {
+    // The callback only starts on the source image when the read failed, not
+    // when the file turned out to be unusable
+    if (!pending_texture.source_requested) {
+      pending_texture.source =
+          filesystem_read_async(pending_texture.queue,
+                                ASSETS_ROOT RENDERER_SOURCE_TEXTURE, nullptr,
+                                nullptr);
+    }
+    if (!filesystem_io_wait(pending_texture.queue, pending_texture.source,
+                            &file)) {
+      OE_LOG(LOG_LEVEL_ERROR, "Failed to read texture '%s'",
+             ASSETS_ROOT RENDERER_SOURCE_TEXTURE);
+      throw std::runtime_error("failed to load image file!");
+    }
+    create_texture_from_image(ASSETS_ROOT RENDERER_SOURCE_TEXTURE, file.data,
+                              file.size);
+    free(file.data);
+  }
+
+  filesystem_io_queue_destroy(pending_texture.queue);
+  pending_texture.queue = nullptr;
+}
+
+// Descriptors a pool holds per set, covers the per frame set and materials
+static const vulkan_descriptor_pool_ratio descriptor_ratios[] = {
+    {vk::DescriptorType::eUniformBufferDynamic, 1.0f},
+    {vk::DescriptorType::eUniformBuffer, 1.0f},
+    {vk::DescriptorType::eCombinedImageSampler, 2.0f},
+    {vk::DescriptorType::eStorageBuffer, 1.0f},
+};
+
+static const uint32_t descriptor_ratio_count =
+    sizeof(descriptor_ratios) / sizeof(descriptor_ratios[0]);
+
+// Per frame resources are created for the slots up to frames_in_flight that
+// don't have them yet, so the ring can grow at runtime. Slots past it are
+// kept when it shrinks, they're used again if it grows back.
+void create_descriptor_allocators() {
+  size_t first = context.frame_descriptors.size();
+  if (first < context.frames_in_flight) {
+    context.frame_descriptors.resize(context.frames_in_flight);
+  }
+  for (size_t i = first; i < context.frame_descriptors.size(); i++) {
+    vulkan_descriptor_allocator_create(descriptor_ratios,
+                                       descriptor_ratio_count,
+                                       &context.frame_descriptors[i]);
+  }
+}
+
+void create_descriptor_set() {
+  size_t first = context.descriptor_sets.size();
+  if (first < context.frames_in_flight) {
+    context.descriptor_sets.resize(context.frames_in_flight);
+  }
+  for (size_t i = first; i < context.descriptor_sets.size(); i++) {
+    // Each draw picks its UniformBufferObject with a dynamic offset
+    std::array<vulkan_descriptor_binding, 2> bindings = {
+        vulkan_descriptor_binding{
+            .binding = 0,
+            .type = vk::DescriptorType::eUniformBufferDynamic,
+            .buffer = {.buffer = context.frame_arenas[i].buffer.handle,
+                       .offset = 0,
+                       .range = sizeof(UniformBufferObject)},
+        },
+        vulkan_descriptor_binding{
+            .binding = 1,
+            .type = vk::DescriptorType::eCombinedImageSampler,
+            .image = {.sampler = context.default_texture.sampler,
+                      .imageView = context.default_texture.image.view,
+                      .imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal},
+        },
+    };
+    // In bindless mode the texture is in the bindless table instead
+    uint32_t binding_count = context.bindless.set ? 1 : 2;
+    context.descriptor_sets[i] = vulkan_descriptor_cache_get(
+        &context, &context.descriptor_cache,
+        context.pipeline.descriptor_set_layout, bindings.data(),
+        binding_count);
+    if (!context.descriptor_sets[i]) {
+      throw std::runtime_error("failed to create descriptor set!");
+    }
   }
 }
 
 void create_buffers() {
   // TODO: Buffers shouldn't be hardcoded like this. Revist after geometry
   // system
+  // Geometry is read straight from the loader's storage, which on a warm
+  // start is the mapped mesh cache
+  const mesh_geometry *geometry = &scene_mesh.geometry;
+  const void *vertex_data = geometry->vertices;
+  vk::DeviceSize vertex_size = sizeof(Vertex) * geometry->vertex_count;
+  context.mesh_decode_transform = glm::identity<glm::mat4>();
+
+  std::vector<PackedVertex> packed_vertices;
+  if (context.mesh_vertex_format == VERTEX_FORMAT_PACKED) {
+    vertex_pack_decode decode;
+    vertex_packing_pack(geometry, &packed_vertices, &decode);
+    vertex_data = packed_vertices.data();
+    vertex_size = sizeof(PackedVertex) * geometry->vertex_count;
+    context.mesh_decode_transform =
+        glm::scale(glm::translate(glm::identity<glm::mat4>(), decode.offset),
+                   decode.scale);
+  }
+  vk::DeviceSize index_size =
+      (vk::DeviceSize)geometry->index_stride * geometry->index_count;
+  context.index_type = geometry->index_stride == sizeof(uint16_t)
+                           ? vk::IndexType::eUint16
+                           : vk::IndexType::eUint32;
+
   // Vertices
-  vulkan_buffer staging;
-  vulkan_buffer_create(&context, vk::BufferUsageFlagBits::eTransferSrc,
-                       vk::MemoryPropertyFlagBits::eHostVisible |
-                           vk::MemoryPropertyFlagBits::eHostCoherent,
-                       sizeof(vertices[0]) * vertices.size(), &staging);
-
-  vulkan_buffer_load_data(&context, &staging, 0, 0,
-                          sizeof(vertices[0]) * vertices.size(),
-                          vertices.data());
   vulkan_buffer_create(&context,
                        vk::BufferUsageFlagBits::eTransferDst |
                            vk::BufferUsageFlagBits::eVertexBuffer,
-                       vk::MemoryPropertyFlagBits::eDeviceLocal,
-                       sizeof(vertices[0]) * vertices.size(),
-                       &context.vert_buff);
-
-  vulkan_buffer_copy(&context, &staging, &context.vert_buff,
-                     sizeof(vertices[0]) * vertices.size());
+                       vk::MemoryPropertyFlagBits::eDeviceLocal, vertex_size,
+                       VULKAN_MEMORY_MESH, &context.vert_buff);
+  vulkan_staging_upload_buffer(&context, &context.upload, &context.vert_buff,
+                               0, vertex_data, vertex_size);
 
   // Indices
-  vulkan_buffer index_staging;
-  vulkan_buffer_create(&context, vk::BufferUsageFlagBits::eTransferSrc,
-                       vk::MemoryPropertyFlagBits::eHostVisible |
-                           vk::MemoryPropertyFlagBits::eHostCoherent,
-                       sizeof(indices[0]) * indices.size(), &index_staging);
   vulkan_buffer_create(&context,
                        vk::BufferUsageFlagBits::eTransferDst |
                            vk::BufferUsageFlagBits::eIndexBuffer,
-                       vk::MemoryPropertyFlagBits::eDeviceLocal,
-                       sizeof(indices[0]) * indices.size(),
-                       &context.index_buff);
-
-  vulkan_buffer_load_data(&context, &index_staging, 0, 0,
-                          sizeof(indices[0]) * indices.size(), indices.data());
+                       vk::MemoryPropertyFlagBits::eDeviceLocal, index_size,
+                       VULKAN_MEMORY_MESH, &context.index_buff);
+  vulkan_staging_upload_buffer(&context, &context.upload, &context.index_buff,
+                               0, geometry->indices, index_size);
+  // Both are copied on the transfer queue and read by the graphics queue
+  vulkan_upload_batch_release_buffer(
+      &context, &context.upload, context.vert_buff.handle,
+      vk::AccessFlagBits::eVertexAttributeRead,
+      vk::PipelineStageFlagBits::eVertexInput);
+  vulkan_upload_batch_release_buffer(&context, &context.upload,
+                                     context.index_buff.handle,
+                                     vk::AccessFlagBits::eIndexRead,
+                                     vk::PipelineStageFlagBits::eVertexInput);
+
+  // Everything is in the staging ring now, drop the CPU copy (or the mapping)
+  mesh_loader_release(&scene_mesh);
+  asset_data_release(&scene_mesh_data);
 
-  vulkan_buffer_copy(&context, &index_staging, &context.index_buff,
-                     sizeof(indices[0]) * indices.size());
+}
 
-  // Uniforms
-  context.uniform_buffers.resize(MAX_FRAMES_IN_FLIGHT);
-  context.uniform_buffer_memory.resize(MAX_FRAMES_IN_FLIGHT);
+// Uniforms, written fresh every frame
+static void create_frame_arenas() {
+  size_t first = context.frame_arenas.size();
+  if (first < context.frames_in_flight) {
+    context.frame_arenas.resize(context.frames_in_flight);
+  }
+  for (size_t i = first; i < context.frame_arenas.size(); i++) {
+    vulkan_frame_arena_create(&context, VULKAN_FRAME_ARENA_SIZE,
+                              &context.frame_arenas[i]);
+  }
+}
+// The scene's GPU copies are all there is, the CPU side was released after
+// upload, so eviction unloads them for good rather than dropping detail
+static vk::DeviceSize evict_scene_mesh(vk::DeviceSize wanted,
+                                       void *user_data) {
+  vk::DeviceSize size =
+      context.vert_buff.allocation.size + context.index_buff.allocation.size;
+  vulkan_deletion_queue_push_buffer(&context, &context.deletion_queue,
+                                    &context.vert_buff);
+  vulkan_deletion_queue_push_buffer(&context, &context.deletion_queue,
+                                    &context.index_buff);
+  return size;
+}
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vulkan_buffer_create(&context, vk::BufferUsageFlagBits::eUniformBuffer,
-                         vk::MemoryPropertyFlagBits::eHostVisible |
-                             vk::MemoryPropertyFlagBits::eHostCoherent,
-                         sizeof(UniformBufferObject),
-                         &context.uniform_buffers[i]);
-    // Map the memory here since we will be updating this *constantly*
-    vkMapMemory(
-        context.device.logical_device, context.uniform_buffers[i].memory, 0,
-        sizeof(UniformBufferObject), 0, &context.uniform_buffer_memory[i]);
+static vk::DeviceSize evict_default_texture(vk::DeviceSize wanted,
+                                            void *user_data) {
+  vk::DeviceSize size = context.default_texture.image.allocation.size;
+  if (context.bindless.set) {
+    vulkan_bindless_release_texture(&context.bindless,
+                                    context.default_texture.bindless_index);
   }
+  vulkan_deletion_queue_push_image(&context, &context.deletion_queue,
+                                   &context.default_texture.image);
+  return size;
+}
 
-  vulkan_buffer_destroy(&context, &index_staging);
-  vulkan_buffer_destroy(&context, &staging);
+static void register_scene_residency() {
+  context.mesh_residency = vulkan_residency_register(
+      &context.residency, VULKAN_MEMORY_MESH,
+      context.vert_buff.allocation.size + context.index_buff.allocation.size,
+      evict_scene_mesh, nullptr);
+  context.default_texture.residency_id = vulkan_residency_register(
+      &context.residency, VULKAN_MEMORY_TEXTURE,
+      context.default_texture.image.allocation.size, evict_default_texture,
+      nullptr);
 }
+
+// Frames are paced with graphics_timeline, the swapchain still needs binary
+// semaphores
 void create_sync_objects() {
-  context.image_available_semaphore.resize(MAX_FRAMES_IN_FLIGHT);
-  context.render_finished_semaphore.resize(MAX_FRAMES_IN_FLIGHT);
-  context.in_flight_fence.resize(MAX_FRAMES_IN_FLIGHT);
+  size_t first = context.frame_values.size();
+  if (first >= context.frames_in_flight) {
+    return;
+  }
+  context.image_available_semaphore.resize(context.frames_in_flight);
+  context.render_finished_semaphore.resize(context.frames_in_flight);
+  // 0 is reached from the start, so new slots don't wait
+  context.frame_values.resize(context.frames_in_flight, 0);
 
-  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = first; i < context.frames_in_flight; i++) {
     vk::SemaphoreCreateInfo sem_create_info{};
 
-    vk::FenceCreateInfo fence_create_info{
-        .flags = vk::FenceCreateFlagBits::eSignaled};
-
     context.image_available_semaphore[i] =
         context.device.logical_device.createSemaphore(sem_create_info);
     context.render_finished_semaphore[i] =
         context.device.logical_device.createSemaphore(sem_create_info);
-    context.in_flight_fence[i] =
-        context.device.logical_device.createFence(fence_create_info);
   }
   return;
 }
 
-void update_ubo(uint32_t frame_index) {
+// Writes the frame's uniforms into its arena
+// @returns The dynamic offset to draw the frame with
+static uint32_t update_ubo(uint32_t frame_index) {
   static auto start_time = std::chrono::high_resolution_clock::now();
 
   auto current_time = std::chrono::high_resolution_clock::now();
@@ -370,39 +590,134 @@ void update_ubo(uint32_t frame_index) {
   UniformBufferObject ubo{};
   // TODO: PULL FROM SOME KIND OF CONTROLLER/CAMERA.
   // Maybe should be passed in to this
-  ubo.model = glm::identity<glm::mat4>();
-  // glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f),
-  // glm::vec3(0.0f, 0.0f, 1.0f));
   ubo.view =
       glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
                   glm::vec3(0.0f, 0.0f, 1.0f));
-  ubo.proj = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f,
-                              // context.swapchain.extent.width /
-                              // (float)context.swapchain.extent.height,
+  ubo.proj = glm::perspective(glm::radians(45.0f),
+                              context.swapchain.extent.width /
+                                  (float)context.swapchain.extent.height,
                               0.1f, 10.0f);
   ubo.proj[1][1] *= -1;  // we're not in openGL
-  memcpy(context.uniform_buffer_memory[frame_index], &ubo, sizeof(ubo));
+  uint32_t offset = 0;
+  vulkan_frame_arena_push(&context.frame_arenas[frame_index], &ubo,
+                          sizeof(ubo), &offset);
+  return offset;
 }
-void renderer_backend_draw_frame() {
+
+void generate_framebuffers(backend_context *context);
+
+// Swaps in a swapchain sized to the window. The old one and the depth image
+// are retired through the deletion queue, frames in flight keep drawing to
+// them and nothing waits for the device.
+// @returns false while the window is minimized
+static bool recreate_swapchain() {
+  double start = platform_get_absolute_time();
+  if (!vulkan_swapchain_recreate(&context)) {
+    return false;
+  }
+  vulkan_deletion_queue_push_image(&context, &context.deletion_queue,
+                                   &context.depth_image);
+  create_depth_resources();
+  generate_framebuffers(&context);
+  // The retired objects are flushed with this frame slot, which then can't
+  // count as done before everything already submitted, in case the frame is
+  // skipped
+  context.frame_values[context.current_frame] =
+      context.graphics_timeline.submitted;
+  context.swapchain.out_of_date = false;
+  context.swapchain.recreate_count++;
+  context.swapchain.recreate_seconds += platform_get_absolute_time() - start;
+  return true;
+}
+
+// @returns false when there's no image to draw to, the frame is skipped
+static bool acquire_image(uint32_t *out_image_index) {
   vk::Device device = context.device.logical_device;
-  VK_CHECK(device.waitForFences(1,
-                                &context.in_flight_fence[context.current_frame],
-                                vk::True, UINT64_MAX));
-  VK_CHECK(
-      device.resetFences(1, &context.in_flight_fence[context.current_frame]));
+  vk::Semaphore semaphore =
+      context.image_available_semaphore[context.current_frame];
+  try {
+    vk::ResultValue<uint32_t> result = device.acquireNextImageKHR(
+        context.swapchain.handle, UINT64_MAX, semaphore, VK_NULL_HANDLE);
+    // A suboptimal image still presents, the swapchain is replaced next frame
+    if (result.result == vk::Result::eSuboptimalKHR) {
+      context.swapchain.out_of_date = true;
+    }
+    *out_image_index = result.value;
+    return true;
+  } catch (vk::OutOfDateKHRError &) {
+    // Nothing was acquired, so the semaphore is still unsignaled and the
+    // frame can go ahead on the new swapchain
+    if (!recreate_swapchain()) {
+      return false;
+    }
+  }
+  try {
+    *out_image_index =
+        device
+            .acquireNextImageKHR(context.swapchain.handle, UINT64_MAX,
+                                 semaphore, VK_NULL_HANDLE)
+            .value;
+    return true;
+  } catch (vk::OutOfDateKHRError &) {
+    context.swapchain.out_of_date = true;
+    return false;
+  }
+}
+
+// Records the latency of every timed frame graphics_timeline has passed
+static void resolve_frame_timings() {
+  if (frame_stats.pending.empty()) {
+    return;
+  }
+  // Refreshes completed up to the newest value if it isn't reached yet
+  vulkan_timeline_reached(&context, &context.graphics_timeline,
+                          frame_stats.pending.back().value);
+  double now = platform_get_absolute_time();
+  size_t done = 0;
+  while (done < frame_stats.pending.size() &&
+         frame_stats.pending[done].value <=
+             context.graphics_timeline.completed) {
+    frame_stats.latencies.push_back(now - frame_stats.pending[done].start);
+    done++;
+  }
+  frame_stats.pending.erase(frame_stats.pending.begin(),
+                            frame_stats.pending.begin() + done);
+}
 
+void renderer_backend_draw_frame() {
+  // Input was polled right before, so latency is measured from here
+  double frame_start = platform_get_absolute_time();
+  vulkan_timeline_wait(&context, &context.graphics_timeline,
+                       context.frame_values[context.current_frame]);
+  if (frame_stats.enabled) {
+    resolve_frame_timings();
+  }
+  // Nothing submitted up to this frame can use what was destroyed in it
+  vulkan_deletion_queue_flush(&context, &context.deletion_queue,
+                              context.current_frame);
+
+  if (context.swapchain.out_of_date && !recreate_swapchain()) {
+    return;
+  }
   uint32_t image_index;
-  vk::ResultValue<uint32_t> result = device.acquireNextImageKHR(
-      context.swapchain.handle, UINT64_MAX,
-      context.image_available_semaphore[context.current_frame], VK_NULL_HANDLE);
-  if (result.result != vk::Result::eSuccess) {
-    OE_LOG(LOG_LEVEL_ERROR, "Failed to acquire next image!");
+  if (!acquire_image(&image_index)) {
     return;
   }
   context.command_buffer[context.current_frame].reset();
-
-  update_ubo(context.current_frame);
-  renderer_backend_draw_image(image_index);
+  // Uploads recorded since the last frame start on the transfer queue, and
+  // finished ones are handed to the graphics queue ahead of this frame
+  vulkan_upload_batch_submit(&context, &context.upload);
+  vulkan_upload_batch_poll(&context, &context.upload);
+
+  // The frame has completed, so the GPU is done with its uniforms
+  // and transient descriptor sets
+  vulkan_frame_arena_reset(&context.frame_arenas[context.current_frame]);
+  vulkan_descriptor_allocator_reset(
+      &context, &context.frame_descriptors[context.current_frame]);
+  // Evicts what hasn't been drawn lately if over the memory budget
+  vulkan_residency_begin_frame(&context, &context.residency);
+  uint32_t uniform_offset = update_ubo(context.current_frame);
+  renderer_backend_draw_image(image_index, uniform_offset);
   // time to submit commands now
 
   vk::Semaphore wait_semaphores[] = {
@@ -410,41 +725,107 @@ void renderer_backend_draw_frame() {
   vk::PipelineStageFlags wait_stages[] = {
       vk::PipelineStageFlagBits::eColorAttachmentOutput};
 
-  vk::Semaphore signal_semaphores = {
-      context.render_finished_semaphore[context.current_frame]};
+  // The binary semaphore is for presenting, the timeline value for everything
+  // that waits on the frame. Binary semaphores ignore their value.
+  uint64_t frame_value = vulkan_timeline_next(&context.graphics_timeline);
+  context.frame_values[context.current_frame] = frame_value;
+  std::array<vk::Semaphore, 2> signal_semaphores = {
+      context.render_finished_semaphore[context.current_frame],
+      context.graphics_timeline.semaphore};
+  std::array<uint64_t, 2> signal_values = {0, frame_value};
+  uint64_t wait_value = 0;
+  vk::TimelineSemaphoreSubmitInfo timeline_info{
+      .waitSemaphoreValueCount = 1,
+      .pWaitSemaphoreValues = &wait_value,
+      .signalSemaphoreValueCount = 2,
+      .pSignalSemaphoreValues = signal_values.data(),
+  };
 
   vk::SubmitInfo submit_info{
+      .pNext = &timeline_info,
       .waitSemaphoreCount = 1,
       .pWaitSemaphores = wait_semaphores,
       .pWaitDstStageMask = wait_stages,
       .commandBufferCount = 1,
       .pCommandBuffers = &context.command_buffer[context.current_frame],
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores = &signal_semaphores,
+      .signalSemaphoreCount = 2,
+      .pSignalSemaphores = signal_semaphores.data(),
   };
 
-  context.device.graphics_queue.submit(
-      submit_info, context.in_flight_fence[context.current_frame]);
+  context.device.graphics_queue.submit(submit_info);
+  // Anything staged for this frame is free once it completes
+  vulkan_staging_retire(&context, &context.staging, &context.graphics_timeline,
+                        frame_value);
+  if (frame_stats.enabled) {
+    frame_stats.pending.push_back({frame_value, frame_start});
+  }
 
   vk::SwapchainKHR swapchains[] = {context.swapchain.handle};
   vk::PresentInfoKHR present_info{
       .waitSemaphoreCount = 1,
-      .pWaitSemaphores = &signal_semaphores,
+      .pWaitSemaphores = &signal_semaphores[0],
       .swapchainCount = 1,
       .pSwapchains = swapchains,
       .pImageIndices = &image_index,
       .pResults = nullptr,
   };
 
-  VK_CHECK(context.device.present_queue.presentKHR(present_info));
+  // Out of date still waits on the semaphore, so the frame can just be
+  // dropped from the screen
+  try {
+    vk::Result present_result =
+        context.device.present_queue.presentKHR(present_info);
+    if (present_result == vk::Result::eSuboptimalKHR) {
+      context.swapchain.out_of_date = true;
+    }
+  } catch (vk::OutOfDateKHRError &) {
+    context.swapchain.out_of_date = true;
+  }
 
   // ONCE DONE WITH FRAME, INCREMENT HERE
-  context.current_frame = (context.current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+  context.current_frame =
+      (context.current_frame + 1) % context.frames_in_flight;
 }
 
 // TODO: Rename this as 'draw image' is a slight misnomer as it does do that
 // however, it also primarily 'records commands' in vulkan terms
-void renderer_backend_draw_image(uint32_t image_index) {
+// Records drawing the scene mesh, inside the main render pass
+static void record_scene_draw(vk::CommandBuffer cmd_buff,
+                              uint32_t uniform_offset) {
+  vk::Buffer vertex_buffers[] = {context.vert_buff.handle};
+  vk::DeviceSize offsets[] = {0};
+  // context.command_buffer[context..current_frame]
+  cmd_buff.bindVertexBuffers(0, 1, vertex_buffers, offsets);
+
+  cmd_buff.bindIndexBuffer(context.index_buff.handle, 0, context.index_type);
+
+  // The frame's set, and the bindless table when there is one, in one bind
+  std::array<vk::DescriptorSet, 2> sets = {
+      context.descriptor_sets[context.current_frame], context.bindless.set};
+  cmd_buff.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                              context.pipeline.layout, 0,
+                              context.bindless.set ? 2 : 1, sets.data(), 1,
+                              &uniform_offset);
+
+  // Per object data is pushed with each draw
+  object_push_constants object{};
+  // Identity, apart from decoding packed positions
+  object.model = context.mesh_decode_transform;
+  object.material_index = 0;
+  object.texture_index = context.default_texture.bindless_index;
+  object.sampler_index = context.default_texture.sampler_index;
+  cmd_buff.pushConstants(
+      context.pipeline.layout,
+      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
+      sizeof(object), &object);
+
+  // WOOOOOOO
+  // TODO: make this like, way more configurable
+  cmd_buff.drawIndexed(scene_mesh.geometry.index_count, 1, 0, 0, 0);
+}
+
+void renderer_backend_draw_image(uint32_t image_index,
+                                 uint32_t uniform_offset) {
   auto cmd_buff =
       context.command_buffer[context.current_frame];  // Shorthand because we
                                                       // use this A TON
@@ -475,14 +856,6 @@ void renderer_backend_draw_image(uint32_t image_index) {
   cmd_buff.bindPipeline(vk::PipelineBindPoint::eGraphics,
                         context.pipeline.handle);
 
-  vk::Buffer vertex_buffers[] = {context.vert_buff.handle};
-  vk::DeviceSize offsets[] = {0};
-  // context.command_buffer[context..current_frame]
-  cmd_buff.bindVertexBuffers(0, 1, vertex_buffers, offsets);
-
-  cmd_buff.bindIndexBuffer(context.index_buff.handle, 0,
-                           vk::IndexType::eUint32);
-
   // Create viewport and scissor since we specified dynamic earlier
   vk::Viewport viewport{
       .x = 0.0f,
@@ -498,13 +871,15 @@ void renderer_backend_draw_image(uint32_t image_index) {
                      .extent = context.swapchain.extent};
   cmd_buff.setScissor(0, 1, &scissor);
 
-  cmd_buff.bindDescriptorSets(
-      vk::PipelineBindPoint::eGraphics, context.pipeline.layout, 0, 1,
-      &context.descriptor_sets[context.current_frame], 0, nullptr);
-
-  // WOOOOOOO
-  // TODO: make this like, way more configurable
-  cmd_buff.drawIndexed(indices.size(), 1, 0, 0, 0);
+  // Evicted resources are gone until reloaded, there's nothing to draw
+  uint32_t texture_residency = context.default_texture.residency_id;
+  if (vulkan_residency_is_resident(&context.residency,
+                                   context.mesh_residency) &&
+      vulkan_residency_is_resident(&context.residency, texture_residency)) {
+    vulkan_residency_touch(&context.residency, context.mesh_residency);
+    vulkan_residency_touch(&context.residency, texture_residency);
+    record_scene_draw(cmd_buff, uniform_offset);
+  }
 
   cmd_buff.endRenderPass();
 
@@ -529,14 +904,20 @@ void create_command_pool() {
   return;
 }
 void create_command_buffer() {
-  context.command_buffer.resize(MAX_FRAMES_IN_FLIGHT);
+  size_t first = context.command_buffer.size();
+  if (first >= context.frames_in_flight) {
+    return;
+  }
   vk::CommandBufferAllocateInfo cmdbuffer_alloc_info{
       .commandPool = context.command_pool,
       .level = vk::CommandBufferLevel::ePrimary,
       .commandBufferCount =
-          static_cast<uint32_t>(context.command_buffer.size())};
-  context.command_buffer = context.device.logical_device.allocateCommandBuffers(
-      cmdbuffer_alloc_info);
+          static_cast<uint32_t>(context.frames_in_flight - first)};
+  std::vector<vk::CommandBuffer> buffers =
+      context.device.logical_device.allocateCommandBuffers(
+          cmdbuffer_alloc_info);
+  context.command_buffer.insert(context.command_buffer.end(), buffers.begin(),
+                                buffers.end());
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
@@ -567,7 +948,90 @@ void generate_framebuffers(backend_context *context) {
   return;
 }
 
+void renderer_backend_set_present_config(
+    const renderer_present_config *config) {
+  context.present_config = *config;
+  if (context.swapchain.handle) {
+    context.swapchain.out_of_date = true;
+  }
+}
+
+void renderer_backend_set_frames_in_flight(uint32_t count) {
+  count = std::clamp(count, 1u, (uint32_t)RENDERER_MAX_FRAMES_IN_FLIGHT);
+  uint32_t old_count = context.frames_in_flight;
+  context.frames_in_flight = count;
+  // Before initializing there's nothing to resize
+  if (context.command_buffer.empty() || count == old_count) {
+    return;
+  }
+
+  // Dropped slots won't be flushed by draw_frame, their deletions run once
+  // the last frame that used them is done, which it usually already is
+  for (uint32_t i = count; i < old_count; i++) {
+    vulkan_timeline_wait(&context, &context.graphics_timeline,
+                         context.frame_values[i]);
+    vulkan_deletion_queue_flush(&context, &context.deletion_queue, i);
+  }
+  // Each slot still waits for its own last frame before it's reused, so the
+  // ring can change size between any two frames
+  create_command_buffer();
+  create_sync_objects();
+  create_frame_arenas();
+  create_descriptor_allocators();
+  create_descriptor_set();
+  context.current_frame %= count;
+  OE_LOG(LOG_LEVEL_INFO, "Frames in flight: %u", count);
+}
+
+void renderer_backend_begin_frame_stats() {
+  frame_stats = {};
+  frame_stats.enabled = true;
+  frame_stats.begin = platform_get_absolute_time();
+}
+
+void renderer_backend_end_frame_stats(renderer_frame_stats *out_stats) {
+  double end = platform_get_absolute_time();
+  // Frames still on the GPU are part of the run
+  if (!frame_stats.pending.empty()) {
+    vulkan_timeline_wait(&context, &context.graphics_timeline,
+                         frame_stats.pending.back().value);
+    resolve_frame_timings();
+  }
+
+  std::vector<double> &latencies = frame_stats.latencies;
+  *out_stats = {};
+  out_stats->frames_in_flight = context.frames_in_flight;
+  out_stats->frame_count = (uint32_t)latencies.size();
+  out_stats->seconds = end - frame_stats.begin;
+  if (!latencies.empty()) {
+    std::sort(latencies.begin(), latencies.end());
+    double total = 0.0;
+    for (double latency : latencies) {
+      total += latency;
+    }
+    size_t count = latencies.size();
+    out_stats->frames_per_second = count / out_stats->seconds;
+    out_stats->latency_average = total / count;
+    out_stats->latency_p50 = latencies[count / 2];
+    out_stats->latency_p99 = latencies[std::min(count - 1, count * 99 / 100)];
+    out_stats->latency_max = latencies.back();
+  }
+  frame_stats = {};
+}
+
+static void framebuffer_size_callback(GLFWwindow *window, int width,
+                                      int height) {
+  context.swapchain.out_of_date = true;
+}
+
 bool renderer_backend_initialize(platform_state *plat_state) {
+  // The texture is read in the background while the instance, device and
+  // pipeline are created, renderer_create_texture picks it up
+  begin_texture_reads();
+  if (context.frames_in_flight == 0) {
+    context.frames_in_flight = RENDERER_DEFAULT_FRAMES_IN_FLIGHT;
+  }
+
   // Initialize Vulkan Instance
 
   context.current_frame = 0;
@@ -690,6 +1154,7 @@ bool renderer_backend_initialize(platform_state *plat_state) {
 
   // Save a ref to the window from the plat platform state
   context.window = plat_state->window;
+  glfwSetFramebufferSizeCallback(context.window, framebuffer_size_callback);
   // Now make the surface - we're using GLFW so just....use it
   VkSurfaceKHR temp_surface;
   glfwCreateWindowSurface(context.instance.get(), context.window, nullptr,
@@ -702,6 +1167,7 @@ bool renderer_backend_initialize(platform_state *plat_state) {
     OE_LOG(LOG_LEVEL_FATAL, "Failed to find physical device!");
     return false;
   }
+  vulkan_allocator_create(&context);
 
   // Create swapchain and associated imageviews
   // TODO: Consider moving create_image_views into the swapchain create, not
@@ -714,26 +1180,62 @@ bool renderer_backend_initialize(platform_state *plat_state) {
 
   OE_LOG(LOG_LEVEL_INFO, "Main renderpass created");
 
+  // Bindless textures when the device can, the pipeline layout and the
+  // fragment shader depend on it
+  if (context.device.descriptor_indexing) {
+    vulkan_bindless_create(&context, &context.bindless);
+  }
+
   // Creates the pipeline as well.
   // TODO: support multiple...shaders/pipelines?
-  vulkan_shader_create(&context, &context.main_renderpass, "default.vert.spv",
-                       "default.frag.spv");
+  context.mesh_vertex_format = RENDERER_VERTEX_FORMAT;
+  vulkan_shader_create(&context, &context.main_renderpass,
+                       context.mesh_vertex_format == VERTEX_FORMAT_PACKED
+                           ? "packed.vert.spv"
+                           : "default.vert.spv",
+                       context.bindless.set ? "bindless.frag.spv"
+                                            : "default.frag.spv");
 
   create_command_pool();
   create_command_buffer();
+  vulkan_timeline_create(&context, "Graphics", &context.graphics_timeline);
+  vulkan_timeline_create(&context, "Transfer", &context.transfer_timeline);
+  vulkan_staging_create(&context, VULKAN_STAGING_RING_SIZE, &context.staging);
+  vulkan_upload_batch_create(&context, &context.staging, &context.upload);
 
   create_depth_resources();
   generate_framebuffers(&context);
 
   // Create command buffers
   create_sync_objects();
+  // A list for every slot the ring can grow to
+  vulkan_deletion_queue_create(RENDERER_MAX_FRAMES_IN_FLIGHT,
+                               &context.deletion_queue);
 
   create_buffers();
+  create_frame_arenas();
 
   renderer_create_texture();
+  if (context.bindless.set) {
+    context.default_texture.bindless_index = vulkan_bindless_register_texture(
+        &context, &context.bindless, context.default_texture.image.view,
+        vk::ImageLayout::eShaderReadOnlyOptimal);
+    context.default_texture.sampler_index = vulkan_bindless_register_sampler(
+        &context, &context.bindless, context.default_texture.sampler);
+  }
+  register_scene_residency();
 
-  create_descriptor_pool();
+  vulkan_descriptor_cache_create(descriptor_ratios, descriptor_ratio_count,
+                                 &context.descriptor_cache);
+  create_descriptor_allocators();
   create_descriptor_set();
+
+  // The first frame needs everything, so startup is the one place that waits
+  vulkan_upload_batch_wait(&context, &context.upload);
+  OE_LOG(LOG_LEVEL_INFO, "Startup uploads: %u commands in %u submits",
+         context.upload.total_commands, context.upload.submit_count);
+  vulkan_staging_log_stats(&context.staging);
+  vulkan_allocator_log_stats(&context);
   return true;
 }
 
@@ -744,24 +1246,21 @@ void renderer_backend_shutdown() {
   try {
     OE_LOG(LOG_LEVEL_INFO, "Renderer shutting down");
     device.waitIdle();
+    vulkan_deletion_queue_destroy(&context, &context.deletion_queue);
 
     OE_LOG(LOG_LEVEL_INFO, "Destroying scene buffers");
     vulkan_buffer_destroy(&context, &context.vert_buff);
     vulkan_buffer_destroy(&context, &context.index_buff);
 
     OE_LOG(LOG_LEVEL_INFO, "Destroying uniforms");
-    device.destroyImage(context.depth_image.handle, nullptr);
-    device.destroyImageView(context.depth_image.view, nullptr);
-    device.freeMemory(context.depth_image.memory, nullptr);
+    vulkan_image_destroy(&context, &context.depth_image);
 
-    for (size_t i = 0; i < context.uniform_buffers.size(); i++) {
-      vulkan_buffer_destroy(&context, &context.uniform_buffers[i]);
+    for (size_t i = 0; i < context.frame_arenas.size(); i++) {
+      vulkan_frame_arena_destroy(&context, &context.frame_arenas[i]);
     }
     // Free textures
     // TODO: Only default texture for now
-    device.destroyImageView(context.default_texture.image.view, nullptr);
-    device.destroyImage(context.default_texture.image.handle, nullptr);
-    device.freeMemory(context.default_texture.image.memory, nullptr);
+    vulkan_image_destroy(&context, &context.default_texture.image);
     device.destroySampler(context.default_texture.sampler);
 
     device.destroyPipeline(context.pipeline.handle);
@@ -769,20 +1268,41 @@ void renderer_backend_shutdown() {
     //                   nullptr);
 
     device.destroyPipelineLayout(context.pipeline.layout);
-    device.destroyDescriptorPool(context.descriptor_pool);
+    for (size_t i = 0; i < context.frame_descriptors.size(); i++) {
+      vulkan_descriptor_allocator_destroy(&context,
+                                          &context.frame_descriptors[i]);
+    }
+    vulkan_descriptor_cache_destroy(&context, &context.descriptor_cache);
+    if (context.bindless.set) {
+      vulkan_bindless_destroy(&context, &context.bindless);
+    }
     device.destroyDescriptorSetLayout(context.pipeline.descriptor_set_layout);
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-      device.destroyFence(context.in_flight_fence[i]);
+    for (size_t i = 0; i < context.frame_values.size(); i++) {
       device.destroySemaphore(context.image_available_semaphore[i]);
       device.destroySemaphore(context.render_finished_semaphore[i]);
     }
+    vulkan_upload_batch_destroy(&context, &context.upload);
+    vulkan_timeline_log_stats(&context.graphics_timeline);
+    vulkan_timeline_log_stats(&context.transfer_timeline);
+    vulkan_timeline_destroy(&context, &context.graphics_timeline);
+    vulkan_timeline_destroy(&context, &context.transfer_timeline);
     device.destroyCommandPool(context.command_pool);
     device.destroyRenderPass(context.main_renderpass.handle);
 
     OE_LOG(LOG_LEVEL_INFO, "Destroying swapchain");
+    if (context.swapchain.recreate_count > 0) {
+      OE_LOG(LOG_LEVEL_INFO, "Swapchain recreated %u times, %.3f ms average",
+             context.swapchain.recreate_count,
+             context.swapchain.recreate_seconds * 1000.0 /
+                 context.swapchain.recreate_count);
+    }
     vulkan_swapchain_destroy(&context);
 
+    vulkan_staging_destroy(&context, &context.staging);
+    vulkan_residency_log_stats(&context, &context.residency);
+    vulkan_allocator_log_stats(&context);
+    vulkan_allocator_destroy(&context);
     device.destroy();
 
     vkDestroySurfaceKHR(context.instance.get(), context.surface, nullptr);
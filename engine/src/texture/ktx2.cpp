@@ -0,0 +1,112 @@
+#include "engine/texture/ktx2.h"
+
+#include <cstring>
+
+#include "engine/logger.h"
+
+uint32_t ktx2_format_block_size(uint32_t vk_format,
+                                uint32_t *out_block_dimension) {
+  uint32_t block_dimension = 4;
+  uint32_t block_size = 0;
+  switch (vk_format) {
+    case KTX2_VK_FORMAT_R8G8B8A8_UNORM:
+    case KTX2_VK_FORMAT_R8G8B8A8_SRGB:
+      block_dimension = 1;
+      block_size = 4;
+      break;
+    case KTX2_VK_FORMAT_BC1_RGB_UNORM:
+    case KTX2_VK_FORMAT_BC1_RGB_SRGB:
+      block_size = 8;
+      break;
+    case KTX2_VK_FORMAT_BC3_UNORM:
+    case KTX2_VK_FORMAT_BC3_SRGB:
+    case KTX2_VK_FORMAT_BC7_UNORM:
+    case KTX2_VK_FORMAT_BC7_SRGB:
+      block_size = 16;
+      break;
+    default:
+      break;
+  }
+  if (out_block_dimension) {
+    *out_block_dimension = block_dimension;
+  }
+  return block_size;
+}
+
+bool ktx2_load_memory(const void *data, size_t size, const char *name,
+                      ktx2_texture *out_texture) {
+  *out_texture = {};
+  if (size < KTX2_IDENTIFIER_SIZE + sizeof(ktx2_header)) {
+    OE_LOG(LOG_LEVEL_ERROR, "KTX2 texture '%s' is truncated", name);
+    return false;
+  }
+
+  const uint8_t *base = (const uint8_t *)data;
+  static const uint8_t identifier[KTX2_IDENTIFIER_SIZE] = KTX2_IDENTIFIER;
+  ktx2_header header;
+  memcpy(&header, base + KTX2_IDENTIFIER_SIZE, sizeof(header));
+  size_t level_index_offset = KTX2_IDENTIFIER_SIZE + sizeof(header);
+  uint32_t block_dimension = 1;
+  uint32_t block_size =
+      ktx2_format_block_size(header.vk_format, &block_dimension);
+
+  bool valid =
+      memcmp(base, identifier, KTX2_IDENTIFIER_SIZE) == 0 &&
+      block_size != 0 && header.pixel_width > 0 && header.pixel_height > 0 &&
+      header.pixel_depth == 0 && header.layer_count == 0 &&
+      header.face_count == 1 && header.level_count > 0 &&
+      header.level_count <= 32 && header.supercompression_scheme == 0 &&
+      level_index_offset + header.level_count * sizeof(ktx2_level_index) <=
+          size;
+  if (!valid) {
+    OE_LOG(LOG_LEVEL_ERROR, "Unsupported or invalid KTX2 texture '%s'", name);
+    return false;
+  }
+
+  out_texture->levels.resize(header.level_count);
+  for (uint32_t i = 0; i < header.level_count; i++) {
+    ktx2_level_index index;
+    memcpy(&index, base + level_index_offset + i * sizeof(index),
+           sizeof(index));
+
+    ktx2_level *level = &out_texture->levels[i];
+    level->width = header.pixel_width >> i ? header.pixel_width >> i : 1;
+    level->height = header.pixel_height >> i ? header.pixel_height >> i : 1;
+    size_t blocks_x = (level->width + block_dimension - 1) / block_dimension;
+    size_t blocks_y = (level->height + block_dimension - 1) / block_dimension;
+    size_t expected_size = blocks_x * blocks_y * block_size;
+    if (index.byte_length != expected_size ||
+        index.byte_offset + index.byte_length > size) {
+      OE_LOG(LOG_LEVEL_ERROR, "KTX2 texture '%s' has a bad level %u", name, i);
+      out_texture->levels.clear();
+      return false;
+    }
+    level->data = base + index.byte_offset;
+    level->size = index.byte_length;
+  }
+
+  out_texture->vk_format = header.vk_format;
+  out_texture->width = header.pixel_width;
+  out_texture->height = header.pixel_height;
+  return true;
+}
+
+bool ktx2_load(const char *path, ktx2_texture *out_texture) {
+  // Every byte is about to be copied to a staging buffer
+  file_mapping mapping;
+  if (!filesystem_map(path, FILE_MAP_HINT_WILLNEED, &mapping)) {
+    *out_texture = {};
+    return false;
+  }
+  if (!ktx2_load_memory(mapping.data, mapping.size, path, out_texture)) {
+    filesystem_unmap(&mapping);
+    return false;
+  }
+  out_texture->mapping = mapping;
+  return true;
+}
+
+void ktx2_close(ktx2_texture *texture) {
+  filesystem_unmap(&texture->mapping);
+  *texture = {};
+}
@@ -0,0 +1,215 @@
+#include "engine/texture/mipmap.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIPMAP_SSE2 1
+#endif
+
+#define MIPMAP_LINEAR_LUT_SIZE 65536
+
+// sRGB <-> linear conversion tables. Decoding has one entry per byte value,
+// encoding is indexed by linear intensity quantized to 16 bits, which is fine
+// enough to round correctly even in the darkest sRGB steps.
+typedef struct srgb_tables {
+  float to_linear[256];
+  uint8_t to_srgb[MIPMAP_LINEAR_LUT_SIZE];
+} srgb_tables;
+
+static const srgb_tables *get_srgb_tables() {
+  static const srgb_tables *tables = [] {
+    srgb_tables *t = new srgb_tables;
+    for (int i = 0; i < 256; i++) {
+      float c = i / 255.0f;
+      t->to_linear[i] = c <= 0.04045f ? c / 12.92f
+                                      : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i < MIPMAP_LINEAR_LUT_SIZE; i++) {
+      float l = i / (float)(MIPMAP_LINEAR_LUT_SIZE - 1);
+      float c = l <= 0.0031308f ? l * 12.92f
+                                : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+      t->to_srgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+    }
+    return t;
+  }();
+  return tables;
+}
+
+typedef struct downsample_job {
+  const uint8_t *source;
+  uint32_t source_width;
+  uint32_t source_height;
+  uint8_t *destination;
+  uint32_t destination_width;
+  uint32_t first_row;
+  uint32_t end_row;
+  const srgb_tables *srgb;
+} downsample_job;
+
+static inline void box_unorm(const uint8_t *a, const uint8_t *b,
+                             const uint8_t *c, const uint8_t *d,
+                             uint8_t *out) {
+  for (int channel = 0; channel < 4; channel++) {
+    out[channel] =
+        (uint8_t)((a[channel] + b[channel] + c[channel] + d[channel] + 2) >> 2);
+  }
+}
+
+static inline void box_srgb(const srgb_tables *srgb, const uint8_t *a,
+                            const uint8_t *b, const uint8_t *c,
+                            const uint8_t *d, uint8_t *out) {
+  const float *lut = srgb->to_linear;
+  float scale = 0.25f * (MIPMAP_LINEAR_LUT_SIZE - 1);
+#ifdef MIPMAP_SSE2
+  // One texel per register, the alpha lane is unused
+  __m128 sum = _mm_add_ps(
+      _mm_add_ps(_mm_set_ps(0.0f, lut[a[2]], lut[a[1]], lut[a[0]]),
+                 _mm_set_ps(0.0f, lut[b[2]], lut[b[1]], lut[b[0]])),
+      _mm_add_ps(_mm_set_ps(0.0f, lut[c[2]], lut[c[1]], lut[c[0]]),
+                 _mm_set_ps(0.0f, lut[d[2]], lut[d[1]], lut[d[0]])));
+  __m128i quantized = _mm_cvtps_epi32(_mm_mul_ps(sum, _mm_set1_ps(scale)));
+  int32_t values[4];
+  _mm_storeu_si128((__m128i *)values, quantized);
+#else
+  int32_t values[3];
+  for (int channel = 0; channel < 3; channel++) {
+    float sum = lut[a[channel]] + lut[b[channel]] + lut[c[channel]] +
+                lut[d[channel]];
+    values[channel] = (int32_t)(sum * scale + 0.5f);
+  }
+#endif
+  for (int channel = 0; channel < 3; channel++) {
+    out[channel] = srgb->to_srgb[values[channel]];
+  }
+  // Alpha is linear already
+  out[3] = (uint8_t)((a[3] + b[3] + c[3] + d[3] + 2) >> 2);
+}
+
+#ifdef MIPMAP_SSE2
+// Averages 4x2 source texels into 2 destination texels
+static inline void box_unorm_sse2(const uint8_t *row0, const uint8_t *row1,
+                                  uint8_t *out) {
+  __m128i zero = _mm_setzero_si128();
+  __m128i top = _mm_loadu_si128((const __m128i *)row0);
+  __m128i bottom = _mm_loadu_si128((const __m128i *)row1);
+  // Vertical sums, texels 0-1 and 2-3 as 16 bit channels
+  __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(top, zero),
+                              _mm_unpacklo_epi8(bottom, zero));
+  __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(top, zero),
+                               _mm_unpackhi_epi8(bottom, zero));
+  // Horizontal sums end up in the low half of each
+  low = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+  high = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+  __m128i sum = _mm_unpacklo_epi64(low, high);
+  sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+  _mm_storel_epi64((__m128i *)out, _mm_packus_epi16(sum, zero));
+}
+#endif
+
+static void downsample_rows(const downsample_job *job) {
+  uint32_t source_width = job->source_width;
+  for (uint32_t y = job->first_row; y < job->end_row; y++) {
+    // Odd sizes clamp to the last row/column
+    uint32_t y0 = 2 * y;
+    uint32_t y1 = y0 + 1 < job->source_height ? y0 + 1 : y0;
+    const uint8_t *row0 = job->source + (size_t)y0 * source_width * 4;
+    const uint8_t *row1 = job->source + (size_t)y1 * source_width * 4;
+    uint8_t *out = job->destination + (size_t)y * job->destination_width * 4;
+
+    uint32_t x = 0;
+#ifdef MIPMAP_SSE2
+    if (!job->srgb) {
+      // Each step reads 4 source texels, stop while they are all in the row
+      for (; 2 * x + 4 <= source_width && x + 2 <= job->destination_width;
+           x += 2) {
+        box_unorm_sse2(row0 + 8 * x, row1 + 8 * x, out + 4 * x);
+      }
+    }
+#endif
+    for (; x < job->destination_width; x++) {
+      uint32_t x0 = 2 * x;
+      uint32_t x1 = x0 + 1 < source_width ? x0 + 1 : x0;
+      if (job->srgb) {
+        box_srgb(job->srgb, row0 + 4 * x0, row0 + 4 * x1, row1 + 4 * x0,
+                 row1 + 4 * x1, out + 4 * x);
+      } else {
+        box_unorm(row0 + 4 * x0, row0 + 4 * x1, row1 + 4 * x0, row1 + 4 * x1,
+                  out + 4 * x);
+      }
+    }
+  }
+}
+
+uint32_t mipmap_level_count(uint32_t width, uint32_t height) {
+  uint32_t size = width > height ? width : height;
+  uint32_t count = 1;
+  while (size > 1) {
+    size >>= 1;
+    count++;
+  }
+  return count;
+}
+
+void mipmap_generate(const uint8_t *pixels, uint32_t width, uint32_t height,
+                     bool srgb, uint32_t thread_count, mip_chain *out_chain) {
+  if (thread_count == 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  if (thread_count == 0) {
+    thread_count = 1;
+  }
+
+  uint32_t level_count = mipmap_level_count(width, height);
+  out_chain->levels.resize(level_count);
+  size_t total_size = 0;
+  for (uint32_t i = 0; i < level_count; i++) {
+    mip_level *level = &out_chain->levels[i];
+    level->width = width >> i ? width >> i : 1;
+    level->height = height >> i ? height >> i : 1;
+    level->offset = total_size;
+    level->size = (size_t)level->width * level->height * 4;
+    total_size += level->size;
+  }
+  out_chain->pixels.resize(total_size);
+  memcpy(out_chain->pixels.data(), pixels, out_chain->levels[0].size);
+
+  const srgb_tables *tables = srgb ? get_srgb_tables() : nullptr;
+  std::vector<downsample_job> jobs;
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < level_count; i++) {
+    const mip_level *source = &out_chain->levels[i - 1];
+    const mip_level *destination = &out_chain->levels[i];
+
+    // Split the level's rows between threads, levels themselves run in order
+    uint32_t texels = destination->width * destination->height;
+    uint32_t job_count = texels / MIPMAP_MIN_TEXELS_PER_THREAD + 1;
+    job_count = job_count < thread_count ? job_count : thread_count;
+    job_count = job_count < destination->height ? job_count
+                                                 : destination->height;
+    jobs.resize(job_count);
+    for (uint32_t j = 0; j < job_count; j++) {
+      jobs[j] = {
+          .source = out_chain->pixels.data() + source->offset,
+          .source_width = source->width,
+          .source_height = source->height,
+          .destination = out_chain->pixels.data() + destination->offset,
+          .destination_width = destination->width,
+          .first_row = destination->height * j / job_count,
+          .end_row = destination->height * (j + 1) / job_count,
+          .srgb = tables,
+      };
+    }
+
+    threads.clear();
+    for (uint32_t j = 1; j < job_count; j++) {
+      threads.emplace_back(downsample_rows, &jobs[j]);
+    }
+    downsample_rows(&jobs[0]);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+}
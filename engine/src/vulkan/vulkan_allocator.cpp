@@ -0,0 +1,318 @@
+#include "engine/vulkan/vulkan_allocator.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "engine/logger.h"
+#include "engine/memory/tlsf.h"
+#include "engine/vulkan/vulkan_buffer.h"
+
+// One vkDeviceMemory that resources are suballocated from
+typedef struct vulkan_memory_block {
+  vk::DeviceMemory memory;
+  void* mapped;
+  tlsf_allocator ranges;
+  uint32_t pool;
+} vulkan_memory_block;
+
+// Blocks of one memory type, for one kind of resource
+typedef struct vulkan_memory_pool {
+  uint32_t memory_type;
+  vk::DeviceSize block_size;
+  std::vector<vulkan_memory_block*> blocks;
+} vulkan_memory_pool;
+
+struct vulkan_allocator {
+  vk::Device device;
+  vk::PhysicalDeviceMemoryProperties properties;
+  // Buffers and images get separate pools when this is above 1
+  vk::DeviceSize buffer_image_granularity;
+  // Two per memory type, indexed by memory type * 2 + resource kind
+  std::vector<vulkan_memory_pool> pools;
+  std::mutex mutex;
+
+  uint32_t dedicated_count;
+  vk::DeviceSize dedicated_bytes;
+  vk::DeviceSize dedicated_heap_bytes[VK_MAX_MEMORY_HEAPS];
+  vk::DeviceSize category_bytes[VULKAN_MEMORY_CATEGORY_COUNT];
+  uint64_t total_allocations;
+  uint64_t total_frees;
+};
+
+static uint32_t heap_of(const vulkan_allocator* allocator, uint32_t type) {
+  return allocator->properties.memoryTypes[type].heapIndex;
+}
+
+static bool is_host_visible(const vulkan_allocator* allocator, uint32_t type) {
+  return (bool)(allocator->properties.memoryTypes[type].propertyFlags &
+                vk::MemoryPropertyFlagBits::eHostVisible);
+}
+
+// Allocates and, if host visible, maps a whole vkDeviceMemory
+static bool allocate_memory(vulkan_allocator* allocator, uint32_t type,
+                            vk::DeviceSize size, vk::Image dedicated_image,
+                            vk::DeviceMemory* out_memory, void** out_mapped) {
+  vk::MemoryDedicatedAllocateInfo dedicated_info{.image = dedicated_image};
+  vk::MemoryAllocateInfo alloc_info{
+      .pNext = dedicated_image ? &dedicated_info : nullptr,
+      .allocationSize = size,
+      .memoryTypeIndex = type,
+  };
+  if (allocator->device.allocateMemory(&alloc_info, nullptr, out_memory) !=
+      vk::Result::eSuccess) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to allocate %llu bytes of memory type %u",
+           (unsigned long long)size, type);
+    return false;
+  }
+
+  *out_mapped = nullptr;
+  if (is_host_visible(allocator, type) &&
+      allocator->device.mapMemory(*out_memory, 0, VK_WHOLE_SIZE,
+                                  vk::MemoryMapFlags(), out_mapped) !=
+          vk::Result::eSuccess) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to map memory type %u", type);
+    allocator->device.freeMemory(*out_memory);
+    return false;
+  }
+  return true;
+}
+
+static vulkan_memory_block* create_block(vulkan_allocator* allocator,
+                                         uint32_t pool_index) {
+  vulkan_memory_pool* pool = &allocator->pools[pool_index];
+  vulkan_memory_block* block = new vulkan_memory_block{};
+  if (!allocate_memory(allocator, pool->memory_type, pool->block_size,
+                       nullptr, &block->memory, &block->mapped)) {
+    delete block;
+    return nullptr;
+  }
+  tlsf_create(pool->block_size, &block->ranges);
+  block->pool = pool_index;
+  pool->blocks.push_back(block);
+  return block;
+}
+
+static void destroy_block(vulkan_allocator* allocator,
+                          vulkan_memory_block* block) {
+  // Unmapped implicitly
+  allocator->device.freeMemory(block->memory);
+  delete block;
+}
+
+bool vulkan_allocator_create(backend_context* context) {
+  vulkan_allocator* allocator = new vulkan_allocator{};
+  allocator->device = context->device.logical_device;
+  allocator->properties = context->device.memory;
+  allocator->buffer_image_granularity =
+      context->device.properties.limits.bufferImageGranularity;
+
+  allocator->pools.resize(allocator->properties.memoryTypeCount * 2);
+  for (uint32_t i = 0; i < allocator->properties.memoryTypeCount; i++) {
+    uint32_t heap = allocator->properties.memoryTypes[i].heapIndex;
+    vk::DeviceSize heap_size = allocator->properties.memoryHeaps[heap].size;
+    vk::DeviceSize block_size = VULKAN_ALLOCATOR_BLOCK_SIZE;
+    if (heap_size / 8 < block_size) {
+      // Small heaps, eg. the 256 MB of device local host visible memory
+      block_size = heap_size / 8;
+    }
+    for (uint32_t kind = 0; kind < 2; kind++) {
+      allocator->pools[i * 2 + kind].memory_type = i;
+      allocator->pools[i * 2 + kind].block_size = block_size;
+    }
+  }
+
+  context->allocator = allocator;
+  OE_LOG(LOG_LEVEL_DEBUG,
+         "Memory allocator created, bufferImageGranularity %llu",
+         (unsigned long long)allocator->buffer_image_granularity);
+  return true;
+}
+
+void vulkan_allocator_destroy(backend_context* context) {
+  vulkan_allocator* allocator = context->allocator;
+  if (!allocator) {
+    return;
+  }
+
+  vulkan_allocator_stats stats;
+  vulkan_allocator_get_stats(context, &stats);
+  if (stats.allocation_count > 0) {
+    OE_LOG(LOG_LEVEL_WARN, "%u device memory allocations leaked",
+           stats.allocation_count);
+  }
+  for (auto& pool : allocator->pools) {
+    for (vulkan_memory_block* block : pool.blocks) {
+      destroy_block(allocator, block);
+    }
+  }
+  delete allocator;
+  context->allocator = nullptr;
+}
+
+bool vulkan_allocator_allocate(backend_context* context,
+                               const vk::MemoryRequirements& requirements,
+                               vk::MemoryPropertyFlags properties,
+                               vulkan_resource_kind kind,
+                               vk::Image dedicated_image,
+                               vulkan_memory_category category,
+                               vulkan_allocation* out_allocation) {
+  vulkan_allocator* allocator = context->allocator;
+  *out_allocation = {};
+  out_allocation->category = category;
+  uint32_t type =
+      find_memory_type(context, requirements.memoryTypeBits, properties);
+  out_allocation->memory_type = type;
+  uint32_t pool_index = type * 2;
+  if (allocator->buffer_image_granularity > 1) {
+    pool_index += kind;
+  }
+
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  vulkan_memory_pool* pool = &allocator->pools[pool_index];
+
+  // Anything over half a block would mostly waste the rest of it
+  if (dedicated_image || requirements.size > pool->block_size / 2) {
+    if (!allocate_memory(allocator, type, requirements.size, dedicated_image,
+                         &out_allocation->memory, &out_allocation->mapped)) {
+      return false;
+    }
+    out_allocation->size = requirements.size;
+    allocator->dedicated_count++;
+    allocator->dedicated_bytes += requirements.size;
+    allocator->dedicated_heap_bytes[heap_of(allocator, type)] +=
+        requirements.size;
+    allocator->category_bytes[category] += requirements.size;
+    allocator->total_allocations++;
+    return true;
+  }
+
+  vulkan_memory_block* block = nullptr;
+  uint32_t node;
+  uint64_t offset;
+  for (vulkan_memory_block* candidate : pool->blocks) {
+    if (tlsf_allocate(&candidate->ranges, requirements.size,
+                      requirements.alignment, &node, &offset)) {
+      block = candidate;
+      break;
+    }
+  }
+  if (!block) {
+    block = create_block(allocator, pool_index);
+    if (!block || !tlsf_allocate(&block->ranges, requirements.size,
+                                 requirements.alignment, &node, &offset)) {
+      return false;
+    }
+  }
+
+  out_allocation->memory = block->memory;
+  out_allocation->offset = offset;
+  out_allocation->size = requirements.size;
+  out_allocation->mapped =
+      block->mapped ? (char*)block->mapped + offset : nullptr;
+  out_allocation->block = block;
+  out_allocation->node = node;
+  allocator->category_bytes[category] += requirements.size;
+  allocator->total_allocations++;
+  return true;
+}
+
+void vulkan_allocator_free(backend_context* context,
+                           vulkan_allocation* allocation) {
+  vulkan_allocator* allocator = context->allocator;
+  if (!allocation->memory) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  allocator->total_frees++;
+  allocator->category_bytes[allocation->category] -= allocation->size;
+  vulkan_memory_block* block = allocation->block;
+  if (!block) {
+    allocator->device.freeMemory(allocation->memory);
+    allocator->dedicated_count--;
+    allocator->dedicated_bytes -= allocation->size;
+    allocator->dedicated_heap_bytes[heap_of(allocator,
+                                            allocation->memory_type)] -=
+        allocation->size;
+    *allocation = {};
+    return;
+  }
+
+  tlsf_free(&block->ranges, allocation->node);
+  *allocation = {};
+
+  // Keep one empty block per pool around so a resource being recreated
+  // doesn't free and allocate a whole block
+  if (block->ranges.allocation_count == 0) {
+    vulkan_memory_pool* pool = &allocator->pools[block->pool];
+    for (vulkan_memory_block* other : pool->blocks) {
+      if (other != block && other->ranges.allocation_count == 0) {
+        pool->blocks.erase(
+            std::find(pool->blocks.begin(), pool->blocks.end(), block));
+        destroy_block(allocator, block);
+        break;
+      }
+    }
+  }
+}
+
+void vulkan_allocator_get_stats(backend_context* context,
+                                vulkan_allocator_stats* out_stats) {
+  vulkan_allocator* allocator = context->allocator;
+  std::lock_guard<std::mutex> lock(allocator->mutex);
+  *out_stats = {};
+  vk::DeviceSize free_bytes = 0;
+  for (const auto& pool : allocator->pools) {
+    for (const vulkan_memory_block* block : pool.blocks) {
+      out_stats->block_count++;
+      out_stats->allocation_count += block->ranges.allocation_count;
+      out_stats->block_bytes += block->ranges.size;
+      out_stats->block_used_bytes +=
+          block->ranges.size - block->ranges.free_size;
+      free_bytes += block->ranges.free_size;
+      vk::DeviceSize largest = tlsf_largest_free(&block->ranges);
+      if (largest > out_stats->largest_free_range) {
+        out_stats->largest_free_range = largest;
+      }
+    }
+  }
+  for (const auto& pool : allocator->pools) {
+    out_stats->heap_bytes[heap_of(allocator, pool.memory_type)] +=
+        pool.block_size * pool.blocks.size();
+  }
+  for (uint32_t i = 0; i < VK_MAX_MEMORY_HEAPS; i++) {
+    out_stats->heap_bytes[i] += allocator->dedicated_heap_bytes[i];
+  }
+  for (uint32_t i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++) {
+    out_stats->category_bytes[i] = allocator->category_bytes[i];
+  }
+  out_stats->dedicated_count = allocator->dedicated_count;
+  out_stats->dedicated_bytes = allocator->dedicated_bytes;
+  out_stats->allocation_count += allocator->dedicated_count;
+  out_stats->device_allocation_count =
+      out_stats->block_count + out_stats->dedicated_count;
+  out_stats->total_allocations = allocator->total_allocations;
+  out_stats->total_frees = allocator->total_frees;
+  out_stats->fragmentation =
+      free_bytes > 0 ? 1.0f - (float)out_stats->largest_free_range / free_bytes
+                     : 0.0f;
+}
+
+void vulkan_allocator_log_stats(backend_context* context) {
+  vulkan_allocator_stats stats;
+  vulkan_allocator_get_stats(context, &stats);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Device memory: %u allocations in %u blocks (%.1f / %.1f MB used) "
+         "and %u dedicated (%.1f MB), %u vkAllocateMemory objects",
+         stats.allocation_count - stats.dedicated_count, stats.block_count,
+         stats.block_used_bytes / (1024.0 * 1024.0),
+         stats.block_bytes / (1024.0 * 1024.0), stats.dedicated_count,
+         stats.dedicated_bytes / (1024.0 * 1024.0),
+         stats.device_allocation_count);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Device memory: %llu allocations and %llu frees so far, "
+         "fragmentation %.1f%%",
+         (unsigned long long)stats.total_allocations,
+         (unsigned long long)stats.total_frees, stats.fragmentation * 100.0f);
+}
@@ -0,0 +1,159 @@
+#include "engine/vulkan/vulkan_bindless.h"
+
+#include <algorithm>
+#include <array>
+
+#include "engine/logger.h"
+
+bool vulkan_bindless_create(backend_context* context,
+                            vulkan_bindless_table* out_table) {
+  *out_table = {};
+  if (!context->device.descriptor_indexing) {
+    OE_LOG(LOG_LEVEL_ERROR, "Bindless textures need descriptor indexing");
+    return false;
+  }
+  vk::Device device = context->device.logical_device;
+
+  auto properties = context->device.physical_device.getProperties2<
+      vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+  const vk::PhysicalDeviceVulkan12Properties& limits =
+      properties.get<vk::PhysicalDeviceVulkan12Properties>();
+  out_table->texture_capacity =
+      std::min({(uint32_t)VULKAN_BINDLESS_MAX_TEXTURES,
+                limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                limits.maxDescriptorSetUpdateAfterBindSampledImages});
+  out_table->sampler_capacity =
+      std::min({(uint32_t)VULKAN_BINDLESS_MAX_SAMPLERS,
+                limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+                limits.maxDescriptorSetUpdateAfterBindSamplers});
+
+  std::array<vk::DescriptorSetLayoutBinding, 2> bindings = {
+      vk::DescriptorSetLayoutBinding{
+          .binding = 0,
+          .descriptorType = vk::DescriptorType::eSampledImage,
+          .descriptorCount = out_table->texture_capacity,
+          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+      },
+      vk::DescriptorSetLayoutBinding{
+          .binding = 1,
+          .descriptorType = vk::DescriptorType::eSampler,
+          .descriptorCount = out_table->sampler_capacity,
+          .stageFlags = vk::ShaderStageFlagBits::eFragment,
+      },
+  };
+  vk::DescriptorBindingFlags binding_flags =
+      vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+      vk::DescriptorBindingFlagBits::ePartiallyBound;
+  std::array<vk::DescriptorBindingFlags, 2> flags = {binding_flags,
+                                                     binding_flags};
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo flags_info{
+      .bindingCount = static_cast<uint32_t>(flags.size()),
+      .pBindingFlags = flags.data(),
+  };
+  vk::DescriptorSetLayoutCreateInfo layout_info{
+      .pNext = &flags_info,
+      .flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+      .bindingCount = static_cast<uint32_t>(bindings.size()),
+      .pBindings = bindings.data(),
+  };
+  out_table->layout = device.createDescriptorSetLayout(layout_info);
+
+  std::array<vk::DescriptorPoolSize, 2> pool_sizes = {
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eSampledImage,
+                             .descriptorCount = out_table->texture_capacity},
+      vk::DescriptorPoolSize{.type = vk::DescriptorType::eSampler,
+                             .descriptorCount = out_table->sampler_capacity},
+  };
+  vk::DescriptorPoolCreateInfo pool_info{
+      .flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind,
+      .maxSets = 1,
+      .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+      .pPoolSizes = pool_sizes.data(),
+  };
+  out_table->pool = device.createDescriptorPool(pool_info);
+
+  vk::DescriptorSetAllocateInfo alloc_info{
+      .descriptorPool = out_table->pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &out_table->layout,
+  };
+  VK_CHECK(device.allocateDescriptorSets(&alloc_info, &out_table->set));
+
+  OE_LOG(LOG_LEVEL_INFO, "Bindless table: %u texture and %u sampler slots",
+         out_table->texture_capacity, out_table->sampler_capacity);
+  return true;
+}
+
+void vulkan_bindless_destroy(backend_context* context,
+                             vulkan_bindless_table* table) {
+  vk::Device device = context->device.logical_device;
+  // Frees the set with it
+  device.destroyDescriptorPool(table->pool);
+  device.destroyDescriptorSetLayout(table->layout);
+  *table = {};
+}
+
+uint32_t vulkan_bindless_register_texture(backend_context* context,
+                                          vulkan_bindless_table* table,
+                                          vk::ImageView view,
+                                          vk::ImageLayout layout) {
+  uint32_t index;
+  if (!table->free_textures.empty()) {
+    index = table->free_textures.back();
+    table->free_textures.pop_back();
+  } else if (table->texture_count < table->texture_capacity) {
+    index = table->texture_count++;
+  } else {
+    OE_LOG(LOG_LEVEL_ERROR, "Bindless table is out of texture slots (%u)",
+           table->texture_capacity);
+    return VULKAN_BINDLESS_INVALID_INDEX;
+  }
+
+  vk::DescriptorImageInfo image_info{.imageView = view, .imageLayout = layout};
+  vk::WriteDescriptorSet write{
+      .dstSet = table->set,
+      .dstBinding = 0,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eSampledImage,
+      .pImageInfo = &image_info,
+  };
+  context->device.logical_device.updateDescriptorSets(1, &write, 0, nullptr);
+  return index;
+}
+
+void vulkan_bindless_release_texture(vulkan_bindless_table* table,
+                                     uint32_t index) {
+  // The descriptor stays as it is, partially bound sets don't mind as long
+  // as nothing indexes it
+  table->free_textures.push_back(index);
+}
+
+uint32_t vulkan_bindless_register_sampler(backend_context* context,
+                                          vulkan_bindless_table* table,
+                                          vk::Sampler sampler) {
+  auto found = std::find(table->samplers.begin(), table->samplers.end(),
+                         sampler);
+  if (found != table->samplers.end()) {
+    return (uint32_t)(found - table->samplers.begin());
+  }
+  if (table->samplers.size() >= table->sampler_capacity) {
+    OE_LOG(LOG_LEVEL_ERROR, "Bindless table is out of sampler slots (%u)",
+           table->sampler_capacity);
+    return VULKAN_BINDLESS_INVALID_INDEX;
+  }
+
+  uint32_t index = (uint32_t)table->samplers.size();
+  table->samplers.push_back(sampler);
+  vk::DescriptorImageInfo sampler_info{.sampler = sampler};
+  vk::WriteDescriptorSet write{
+      .dstSet = table->set,
+      .dstBinding = 1,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = vk::DescriptorType::eSampler,
+      .pImageInfo = &sampler_info,
+  };
+  context->device.logical_device.updateDescriptorSets(1, &write, 0, nullptr);
+  return index;
+}
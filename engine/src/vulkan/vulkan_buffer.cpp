@@ -3,7 +3,8 @@
 #include <cstring>
 #include <stdexcept>
 
-#include "engine/vulkan/vulkan_command_buffer.h"
+#include "engine/vulkan/vulkan_allocator.h"
+#include "engine/vulkan/vulkan_upload.h"
 
 uint32_t find_memory_type(backend_context* context, uint32_t type_filter,
                           vk::MemoryPropertyFlags properties) {
@@ -22,38 +23,27 @@ uint32_t find_memory_type(backend_context* context, uint32_t type_filter,
 
 void vulkan_buffer_destroy(backend_context* context, vulkan_buffer* buffer) {
   context->device.logical_device.destroyBuffer(buffer->handle, nullptr);
-  context->device.logical_device.freeMemory(buffer->memory);
+  vulkan_allocator_free(context, &buffer->allocation);
 }
 
 void vulkan_buffer_load_data(backend_context* context, vulkan_buffer* buffer,
                              long offset, uint32_t flags, long size,
                              const void* buff_data) {
-  void* data;
-  vkMapMemory(context->device.logical_device, buffer->memory, 0, size, 0,
-              &data);
-  memcpy(data, buff_data, (size_t)size);
-  vkUnmapMemory(context->device.logical_device, buffer->memory);
+  // Host visible memory stays mapped for the allocation's lifetime
+  OE_ASSERT(buffer->allocation.mapped != nullptr);
+  memcpy((char*)buffer->allocation.mapped + offset, buff_data, (size_t)size);
 }
-void vulkan_buffer_copy(backend_context* context, vulkan_buffer* source,
-                        vulkan_buffer* target, vk::DeviceSize size) {
-  VkCommandBuffer command_buffer =
-      vulkan_command_buffer_begin_single_time_commands(context);
-  // // Perform the copy
-  VkBufferCopy copy_info{};
-  copy_info.srcOffset = 0;
-  copy_info.dstOffset = 0;
-  copy_info.size = size;
-
-  vkCmdCopyBuffer(command_buffer, source->handle, target->handle, 1,
-                  &copy_info);
-
-  vulkan_command_buffer_end_single_time_commands(context, command_buffer);
-
-  return;
+void vulkan_buffer_copy(backend_context* context, vulkan_upload_batch* batch,
+                        vulkan_buffer* source, vulkan_buffer* target,
+                        vk::DeviceSize size) {
+  vk::BufferCopy copy_info{.srcOffset = 0, .dstOffset = 0, .size = size};
+  vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+      .copyBuffer(source->handle, target->handle, 1, &copy_info);
 }
 void vulkan_buffer_create(backend_context* context, vk::BufferUsageFlags usage,
                           vk::MemoryPropertyFlags properties,
-                          vk::DeviceSize size, vulkan_buffer* out_buffer) {
+                          vk::DeviceSize size, vulkan_memory_category category,
+                          vulkan_buffer* out_buffer) {
   vk::BufferCreateInfo buffer_ci{
       .size = size,
       .usage = usage,
@@ -66,15 +56,13 @@ void vulkan_buffer_create(backend_context* context, vk::BufferUsageFlags usage,
       context->device.logical_device.getBufferMemoryRequirements(
           out_buffer->handle);
 
-  auto mem_type_index =
-      find_memory_type(context, mem_reqs.memoryTypeBits, properties);
-  vk::MemoryAllocateInfo alloc_info{
-      .allocationSize = mem_reqs.size,
-      .memoryTypeIndex = mem_type_index,
-  };
-  out_buffer->memory =
-      context->device.logical_device.allocateMemory(alloc_info);
+  if (!vulkan_allocator_allocate(context, mem_reqs, properties,
+                                 VULKAN_RESOURCE_BUFFER, nullptr, category,
+                                 &out_buffer->allocation)) {
+    throw std::runtime_error("Failed to allocate buffer memory");
+  }
 
-  context->device.logical_device.bindBufferMemory(out_buffer->handle,
-                                                  out_buffer->memory, 0);
+  context->device.logical_device.bindBufferMemory(
+      out_buffer->handle, out_buffer->allocation.memory,
+      out_buffer->allocation.offset);
 }
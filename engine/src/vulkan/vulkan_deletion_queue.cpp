@@ -0,0 +1,137 @@
+#include "engine/vulkan/vulkan_deletion_queue.h"
+
+#include "engine/logger.h"
+#include "engine/vulkan/vulkan_allocator.h"
+
+static void run_deletion(backend_context* context, vulkan_deletion* deletion) {
+  vk::Device device = context->device.logical_device;
+  switch (deletion->kind) {
+    case VULKAN_DELETION_BUFFER:
+      device.destroyBuffer((VkBuffer)deletion->handle);
+      vulkan_allocator_free(context, &deletion->allocation);
+      break;
+    case VULKAN_DELETION_IMAGE:
+      device.destroyImage((VkImage)deletion->handle);
+      vulkan_allocator_free(context, &deletion->allocation);
+      break;
+    case VULKAN_DELETION_IMAGE_VIEW:
+      device.destroyImageView((VkImageView)deletion->handle);
+      break;
+    case VULKAN_DELETION_SAMPLER:
+      device.destroySampler((VkSampler)deletion->handle);
+      break;
+    case VULKAN_DELETION_PIPELINE:
+      device.destroyPipeline((VkPipeline)deletion->handle);
+      break;
+    case VULKAN_DELETION_PIPELINE_LAYOUT:
+      device.destroyPipelineLayout((VkPipelineLayout)deletion->handle);
+      break;
+    case VULKAN_DELETION_FRAMEBUFFER:
+      device.destroyFramebuffer((VkFramebuffer)deletion->handle);
+      break;
+    case VULKAN_DELETION_SWAPCHAIN:
+      device.destroySwapchainKHR((VkSwapchainKHR)deletion->handle);
+      break;
+  }
+}
+
+static void push(backend_context* context, vulkan_deletion_queue* queue,
+                 vulkan_deletion_kind kind, uint64_t handle,
+                 const vulkan_allocation* allocation) {
+  if (!handle) {
+    return;
+  }
+  vulkan_deletion deletion{.kind = kind, .handle = handle};
+  if (allocation) {
+    deletion.allocation = *allocation;
+  }
+  queue->frames[context->current_frame].push_back(deletion);
+}
+
+void vulkan_deletion_queue_create(uint32_t frame_count,
+                                  vulkan_deletion_queue* out_queue) {
+  *out_queue = {};
+  out_queue->frames.resize(frame_count);
+}
+
+void vulkan_deletion_queue_destroy(backend_context* context,
+                                   vulkan_deletion_queue* queue) {
+  for (uint32_t i = 0; i < queue->frames.size(); i++) {
+    vulkan_deletion_queue_flush(context, queue, i);
+  }
+  OE_LOG(LOG_LEVEL_DEBUG, "Deletion queue ran %llu deferred destroys",
+         (unsigned long long)queue->total_deletions);
+  *queue = {};
+}
+
+void vulkan_deletion_queue_flush(backend_context* context,
+                                 vulkan_deletion_queue* queue,
+                                 uint32_t frame) {
+  std::vector<vulkan_deletion>& pending = queue->frames[frame];
+  for (vulkan_deletion& deletion : pending) {
+    run_deletion(context, &deletion);
+  }
+  queue->total_deletions += pending.size();
+  pending.clear();
+}
+
+void vulkan_deletion_queue_push_buffer(backend_context* context,
+                                       vulkan_deletion_queue* queue,
+                                       vulkan_buffer* buffer) {
+  push(context, queue, VULKAN_DELETION_BUFFER,
+       (uint64_t)(VkBuffer)buffer->handle, &buffer->allocation);
+  *buffer = {};
+}
+
+void vulkan_deletion_queue_push_image(backend_context* context,
+                                      vulkan_deletion_queue* queue,
+                                      vulkan_image* image) {
+  // The view goes first, it references the image
+  push(context, queue, VULKAN_DELETION_IMAGE_VIEW,
+       (uint64_t)(VkImageView)image->view, nullptr);
+  push(context, queue, VULKAN_DELETION_IMAGE,
+       (uint64_t)(VkImage)image->handle, &image->allocation);
+  *image = {};
+}
+
+void vulkan_deletion_queue_push_image_view(backend_context* context,
+                                           vulkan_deletion_queue* queue,
+                                           vk::ImageView view) {
+  push(context, queue, VULKAN_DELETION_IMAGE_VIEW,
+       (uint64_t)(VkImageView)view, nullptr);
+}
+
+void vulkan_deletion_queue_push_sampler(backend_context* context,
+                                        vulkan_deletion_queue* queue,
+                                        vk::Sampler sampler) {
+  push(context, queue, VULKAN_DELETION_SAMPLER, (uint64_t)(VkSampler)sampler,
+       nullptr);
+}
+
+void vulkan_deletion_queue_push_pipeline(backend_context* context,
+                                         vulkan_deletion_queue* queue,
+                                         vk::Pipeline pipeline) {
+  push(context, queue, VULKAN_DELETION_PIPELINE,
+       (uint64_t)(VkPipeline)pipeline, nullptr);
+}
+
+void vulkan_deletion_queue_push_pipeline_layout(backend_context* context,
+                                                vulkan_deletion_queue* queue,
+                                                vk::PipelineLayout layout) {
+  push(context, queue, VULKAN_DELETION_PIPELINE_LAYOUT,
+       (uint64_t)(VkPipelineLayout)layout, nullptr);
+}
+
+void vulkan_deletion_queue_push_framebuffer(backend_context* context,
+                                            vulkan_deletion_queue* queue,
+                                            vk::Framebuffer framebuffer) {
+  push(context, queue, VULKAN_DELETION_FRAMEBUFFER,
+       (uint64_t)(VkFramebuffer)framebuffer, nullptr);
+}
+
+void vulkan_deletion_queue_push_swapchain(backend_context* context,
+                                          vulkan_deletion_queue* queue,
+                                          vk::SwapchainKHR swapchain) {
+  push(context, queue, VULKAN_DELETION_SWAPCHAIN,
+       (uint64_t)(VkSwapchainKHR)swapchain, nullptr);
+}
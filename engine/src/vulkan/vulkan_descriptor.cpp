@@ -0,0 +1,213 @@
+#include "engine/vulkan/vulkan_descriptor.h"
+
+#include <algorithm>
+
+#include "engine/logger.h"
+
+static vk::DescriptorPool create_pool(backend_context* context,
+                                      vulkan_descriptor_allocator* allocator) {
+  uint32_t set_count = allocator->sets_per_pool;
+  std::vector<vk::DescriptorPoolSize> pool_sizes;
+  for (const vulkan_descriptor_pool_ratio& ratio : allocator->ratios) {
+    pool_sizes.push_back(vk::DescriptorPoolSize{
+        .type = ratio.type,
+        .descriptorCount =
+            std::max(1u, (uint32_t)(ratio.per_set * (float)set_count)),
+    });
+  }
+  vk::DescriptorPoolCreateInfo pool_info{
+      .maxSets = set_count,
+      .poolSizeCount = static_cast<uint32_t>(pool_sizes.size()),
+      .pPoolSizes = pool_sizes.data(),
+  };
+  vk::DescriptorPool pool =
+      context->device.logical_device.createDescriptorPool(pool_info);
+
+  allocator->sets_per_pool =
+      std::min(set_count * 2, (uint32_t)VULKAN_DESCRIPTOR_MAX_SETS_PER_POOL);
+  OE_LOG(LOG_LEVEL_DEBUG, "Created descriptor pool for %u sets", set_count);
+  return pool;
+}
+
+// The pool to allocate from, creating one if every pool is full
+static vk::DescriptorPool current_pool(backend_context* context,
+                                       vulkan_descriptor_allocator* allocator) {
+  if (allocator->ready_pools.empty()) {
+    allocator->ready_pools.push_back(create_pool(context, allocator));
+  }
+  return allocator->ready_pools.back();
+}
+
+void vulkan_descriptor_allocator_create(
+    const vulkan_descriptor_pool_ratio* ratios, uint32_t ratio_count,
+    vulkan_descriptor_allocator* out_allocator) {
+  *out_allocator = {};
+  out_allocator->ratios.assign(ratios, ratios + ratio_count);
+  out_allocator->sets_per_pool = VULKAN_DESCRIPTOR_SETS_PER_POOL;
+}
+
+void vulkan_descriptor_allocator_destroy(
+    backend_context* context, vulkan_descriptor_allocator* allocator) {
+  vk::Device device = context->device.logical_device;
+  for (vk::DescriptorPool pool : allocator->ready_pools) {
+    device.destroyDescriptorPool(pool);
+  }
+  for (vk::DescriptorPool pool : allocator->full_pools) {
+    device.destroyDescriptorPool(pool);
+  }
+  *allocator = {};
+}
+
+void vulkan_descriptor_allocator_reset(
+    backend_context* context, vulkan_descriptor_allocator* allocator) {
+  vk::Device device = context->device.logical_device;
+  for (vk::DescriptorPool pool : allocator->ready_pools) {
+    device.resetDescriptorPool(pool);
+  }
+  for (vk::DescriptorPool pool : allocator->full_pools) {
+    device.resetDescriptorPool(pool);
+    allocator->ready_pools.push_back(pool);
+  }
+  allocator->full_pools.clear();
+  allocator->allocated_sets = 0;
+}
+
+bool vulkan_descriptor_allocator_allocate(
+    backend_context* context, vulkan_descriptor_allocator* allocator,
+    vk::DescriptorSetLayout layout, vk::DescriptorSet* out_set) {
+  vk::DescriptorSetAllocateInfo alloc_info{
+      .descriptorPool = current_pool(context, allocator),
+      .descriptorSetCount = 1,
+      .pSetLayouts = &layout,
+  };
+  vk::Result result =
+      context->device.logical_device.allocateDescriptorSets(&alloc_info,
+                                                            out_set);
+  if (result == vk::Result::eErrorOutOfPoolMemory ||
+      result == vk::Result::eErrorFragmentedPool) {
+    // Retire the pool until the next reset and try a fresh one
+    allocator->full_pools.push_back(allocator->ready_pools.back());
+    allocator->ready_pools.pop_back();
+    alloc_info.descriptorPool = current_pool(context, allocator);
+    result = context->device.logical_device.allocateDescriptorSets(&alloc_info,
+                                                                   out_set);
+  }
+  if (result != vk::Result::eSuccess) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to allocate descriptor set: %s",
+           vk::to_string(result).c_str());
+    return false;
+  }
+  allocator->allocated_sets++;
+  return true;
+}
+
+// FNV-1a, over whole 64 bit words
+static uint64_t hash_combine(uint64_t hash, uint64_t value) {
+  return (hash ^ value) * 0x100000001b3ull;
+}
+
+static uint64_t hash_bindings(vk::DescriptorSetLayout layout,
+                              const vulkan_descriptor_binding* bindings,
+                              uint32_t binding_count) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = hash_combine(hash, (uint64_t)(VkDescriptorSetLayout)layout);
+  for (uint32_t i = 0; i < binding_count; i++) {
+    const vulkan_descriptor_binding& binding = bindings[i];
+    hash = hash_combine(hash, binding.binding);
+    hash = hash_combine(hash, (uint64_t)binding.type);
+    hash = hash_combine(hash, (uint64_t)(VkBuffer)binding.buffer.buffer);
+    hash = hash_combine(hash, binding.buffer.offset);
+    hash = hash_combine(hash, binding.buffer.range);
+    hash = hash_combine(hash, (uint64_t)(VkSampler)binding.image.sampler);
+    hash = hash_combine(hash, (uint64_t)(VkImageView)binding.image.imageView);
+    hash = hash_combine(hash, (uint64_t)binding.image.imageLayout);
+  }
+  return hash;
+}
+
+static bool entry_matches(const vulkan_descriptor_cache_entry& entry,
+                          vk::DescriptorSetLayout layout,
+                          const vulkan_descriptor_binding* bindings,
+                          uint32_t binding_count) {
+  if (entry.layout != layout || entry.bindings.size() != binding_count) {
+    return false;
+  }
+  for (uint32_t i = 0; i < binding_count; i++) {
+    const vulkan_descriptor_binding& a = entry.bindings[i];
+    const vulkan_descriptor_binding& b = bindings[i];
+    if (a.binding != b.binding || a.type != b.type || a.buffer != b.buffer ||
+        a.image != b.image) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool is_buffer_type(vk::DescriptorType type) {
+  return type == vk::DescriptorType::eUniformBuffer ||
+         type == vk::DescriptorType::eUniformBufferDynamic ||
+         type == vk::DescriptorType::eStorageBuffer ||
+         type == vk::DescriptorType::eStorageBufferDynamic;
+}
+
+void vulkan_descriptor_cache_create(const vulkan_descriptor_pool_ratio* ratios,
+                                    uint32_t ratio_count,
+                                    vulkan_descriptor_cache* out_cache) {
+  *out_cache = {};
+  vulkan_descriptor_allocator_create(ratios, ratio_count,
+                                     &out_cache->allocator);
+}
+
+void vulkan_descriptor_cache_destroy(backend_context* context,
+                                     vulkan_descriptor_cache* cache) {
+  OE_LOG(LOG_LEVEL_DEBUG, "Descriptor cache: %u sets, %u hits, %u misses",
+         (uint32_t)cache->sets.size(), cache->hits, cache->misses);
+  vulkan_descriptor_allocator_destroy(context, &cache->allocator);
+  *cache = {};
+}
+
+vk::DescriptorSet vulkan_descriptor_cache_get(
+    backend_context* context, vulkan_descriptor_cache* cache,
+    vk::DescriptorSetLayout layout, const vulkan_descriptor_binding* bindings,
+    uint32_t binding_count) {
+  uint64_t key = hash_bindings(layout, bindings, binding_count);
+  auto found = cache->sets.find(key);
+  if (found != cache->sets.end() &&
+      entry_matches(found->second, layout, bindings, binding_count)) {
+    cache->hits++;
+    return found->second.set;
+  }
+  // On a collision the new set takes the slot, the old one stays valid for
+  // whoever holds it
+  cache->misses++;
+
+  vk::DescriptorSet set;
+  if (!vulkan_descriptor_allocator_allocate(context, &cache->allocator, layout,
+                                            &set)) {
+    return nullptr;
+  }
+  std::vector<vk::WriteDescriptorSet> writes;
+  for (uint32_t i = 0; i < binding_count; i++) {
+    const vulkan_descriptor_binding& binding = bindings[i];
+    bool buffer = is_buffer_type(binding.type);
+    writes.push_back(vk::WriteDescriptorSet{
+        .dstSet = set,
+        .dstBinding = binding.binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = binding.type,
+        .pImageInfo = buffer ? nullptr : &binding.image,
+        .pBufferInfo = buffer ? &binding.buffer : nullptr,
+    });
+  }
+  context->device.logical_device.updateDescriptorSets(
+      static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+  cache->sets[key] = vulkan_descriptor_cache_entry{
+      .layout = layout,
+      .bindings = std::vector<vulkan_descriptor_binding>(
+          bindings, bindings + binding_count),
+      .set = set,
+  };
+  return set;
+}
@@ -4,6 +4,8 @@
 #include <vulkan/vulkan.h>
 #include <vulkan/vulkan_core.h>
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "engine/logger.h"
@@ -36,6 +38,8 @@ void vulkan_device_query_swapchain_support(
 
   uint32_t format_count;
   out_support_info->formats = physical_device.getSurfaceFormatsKHR(surface);
+  out_support_info->present_modes =
+      physical_device.getSurfacePresentModesKHR(surface);
 
   return;
 }
@@ -188,6 +192,44 @@ bool physical_device_meets_requirements(
   return false;
 }
 
+// The features bindless textures need, all in core Vulkan 1.2
+static bool supports_descriptor_indexing(
+    vk::PhysicalDevice device, const vk::PhysicalDeviceProperties *properties) {
+  if (properties->apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+  auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                      vk::PhysicalDeviceVulkan12Features>();
+  const vk::PhysicalDeviceVulkan12Features &vulkan12 =
+      features.get<vk::PhysicalDeviceVulkan12Features>();
+  return vulkan12.runtimeDescriptorArray &&
+         vulkan12.descriptorBindingPartiallyBound &&
+         vulkan12.descriptorBindingSampledImageUpdateAfterBind &&
+         vulkan12.shaderSampledImageArrayNonUniformIndexing;
+}
+
+// Frame pacing and upload completion run on timeline semaphores, which every
+// Vulkan 1.2 device has
+static bool supports_timeline_semaphores(
+    vk::PhysicalDevice device, const vk::PhysicalDeviceProperties *properties) {
+  if (properties->apiVersion < VK_API_VERSION_1_2) {
+    return false;
+  }
+  auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                      vk::PhysicalDeviceVulkan12Features>();
+  return features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore;
+}
+
+static bool supports_extension(vk::PhysicalDevice device, const char *name) {
+  for (const vk::ExtensionProperties &extension :
+       device.enumerateDeviceExtensionProperties()) {
+    if (strcmp(extension.extensionName.data(), name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 bool select_physical_device(backend_context *context) {
   // query for GPUS that support vulkan
   std::vector<vk::PhysicalDevice> physical_devices =
@@ -227,6 +269,13 @@ bool select_physical_device(backend_context *context) {
     bool result = physical_device_meets_requirements(
         physical_devices[i], context->surface, &properties, &features,
         &requirements, &queue_info, &context->device.swapchain_support);
+    if (result &&
+        !supports_timeline_semaphores(physical_devices[i], &properties)) {
+      OE_LOG(LOG_LEVEL_INFO,
+             "Device '%s' has no timeline semaphores, skipping device.",
+             properties.deviceName.data());
+      result = false;
+    }
 
     if (result) {
       OE_LOG(LOG_LEVEL_INFO, "Selected device: '%s'.", properties.deviceName);
@@ -286,6 +335,14 @@ bool select_physical_device(backend_context *context) {
       context->device.properties = properties;
       context->device.features = features;
       context->device.memory = memory;
+      context->device.descriptor_indexing =
+          supports_descriptor_indexing(physical_devices[i], &properties);
+      OE_LOG(LOG_LEVEL_INFO, "Descriptor indexing: %s",
+             context->device.descriptor_indexing ? "yes" : "no");
+      context->device.memory_budget = supports_extension(
+          physical_devices[i], VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+      OE_LOG(LOG_LEVEL_INFO, "Memory budget: %s",
+             context->device.memory_budget ? "from the driver" : "estimated");
       break;
     }
   }
@@ -333,32 +390,57 @@ bool vulkan_device_create(backend_context *context) {
     indices[index++] = context->device.transfer_queue_index;
   }
 
+  // Without a transfer family of its own, uploads get a second graphics
+  // queue when the family has one
+  uint32_t graphics_queue_count = std::min(
+      2u, context->device.physical_device
+              .getQueueFamilyProperties()[context->device.graphics_queue_index]
+              .queueCount);
+
   std::vector<vk::DeviceQueueCreateInfo> queue_create_infos(32);
+  // Has to outlive createDevice
+  float queue_priorities[2] = {1.0f, 1.0f};
   for (uint32_t i = 0; i < index_count; ++i) {
     queue_create_infos[i].queueFamilyIndex = indices[i];
     queue_create_infos[i].queueCount = 1;
     if (indices[i] == context->device.graphics_queue_index) {
-      queue_create_infos[i].queueCount = 2;
+      queue_create_infos[i].queueCount = graphics_queue_count;
     }
     queue_create_infos[i].pNext = 0;
-    float queue_priority = 1.0f;
-    queue_create_infos[i].pQueuePriorities = &queue_priority;
+    queue_create_infos[i].pQueuePriorities = queue_priorities;
   }
 
   // Request device features.
   // TODO: should be config driven
   vk::PhysicalDeviceFeatures device_features = {};
   device_features.samplerAnisotropy = VK_TRUE;  // Request anistrophy
+  // Cooked KTX2 textures are BC compressed, when the device can sample them
+  device_features.textureCompressionBC =
+      context->device.features.textureCompressionBC;
+
+  vk::PhysicalDeviceVulkan12Features vulkan12_features{};
+  vulkan12_features.timelineSemaphore = vk::True;
+  if (context->device.descriptor_indexing) {
+    vulkan12_features.runtimeDescriptorArray = vk::True;
+    vulkan12_features.descriptorBindingPartiallyBound = vk::True;
+    vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = vk::True;
+    vulkan12_features.shaderSampledImageArrayNonUniformIndexing = vk::True;
+  }
 
-  const char *extension_names = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+  std::vector<const char *> extension_names = {
+      VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  if (context->device.memory_budget) {
+    extension_names.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
 
   vk::DeviceCreateInfo device_ci{
+      .pNext = &vulkan12_features,
       .queueCreateInfoCount = index_count,
       .pQueueCreateInfos = queue_create_infos.data(),
       .enabledLayerCount = 0,
       .ppEnabledLayerNames = 0,
-      .enabledExtensionCount = 1,
-      .ppEnabledExtensionNames = &extension_names,
+      .enabledExtensionCount = static_cast<uint32_t>(extension_names.size()),
+      .ppEnabledExtensionNames = extension_names.data(),
       .pEnabledFeatures = &device_features,
   };
 
@@ -380,6 +462,13 @@ bool vulkan_device_create(backend_context *context) {
       context->device.graphics_queue_index, 0);
   context->device.present_queue = context->device.logical_device.getQueue(
       context->device.present_queue_index, 0);
+  context->device.transfer_queue = context->device.logical_device.getQueue(
+      context->device.transfer_queue_index,
+      transfer_shares_graphics_queue ? graphics_queue_count - 1 : 0);
+  OE_LOG(LOG_LEVEL_INFO, "Uploads use %s",
+         !transfer_shares_graphics_queue ? "a dedicated transfer queue family"
+         : graphics_queue_count > 1      ? "a second graphics queue"
+                                         : "the graphics queue");
 
   return true;
 }
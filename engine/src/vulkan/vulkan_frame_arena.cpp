@@ -0,0 +1,64 @@
+#include "engine/vulkan/vulkan_frame_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "engine/logger.h"
+#include "engine/vulkan/vulkan_buffer.h"
+
+void vulkan_frame_arena_create(backend_context* context, vk::DeviceSize size,
+                               vulkan_frame_arena* out_arena) {
+  *out_arena = {};
+  vulkan_buffer_create(context,
+                       vk::BufferUsageFlagBits::eUniformBuffer |
+                           vk::BufferUsageFlagBits::eStorageBuffer,
+                       vk::MemoryPropertyFlagBits::eHostVisible |
+                           vk::MemoryPropertyFlagBits::eHostCoherent,
+                       size, VULKAN_MEMORY_UNIFORM, &out_arena->buffer);
+  out_arena->mapped = (char*)out_arena->buffer.allocation.mapped;
+  out_arena->size = size;
+  // Both are powers of two, so the larger is a multiple of the smaller
+  const VkPhysicalDeviceLimits& limits = context->device.properties.limits;
+  out_arena->alignment = std::max(limits.minUniformBufferOffsetAlignment,
+                                  limits.minStorageBufferOffsetAlignment);
+}
+
+void vulkan_frame_arena_destroy(backend_context* context,
+                                vulkan_frame_arena* arena) {
+  OE_LOG(LOG_LEVEL_DEBUG, "Frame arena used at most %llu of %llu bytes",
+         (unsigned long long)arena->high_water,
+         (unsigned long long)arena->size);
+  vulkan_buffer_destroy(context, &arena->buffer);
+  *arena = {};
+}
+
+void vulkan_frame_arena_reset(vulkan_frame_arena* arena) {
+  arena->high_water = std::max(arena->high_water, arena->offset);
+  arena->offset = 0;
+}
+
+bool vulkan_frame_arena_allocate(vulkan_frame_arena* arena,
+                                 vk::DeviceSize size, uint32_t* out_offset,
+                                 void** out_data) {
+  vk::DeviceSize offset =
+      (arena->offset + arena->alignment - 1) & ~(arena->alignment - 1);
+  if (offset + size > arena->size) {
+    OE_LOG(LOG_LEVEL_ERROR, "Frame arena out of space (%llu bytes)",
+           (unsigned long long)arena->size);
+    return false;
+  }
+  arena->offset = offset + size;
+  *out_offset = (uint32_t)offset;
+  *out_data = arena->mapped + offset;
+  return true;
+}
+
+bool vulkan_frame_arena_push(vulkan_frame_arena* arena, const void* data,
+                             vk::DeviceSize size, uint32_t* out_offset) {
+  void* destination;
+  if (!vulkan_frame_arena_allocate(arena, size, out_offset, &destination)) {
+    return false;
+  }
+  memcpy(destination, data, size);
+  return true;
+}
@@ -8,8 +8,9 @@
 #include <vulkan/vulkan_enums.hpp>
 #include <vulkan/vulkan_structs.hpp>
 
+#include "engine/vulkan/vulkan_allocator.h"
 #include "engine/vulkan/vulkan_buffer.h"
-#include "engine/vulkan/vulkan_command_buffer.h"
+#include "engine/vulkan/vulkan_upload.h"
 
 bool has_stencil_component(vk::Format format) {
   return format == vk::Format::eD32SfloatS8Uint ||
@@ -34,7 +35,7 @@ void vulkan_image_create_sampler(backend_context* context, vulkan_image* image,
       .compareEnable = VK_FALSE,
       .compareOp = vk::CompareOp::eAlways,
       .minLod = 0.0f,
-      .maxLod = VK_LOD_CLAMP_NONE,  // Use a proper value for maxLod if needed
+      .maxLod = static_cast<float>(image->mip_levels),
       .borderColor = vk::BorderColor::eIntOpaqueBlack,
       .unnormalizedCoordinates = VK_FALSE};
   *out_sampler = context->device.logical_device.createSampler(sampler_ci);
@@ -45,9 +46,11 @@ void vulkan_image_create_sampler(backend_context* context, vulkan_image* image,
  * vulkan_image pointer
  * @param context - The vulkan context needed to issue vulkan commands
  * @param image - The vulkan_image to save the image view into
+ * @param mip_levels - The number of levels the view covers, from level 0
  */
 void vulkan_image_create_view(backend_context* context, vk::Format format,
                               vk::ImageAspectFlagBits flags, vk::Image* image,
+                              uint32_t mip_levels,
                               vk::ImageView* out_image_view) {
   vk::ImageViewCreateInfo view_ci{
       .image = *image,
@@ -59,7 +62,7 @@ void vulkan_image_create_view(backend_context* context, vk::Format format,
                      .a = vk::ComponentSwizzle::eIdentity},
       .subresourceRange = {.aspectMask = flags,
                            .baseMipLevel = 0,
-                           .levelCount = 1,
+                           .levelCount = mip_levels,
                            .baseArrayLayer = 0,
                            .layerCount = 1
 
@@ -69,10 +72,9 @@ void vulkan_image_create_view(backend_context* context, vk::Format format,
   return;
 }
 void vulkan_image_copy_from_buffer(backend_context* context,
+                                   vulkan_upload_batch* batch,
                                    vulkan_buffer buffer, vulkan_image image,
                                    uint32_t height, uint32_t width) {
-  vk::CommandBuffer cmd_buf =
-      vulkan_command_buffer_begin_single_time_commands(context);
 
   vk::BufferImageCopy region{
       .bufferOffset = 0,
@@ -85,26 +87,33 @@ void vulkan_image_copy_from_buffer(backend_context* context,
       .imageOffset = {.x = 0, .y = 0, .z = 0},
       .imageExtent = {.width = width, .height = height, .depth = 1}};
 
-  cmd_buf.copyBufferToImage(buffer.handle, image.handle,
-                            vk::ImageLayout::eTransferDstOptimal, 1, &region);
+  vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+      .copyBufferToImage(buffer.handle, image.handle,
+                         vk::ImageLayout::eTransferDstOptimal, 1, &region);
+}
 
-  vulkan_command_buffer_end_single_time_commands(context, cmd_buf);
+void vulkan_image_copy_regions_from_buffer(backend_context* context,
+                                           vulkan_upload_batch* batch,
+                                           vulkan_buffer buffer,
+                                           vulkan_image image,
+                                           uint32_t region_count,
+                                           const vk::BufferImageCopy* regions) {
+  vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+      .copyBufferToImage(buffer.handle, image.handle,
+                         vk::ImageLayout::eTransferDstOptimal, region_count,
+                         regions);
 }
 
 void vulkan_image_transition_layout(backend_context* context,
+                                    vulkan_upload_batch* batch,
                                     vulkan_image* image, vk::Format format,
                                     vk::ImageLayout old_layout,
                                     vk::ImageLayout new_layout) {
-  vk::CommandBuffer cmd_buf =
-      vulkan_command_buffer_begin_single_time_commands(context);
-
   vk::ImageMemoryBarrier barrier{
       .oldLayout = old_layout,
       .newLayout = new_layout,
-      .srcQueueFamilyIndex =
-          context->device.transfer_queue_index | vk::QueueFamilyIgnored,
-      .dstQueueFamilyIndex =
-          context->device.transfer_queue_index | vk::QueueFamilyIgnored,
+      .srcQueueFamilyIndex = vk::QueueFamilyIgnored,
+      .dstQueueFamilyIndex = vk::QueueFamilyIgnored,
       .image = image->handle,
       .subresourceRange =
           {
@@ -153,16 +162,26 @@ void vulkan_image_transition_layout(backend_context* context,
     barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
   }
 
-  cmd_buf.pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(),
-                          static_cast<uint32_t>(0), nullptr,
-                          static_cast<uint32_t>(0), nullptr, 1, &barrier);
-
-  vulkan_command_buffer_end_single_time_commands(context, cmd_buf);
+  if (new_layout == vk::ImageLayout::eShaderReadOnlyOptimal) {
+    // Sampled on the graphics queue, so the image is handed over to it
+    vulkan_upload_batch_release_image(context, batch, barrier, dst_stage);
+    return;
+  }
+  // The transfer queue only knows transfer stages
+  vulkan_upload_queue queue = dst_stage == vk::PipelineStageFlagBits::eTransfer
+                                  ? VULKAN_UPLOAD_QUEUE_TRANSFER
+                                  : VULKAN_UPLOAD_QUEUE_GRAPHICS;
+  vulkan_upload_batch_record(context, batch, queue)
+      .pipelineBarrier(src_stage, dst_stage, vk::DependencyFlags(),
+                       static_cast<uint32_t>(0), nullptr,
+                       static_cast<uint32_t>(0), nullptr, 1, &barrier);
 }
 
 void vulkan_image_create(backend_context* context, uint32_t height,
-                         uint32_t width, vk::Format format,
+                         uint32_t width, uint32_t mip_levels,
+                         vk::Format format,
                          vk::Flags<vk::ImageUsageFlagBits> usage,
+                         vulkan_memory_category category,
                          vulkan_image* out_image) {
   vk::ImageCreateInfo image_ci{
       .flags = vk::ImageCreateFlags(),
@@ -174,7 +193,7 @@ void vulkan_image_create(backend_context* context, uint32_t height,
               .height = height,
               .depth = 1,
           },
-      .mipLevels = 1,
+      .mipLevels = mip_levels,
       .arrayLayers = 1,
       .samples = vk::SampleCountFlagBits::e1,
       .tiling = vk::ImageTiling::eOptimal,
@@ -184,21 +203,38 @@ void vulkan_image_create(backend_context* context, uint32_t height,
   };
 
   out_image->handle = context->device.logical_device.createImage(image_ci);
-
-  // Memory now
-  vk::MemoryRequirements mem_reqs =
-      context->device.logical_device.getImageMemoryRequirements(
-          out_image->handle);
-
-  vk::MemoryAllocateInfo alloc_info{
-      .allocationSize = mem_reqs.size,
-      .memoryTypeIndex =
-          find_memory_type(context, mem_reqs.memoryTypeBits,
-                           vk::MemoryPropertyFlagBits::eDeviceLocal),
-  };
-
-  out_image->memory = context->device.logical_device.allocateMemory(alloc_info);
+  out_image->mip_levels = mip_levels;
+
+  // Memory now. Drivers ask for dedicated memory for things like render
+  // targets, where it lets them use compression or placement tricks
+  vk::ImageMemoryRequirementsInfo2 reqs_info{.image = out_image->handle};
+  auto reqs = context->device.logical_device.getImageMemoryRequirements2<
+      vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(reqs_info);
+  const vk::MemoryDedicatedRequirements& dedicated_reqs =
+      reqs.get<vk::MemoryDedicatedRequirements>();
+  bool dedicated = dedicated_reqs.prefersDedicatedAllocation ||
+                   dedicated_reqs.requiresDedicatedAllocation;
+
+  if (!vulkan_allocator_allocate(
+          context, reqs.get<vk::MemoryRequirements2>().memoryRequirements,
+          vk::MemoryPropertyFlagBits::eDeviceLocal, VULKAN_RESOURCE_IMAGE,
+          dedicated ? out_image->handle : vk::Image(), category,
+          &out_image->allocation)) {
+    throw std::runtime_error("Failed to allocate image memory");
+  }
 
   context->device.logical_device.bindImageMemory(out_image->handle,
-                                                 out_image->memory, 0);
+                                                 out_image->allocation.memory,
+                                                 out_image->allocation.offset);
+}
+
+void vulkan_image_destroy(backend_context* context, vulkan_image* image) {
+  vk::Device device = context->device.logical_device;
+  if (image->view) {
+    device.destroyImageView(image->view, nullptr);
+  }
+  device.destroyImage(image->handle, nullptr);
+  vulkan_allocator_free(context, &image->allocation);
+  image->handle = nullptr;
+  image->view = nullptr;
 }
@@ -0,0 +1,186 @@
+#include "engine/vulkan/vulkan_memory_budget.h"
+
+#include <algorithm>
+
+#include "engine/logger.h"
+#include "engine/vulkan/vulkan_allocator.h"
+
+static const char* category_names[VULKAN_MEMORY_CATEGORY_COUNT] = {
+    "mesh", "texture", "render target", "staging", "uniform"};
+
+static double to_megabytes(vk::DeviceSize bytes) {
+  return bytes / (1024.0 * 1024.0);
+}
+
+void vulkan_memory_budget_query(backend_context* context,
+                                vulkan_memory_budget* out_budget) {
+  *out_budget = {};
+  const VkPhysicalDeviceMemoryProperties& memory = context->device.memory;
+
+  if (context->device.memory_budget) {
+    auto properties = context->device.physical_device.getMemoryProperties2<
+        vk::PhysicalDeviceMemoryProperties2,
+        vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    const vk::PhysicalDeviceMemoryBudgetPropertiesEXT& budget =
+        properties.get<vk::PhysicalDeviceMemoryBudgetPropertiesEXT>();
+    for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+      if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+        out_budget->budget += budget.heapBudget[i];
+        out_budget->usage += budget.heapUsage[i];
+      }
+    }
+    out_budget->from_driver = true;
+    return;
+  }
+
+  // Only counts this process's allocations, which is all the driver's budget
+  // would account for anyway minus other applications
+  vulkan_allocator_stats stats;
+  vulkan_allocator_get_stats(context, &stats);
+  for (uint32_t i = 0; i < memory.memoryHeapCount; i++) {
+    if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      out_budget->budget += (vk::DeviceSize)(memory.memoryHeaps[i].size *
+                                             VULKAN_MEMORY_BUDGET_FALLBACK);
+      out_budget->usage += stats.heap_bytes[i];
+    }
+  }
+}
+
+uint32_t vulkan_residency_register(vulkan_residency* residency,
+                                   vulkan_memory_category category,
+                                   vk::DeviceSize size,
+                                   vulkan_evict_callback evict,
+                                   void* user_data) {
+  uint32_t id;
+  if (!residency->free_entries.empty()) {
+    id = residency->free_entries.back();
+    residency->free_entries.pop_back();
+  } else {
+    id = (uint32_t)residency->entries.size();
+    residency->entries.push_back({});
+  }
+  residency->entries[id] = vulkan_resident{
+      .category = category,
+      .size = size,
+      .last_used = residency->frame,
+      .evict = evict,
+      .user_data = user_data,
+      .registered = true,
+  };
+  return id;
+}
+
+void vulkan_residency_unregister(vulkan_residency* residency, uint32_t id) {
+  OE_ASSERT(id < residency->entries.size() &&
+            residency->entries[id].registered);
+  residency->entries[id] = {};
+  residency->free_entries.push_back(id);
+}
+
+void vulkan_residency_touch(vulkan_residency* residency, uint32_t id) {
+  residency->entries[id].last_used = residency->frame;
+}
+
+void vulkan_residency_set_size(vulkan_residency* residency, uint32_t id,
+                               vk::DeviceSize size) {
+  residency->entries[id].size = size;
+}
+
+bool vulkan_residency_is_resident(const vulkan_residency* residency,
+                                  uint32_t id) {
+  return residency->entries[id].size > 0;
+}
+
+// Evicts least recently used resources until wanted bytes are freed
+// @returns Bytes freed
+static vk::DeviceSize evict(backend_context* context,
+                            vulkan_residency* residency,
+                            vk::DeviceSize wanted) {
+  std::vector<uint32_t> candidates;
+  for (uint32_t i = 0; i < residency->entries.size(); i++) {
+    const vulkan_resident& entry = residency->entries[i];
+    // Frames up to frame - frames_in_flight have been waited for
+    if (entry.registered && entry.size > 0 &&
+        entry.last_used + context->frames_in_flight <= residency->frame) {
+      candidates.push_back(i);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [residency](uint32_t a, uint32_t b) {
+              return residency->entries[a].last_used <
+                     residency->entries[b].last_used;
+            });
+
+  vk::DeviceSize freed = 0;
+  for (uint32_t id : candidates) {
+    if (freed >= wanted) {
+      break;
+    }
+    vulkan_resident* entry = &residency->entries[id];
+    vk::DeviceSize entry_freed =
+        std::min(entry->evict(wanted - freed, entry->user_data), entry->size);
+    if (entry_freed == 0) {
+      continue;
+    }
+    entry->size -= entry_freed;
+    freed += entry_freed;
+    residency->eviction_count++;
+    residency->evicted_bytes += entry_freed;
+    OE_LOG(LOG_LEVEL_DEBUG,
+           "Evicted %.2f MB of %s %u, last used %llu frames ago",
+           to_megabytes(entry_freed), category_names[entry->category], id,
+           (unsigned long long)(residency->frame - entry->last_used));
+  }
+  return freed;
+}
+
+void vulkan_residency_begin_frame(backend_context* context,
+                                  vulkan_residency* residency) {
+  residency->frame++;
+  if (residency->frame % VULKAN_RESIDENCY_CHECK_INTERVAL != 0) {
+    return;
+  }
+
+  vulkan_memory_budget_query(context, &residency->last_budget);
+  const vulkan_memory_budget& budget = residency->last_budget;
+  if (budget.usage <= budget.budget) {
+    residency->over_budget = false;
+    return;
+  }
+
+  vk::DeviceSize target =
+      (vk::DeviceSize)(budget.budget * VULKAN_MEMORY_BUDGET_TARGET);
+  vk::DeviceSize wanted = budget.usage - target;
+  vk::DeviceSize freed = evict(context, residency, wanted);
+  if (freed > 0) {
+    OE_LOG(LOG_LEVEL_INFO,
+           "Over the memory budget (%.1f / %.1f MB), evicted %.1f MB",
+           to_megabytes(budget.usage), to_megabytes(budget.budget),
+           to_megabytes(freed));
+  }
+  if (freed < wanted && !residency->over_budget) {
+    OE_LOG(LOG_LEVEL_WARN,
+           "Over the memory budget (%.1f / %.1f MB) with nothing left to evict",
+           to_megabytes(budget.usage), to_megabytes(budget.budget));
+  }
+  residency->over_budget = freed < wanted;
+}
+
+void vulkan_residency_log_stats(backend_context* context,
+                                vulkan_residency* residency) {
+  vulkan_memory_budget budget;
+  vulkan_memory_budget_query(context, &budget);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Memory budget: %.1f / %.1f MB device local (%s), %u evictions "
+         "freed %.1f MB",
+         to_megabytes(budget.usage), to_megabytes(budget.budget),
+         budget.from_driver ? "driver" : "estimated",
+         residency->eviction_count, to_megabytes(residency->evicted_bytes));
+
+  vulkan_allocator_stats stats;
+  vulkan_allocator_get_stats(context, &stats);
+  for (uint32_t i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++) {
+    OE_LOG(LOG_LEVEL_INFO, "  %s: %.2f MB", category_names[i],
+           to_megabytes(stats.category_bytes[i]));
+  }
+}
@@ -10,10 +10,10 @@
 #include "engine/renderer_types.inl"
 
 void create_descriptor_set(backend_context* context) {
-  // UBO
+  // UBO, at a dynamic offset in the frame's arena
   vk::DescriptorSetLayoutBinding ubo_layout_binding{
       .binding = 0,
-      .descriptorType = vk::DescriptorType::eUniformBuffer,
+      .descriptorType = vk::DescriptorType::eUniformBufferDynamic,
       .descriptorCount = 1,
       .stageFlags = vk::ShaderStageFlagBits::eVertex,
       .pImmutableSamplers = nullptr,
@@ -31,9 +31,11 @@ void create_descriptor_set(backend_context* context) {
 
   VkPipelineLayout pipeline_layout{};
 
-  vk::DescriptorSetLayoutCreateInfo layout_info{
-      .bindingCount = static_cast<uint32_t>(bindings.size()),
-      .pBindings = bindings.data()};
+  // Textures come from the bindless table when there is one
+  uint32_t binding_count =
+      context->bindless.set ? 1 : static_cast<uint32_t>(bindings.size());
+  vk::DescriptorSetLayoutCreateInfo layout_info{.bindingCount = binding_count,
+                                                .pBindings = bindings.data()};
 
   context->pipeline.descriptor_set_layout =
       context->device.logical_device.createDescriptorSetLayout(layout_info);
@@ -68,13 +70,23 @@ void vulkan_pipeline_create(backend_context* context,
       .pDynamicStates = dynamic_states.data(),
   };
   // get vertex descriptions
-  auto binding_description = Vertex::get_binding_description();
-  auto attrib_description = Vertex::get_attribute_descriptions();
+  std::array<vk::VertexInputBindingDescription, 1> binding_description;
+  std::vector<vk::VertexInputAttributeDescription> attrib_description;
+  if (context->mesh_vertex_format == VERTEX_FORMAT_PACKED) {
+    binding_description = PackedVertex::get_binding_description();
+    auto attributes = PackedVertex::get_attribute_descriptions();
+    attrib_description.assign(attributes.begin(), attributes.end());
+  } else {
+    binding_description = Vertex::get_binding_description();
+    auto attributes = Vertex::get_attribute_descriptions();
+    attrib_description.assign(attributes.begin(), attributes.end());
+  }
 
   vk::PipelineVertexInputStateCreateInfo vertex_input_ci{
       .vertexBindingDescriptionCount = binding_description.size(),
       .pVertexBindingDescriptions = binding_description.data(),
-      .vertexAttributeDescriptionCount = attrib_description.size(),
+      .vertexAttributeDescriptionCount =
+          static_cast<uint32_t>(attrib_description.size()),
       .pVertexAttributeDescriptions = attrib_description.data()};
 
   // We're triangle gamers here
@@ -145,18 +157,20 @@ void vulkan_pipeline_create(backend_context* context,
   };
   // Make the pipeline layout, this affects our uniforms (IE our VP part of
   // our MVP)
-  vk::PipelineLayoutCreateInfo pipeline_layout_infos{
-
-      .setLayoutCount = 1,
-      .pSetLayouts = &context->pipeline.descriptor_set_layout,
-      .pushConstantRangeCount = 0,
-      .pPushConstantRanges = nullptr};
-
+  // Per draw data, the fragment stage gets the material index
+  vk::PushConstantRange push_constant_range{
+      .stageFlags =
+          vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+      .offset = 0,
+      .size = sizeof(object_push_constants),
+  };
+  std::array<vk::DescriptorSetLayout, 2> set_layouts = {
+      context->pipeline.descriptor_set_layout, context->bindless.layout};
   vk::PipelineLayoutCreateInfo pipeline_layout_info{
-      .setLayoutCount = 1,
-      .pSetLayouts = &context->pipeline.descriptor_set_layout,
-      .pushConstantRangeCount = 0,
-      .pPushConstantRanges = nullptr,
+      .setLayoutCount = context->bindless.set ? 2u : 1u,
+      .pSetLayouts = set_layouts.data(),
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &push_constant_range,
   };
 
   out_pipeline->layout =
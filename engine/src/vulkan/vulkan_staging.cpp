@@ -0,0 +1,263 @@
+#include "engine/vulkan/vulkan_staging.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "engine/logger.h"
+#include "engine/platform.h"
+#include "engine/vulkan/vulkan_buffer.h"
+#include "engine/vulkan/vulkan_timeline.h"
+#include "engine/vulkan/vulkan_upload.h"
+
+static uint64_t align_up(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// Where size bytes fit, skipping to the start of the buffer rather than
+// running past its end
+static bool find_space(const vulkan_staging_ring* ring, uint64_t size,
+                       uint64_t alignment, uint64_t* out_position) {
+  uint64_t position = align_up(ring->write_position, alignment);
+  uint64_t offset = position % ring->size;
+  if (offset + size > ring->size) {
+    position += ring->size - offset;
+  }
+  if (position + size - ring->read_position > ring->size) {
+    return false;
+  }
+  *out_position = position;
+  return true;
+}
+
+// The largest allocation find_space would accept right now
+static uint64_t largest_space(const vulkan_staging_ring* ring,
+                              uint64_t alignment) {
+  uint64_t position = align_up(ring->write_position, alignment);
+  uint64_t used = position - ring->read_position;
+  if (used >= ring->size) {
+    return 0;
+  }
+  uint64_t free_bytes = ring->size - used;
+  uint64_t to_end = ring->size - position % ring->size;
+  if (free_bytes <= to_end) {
+    return free_bytes;
+  }
+  return std::max(to_end, free_bytes - to_end);
+}
+
+// Blocks until the oldest span is reclaimed
+static bool wait_for_oldest(backend_context* context,
+                            vulkan_staging_ring* ring) {
+  if (ring->in_flight.empty()) {
+    return false;
+  }
+  const vulkan_staging_span& oldest = ring->in_flight.front();
+  if (oldest.timeline) {
+    vulkan_timeline_wait(context, oldest.timeline, oldest.value);
+  }
+  vulkan_staging_reclaim(context, ring);
+  return true;
+}
+
+// Takes the next piece of an upload, a multiple of unit bytes. Rather than
+// trickle out small copies this waits for a quarter of the ring to free up.
+static uint64_t reserve_chunk(backend_context* context,
+                              vulkan_upload_batch* batch, uint64_t remaining,
+                              uint64_t alignment, uint64_t unit,
+                              vk::DeviceSize* out_offset, void** out_data) {
+  vulkan_staging_ring* ring = batch->staging;
+  if (unit > ring->size) {
+    OE_LOG(LOG_LEVEL_ERROR,
+           "Upload rows of %llu bytes don't fit in the staging ring",
+           (unsigned long long)unit);
+    throw std::runtime_error("staging ring too small");
+  }
+  uint64_t enough = std::min(remaining, std::max(unit, ring->size / 4));
+  uint64_t space;
+  for (;;) {
+    vulkan_staging_reclaim(context, ring);
+    space = largest_space(ring, alignment) / unit * unit;
+    if (space >= enough) {
+      break;
+    }
+    if (wait_for_oldest(context, ring)) {
+      continue;
+    }
+    // The rest of the ring holds the batch's own copies, which only free up
+    // once it's submitted
+    if (ring->write_position != ring->retired_position) {
+      vulkan_upload_batch_submit(context, batch);
+      continue;
+    }
+    if (space > 0) {
+      break;
+    }
+    OE_LOG(LOG_LEVEL_ERROR,
+           "Staging ring is full of writes that were never retired");
+    throw std::runtime_error("staging ring exhausted");
+  }
+
+  uint64_t chunk = std::min(remaining, space);
+  vulkan_staging_allocate(context, ring, chunk, alignment, out_offset,
+                          out_data);
+  return chunk;
+}
+
+void vulkan_staging_create(backend_context* context, vk::DeviceSize size,
+                           vulkan_staging_ring* out_ring) {
+  *out_ring = {};
+  vulkan_buffer_create(context, vk::BufferUsageFlagBits::eTransferSrc,
+                       vk::MemoryPropertyFlagBits::eHostVisible |
+                           vk::MemoryPropertyFlagBits::eHostCoherent,
+                       size, VULKAN_MEMORY_STAGING, &out_ring->buffer);
+  out_ring->mapped = (char*)out_ring->buffer.allocation.mapped;
+  out_ring->size = size;
+  OE_LOG(LOG_LEVEL_DEBUG, "Created %.1f MB staging ring",
+         size / (1024.0 * 1024.0));
+}
+
+void vulkan_staging_destroy(backend_context* context,
+                            vulkan_staging_ring* ring) {
+  vulkan_buffer_destroy(context, &ring->buffer);
+  *ring = {};
+}
+
+bool vulkan_staging_allocate(backend_context* context,
+                             vulkan_staging_ring* ring, vk::DeviceSize size,
+                             vk::DeviceSize alignment,
+                             vk::DeviceSize* out_offset, void** out_data) {
+  uint64_t position;
+  if (!find_space(ring, size, alignment, &position)) {
+    vulkan_staging_reclaim(context, ring);
+    if (!find_space(ring, size, alignment, &position)) {
+      return false;
+    }
+  }
+  ring->write_position = position + size;
+  *out_offset = position % ring->size;
+  *out_data = ring->mapped + *out_offset;
+  return true;
+}
+
+void vulkan_staging_retire(backend_context* context, vulkan_staging_ring* ring,
+                           vulkan_timeline* timeline, uint64_t value) {
+  if (ring->write_position == ring->retired_position) {
+    return;
+  }
+  ring->in_flight.push_back({timeline, value, ring->write_position});
+  ring->retired_position = ring->write_position;
+  vulkan_staging_reclaim(context, ring);
+}
+
+void vulkan_staging_reclaim(backend_context* context,
+                            vulkan_staging_ring* ring) {
+  size_t done = 0;
+  for (; done < ring->in_flight.size(); done++) {
+    const vulkan_staging_span* span = &ring->in_flight[done];
+    if (span->timeline &&
+        !vulkan_timeline_reached(context, span->timeline, span->value)) {
+      break;
+    }
+    ring->read_position = span->end;
+  }
+  ring->in_flight.erase(ring->in_flight.begin(),
+                        ring->in_flight.begin() + done);
+
+  // Once idle, start over at the beginning of the buffer so the next upload
+  // gets all of it in one piece
+  if (ring->in_flight.empty() &&
+      ring->write_position == ring->retired_position) {
+    uint64_t offset = ring->write_position % ring->size;
+    if (offset != 0) {
+      ring->write_position += ring->size - offset;
+    }
+    ring->read_position = ring->write_position;
+    ring->retired_position = ring->write_position;
+  }
+}
+
+void vulkan_staging_upload_buffer(backend_context* context,
+                                  vulkan_upload_batch* batch,
+                                  vulkan_buffer* buffer,
+                                  vk::DeviceSize buffer_offset,
+                                  const void* data, vk::DeviceSize size) {
+  vulkan_staging_ring* ring = batch->staging;
+  double start = platform_get_absolute_time();
+  uint32_t chunk_count = 0;
+  for (vk::DeviceSize done = 0; done < size; chunk_count++) {
+    vk::DeviceSize offset;
+    void* staging;
+    uint64_t chunk =
+        reserve_chunk(context, batch, size - done, 4, 1, &offset, &staging);
+    memcpy(staging, (const char*)data + done, chunk);
+
+    vk::BufferCopy region{.srcOffset = offset,
+                          .dstOffset = buffer_offset + done,
+                          .size = chunk};
+    vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+        .copyBuffer(ring->buffer.handle, buffer->handle, 1, &region);
+    done += chunk;
+  }
+
+  ring->bytes_uploaded += size;
+  ring->upload_seconds += platform_get_absolute_time() - start;
+  ring->split_upload_count += chunk_count > 1;
+}
+
+void vulkan_staging_upload_image(backend_context* context,
+                                 vulkan_upload_batch* batch,
+                                 vulkan_image* image, uint32_t level,
+                                 uint32_t width, uint32_t height,
+                                 uint32_t block_size, uint32_t block_dimension,
+                                 const void* data) {
+  vulkan_staging_ring* ring = batch->staging;
+  double start = platform_get_absolute_time();
+  uint64_t row_size = (uint64_t)(width + block_dimension - 1) /
+                      block_dimension * block_size;
+  uint32_t row_count = (height + block_dimension - 1) / block_dimension;
+  // Offsets have to be a multiple of the block size and of 4
+  uint64_t alignment = block_size > 4 ? block_size : 4;
+
+  uint32_t chunk_count = 0;
+  for (uint32_t row = 0; row < row_count; chunk_count++) {
+    vk::DeviceSize offset;
+    void* staging;
+    uint64_t chunk =
+        reserve_chunk(context, batch, (row_count - row) * row_size, alignment,
+                      row_size, &offset, &staging);
+    memcpy(staging, (const char*)data + row * row_size, chunk);
+
+    uint32_t rows = (uint32_t)(chunk / row_size);
+    uint32_t y = row * block_dimension;
+    vk::BufferImageCopy region{
+        .bufferOffset = offset,
+        .bufferRowLength = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .mipLevel = level,
+                             .baseArrayLayer = 0,
+                             .layerCount = 1},
+        .imageOffset = {.x = 0, .y = (int32_t)y, .z = 0},
+        .imageExtent = {.width = width,
+                        .height = std::min(rows * block_dimension, height - y),
+                        .depth = 1}};
+    vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+        .copyBufferToImage(ring->buffer.handle, image->handle,
+                           vk::ImageLayout::eTransferDstOptimal, 1, &region);
+    row += rows;
+  }
+
+  ring->bytes_uploaded += row_count * row_size;
+  ring->upload_seconds += platform_get_absolute_time() - start;
+  ring->split_upload_count += chunk_count > 1;
+}
+
+void vulkan_staging_log_stats(vulkan_staging_ring* ring) {
+  double megabytes = ring->bytes_uploaded / (1024.0 * 1024.0);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Staging: wrote %.2f MB in %.3f ms (%.1f MB/s), %u uploads split",
+         megabytes, ring->upload_seconds * 1000.0,
+         ring->upload_seconds > 0.0 ? megabytes / ring->upload_seconds : 0.0,
+         ring->split_upload_count);
+}
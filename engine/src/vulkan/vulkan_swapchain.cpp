@@ -8,6 +8,7 @@
 
 #include "engine/logger.h"
 #include "engine/renderer_types.inl"
+#include "engine/vulkan/vulkan_deletion_queue.h"
 #include "engine/vulkan/vulkan_image.h"
 
 vk::SurfaceFormatKHR swapchain_select_surface_format(
@@ -22,16 +23,22 @@ vk::SurfaceFormatKHR swapchain_select_surface_format(
   return available_formats[0];
 }
 
+static const vk::PresentModeKHR present_modes[RENDERER_PRESENT_MODE_COUNT] = {
+    vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eMailbox,
+    vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eFifoRelaxed};
+
 vk::PresentModeKHR swapchain_select_present_mode(
-    uint32_t present_mode_count, vk::PresentModeKHR *available_present_modes) {
-  for (int i = 0; i < present_mode_count; i++) {
-    if (available_present_modes[i] == vk::PresentModeKHR::eMailbox) {
-      OE_LOG(LOG_LEVEL_INFO, "Found mailbox present mode, selecting...");
-      return available_present_modes[i];
+    renderer_present_mode requested,
+    const std::vector<vk::PresentModeKHR> &available_present_modes) {
+  vk::PresentModeKHR wanted = present_modes[requested];
+  for (vk::PresentModeKHR mode : available_present_modes) {
+    if (mode == wanted) {
+      return mode;
     }
   }
-  // fallback
-  OE_LOG(LOG_LEVEL_INFO, "Mailbox present mode not found. Defaulting to FIFO");
+  // FIFO is the one mode every surface supports
+  OE_LOG(LOG_LEVEL_WARN, "Present mode %s not supported. Defaulting to FIFO",
+         vk::to_string(wanted).c_str());
   return vk::PresentModeKHR::eFifo;
 }
 
@@ -58,20 +65,31 @@ vk::Extent2D swapchain_select_extent(
   }
 }
 
-void create(backend_context *context) {
+void create(backend_context *context, vk::SwapchainKHR old_swapchain) {
+  // The extent and transform change with the window, so they can't be cached
+  // from device selection
+  context->device.swapchain_support.capabilities =
+      context->device.physical_device.getSurfaceCapabilitiesKHR(
+          context->surface);
   // Going to reference this a lot, so for convenience sake
   auto sc_s = context->device.swapchain_support;
 
   vk::SurfaceFormatKHR surface_format =
       swapchain_select_surface_format(sc_s.formats);
 
-  vk::PresentModeKHR present_mode =
-      swapchain_select_present_mode(sc_s.format_count, sc_s.present_modes);
+  vk::PresentModeKHR present_mode = swapchain_select_present_mode(
+      context->present_config.mode, sc_s.present_modes);
 
   vk::Extent2D extent =
       swapchain_select_extent(context->window, sc_s.capabilities);
 
-  uint32_t image_count = sc_s.capabilities.minImageCount + 1;
+  // One over the minimum lets the CPU acquire while the presentation engine
+  // holds the rest
+  uint32_t image_count = context->present_config.image_count;
+  if (image_count == 0) {
+    image_count = sc_s.capabilities.minImageCount + 1;
+  }
+  image_count = std::max(image_count, sc_s.capabilities.minImageCount);
 
   // Make sure we don't have too many images
   if (sc_s.capabilities.maxImageCount > 0 &&
@@ -96,7 +114,7 @@ void create(backend_context *context) {
   vk::SwapchainCreateInfoKHR sc_ci{
       .flags = {},
       .surface = context->surface,
-      .minImageCount = 2,
+      .minImageCount = image_count,
       .imageFormat = vk::Format::eB8G8R8A8Srgb,
       .imageColorSpace = vk::ColorSpaceKHR::eSrgbNonlinear,
       .imageExtent = extent,
@@ -107,9 +125,9 @@ void create(backend_context *context) {
       .pQueueFamilyIndices = queue_family_indices.data(),
       .preTransform = sc_s.capabilities.currentTransform,
       .compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque,
-      .presentMode = vk::PresentModeKHR::eFifo,
+      .presentMode = present_mode,
       .clipped = VK_TRUE,
-      .oldSwapchain = nullptr};
+      .oldSwapchain = old_swapchain};
 
   context->swapchain.handle =
       context->device.logical_device.createSwapchainKHR(sc_ci);
@@ -127,6 +145,9 @@ void create(backend_context *context) {
   // We'll want these later
   context->swapchain.image_format = surface_format.format;
   context->swapchain.extent = extent;
+  context->swapchain.present_mode = present_mode;
+  OE_LOG(LOG_LEVEL_INFO, "Swapchain: %u images, %s present mode",
+         context->swapchain.image_count, vk::to_string(present_mode).c_str());
 }
 
 void vulkan_swapchain_destroy(backend_context *context) {
@@ -148,15 +169,39 @@ void vulkan_swapchain_destroy(backend_context *context) {
                         context->swapchain.handle, nullptr);
 }
 
-void recreate_swapchain(backend_context *context) {
-  vkDeviceWaitIdle(context->device.logical_device);
+bool vulkan_swapchain_recreate(backend_context *context) {
+  // Minimized, there's nothing to present to until the window comes back
+  int width, height;
+  glfwGetFramebufferSize(context->window, &width, &height);
+  if (width == 0 || height == 0) {
+    return false;
+  }
+
+  vulkan_swapchain old = context->swapchain;
+  create(context, old.handle);
 
-  vulkan_swapchain_destroy(context);
-  create(context);
+  // Frames in flight still reference the old objects, framebuffers go first
+  // since they use the views
+  for (size_t i = 0; i < old.framebuffers.size(); i++) {
+    vulkan_deletion_queue_push_framebuffer(context, &context->deletion_queue,
+                                           old.framebuffers[i]);
+  }
+  for (size_t i = 0; i < old.views.size(); i++) {
+    vulkan_deletion_queue_push_image_view(context, &context->deletion_queue,
+                                          old.views[i]);
+  }
+  vulkan_deletion_queue_push_swapchain(context, &context->deletion_queue,
+                                       old.handle);
+  context->swapchain.framebuffers.clear();
+  vulkan_swapchain_create_image_views(context);
+
+  OE_LOG(LOG_LEVEL_DEBUG, "Swapchain recreated at %ux%u",
+         context->swapchain.extent.width, context->swapchain.extent.height);
+  return true;
 }
 
 void vulkan_swapchain_create(backend_context *context) {
-  create(context);  // just call helper function
+  create(context, nullptr);  // just call helper function
   OE_LOG(LOG_LEVEL_INFO, "Swapchain created!");
 }
 
@@ -166,7 +211,7 @@ void vulkan_swapchain_create_image_views(backend_context *context) {
   for (size_t i = 0; i < context->swapchain.image_count; i++) {
     vulkan_image_create_view(context, context->swapchain.image_format,
                              vk::ImageAspectFlagBits::eColor,
-                             &context->swapchain.images[i],
+                             &context->swapchain.images[i], 1,
                              &context->swapchain.views[i]);
   }
   OE_LOG(LOG_LEVEL_DEBUG, "Swapchain image views created");
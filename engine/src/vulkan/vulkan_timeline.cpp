@@ -0,0 +1,67 @@
+#include "engine/vulkan/vulkan_timeline.h"
+
+#include "engine/logger.h"
+#include "engine/platform.h"
+
+void vulkan_timeline_create(backend_context* context, const char* name,
+                            vulkan_timeline* out_timeline) {
+  *out_timeline = {};
+  vk::SemaphoreTypeCreateInfo type_info{
+      .semaphoreType = vk::SemaphoreType::eTimeline,
+      .initialValue = 0,
+  };
+  vk::SemaphoreCreateInfo semaphore_info{.pNext = &type_info};
+  out_timeline->semaphore =
+      context->device.logical_device.createSemaphore(semaphore_info);
+  out_timeline->name = name;
+}
+
+void vulkan_timeline_destroy(backend_context* context,
+                             vulkan_timeline* timeline) {
+  context->device.logical_device.destroySemaphore(timeline->semaphore);
+  *timeline = {};
+}
+
+uint64_t vulkan_timeline_next(vulkan_timeline* timeline) {
+  return ++timeline->submitted;
+}
+
+bool vulkan_timeline_reached(backend_context* context,
+                             vulkan_timeline* timeline, uint64_t value) {
+  if (timeline->completed >= value) {
+    return true;
+  }
+  double start = platform_get_absolute_time();
+  VK_CHECK(context->device.logical_device.getSemaphoreCounterValue(
+      timeline->semaphore, &timeline->completed));
+  timeline->query_seconds += platform_get_absolute_time() - start;
+  timeline->query_count++;
+  return timeline->completed >= value;
+}
+
+void vulkan_timeline_wait(backend_context* context, vulkan_timeline* timeline,
+                          uint64_t value) {
+  if (timeline->completed >= value) {
+    return;
+  }
+  vk::SemaphoreWaitInfo wait_info{
+      .semaphoreCount = 1,
+      .pSemaphores = &timeline->semaphore,
+      .pValues = &value,
+  };
+  double start = platform_get_absolute_time();
+  VK_CHECK(context->device.logical_device.waitSemaphores(wait_info,
+                                                         UINT64_MAX));
+  timeline->wait_seconds += platform_get_absolute_time() - start;
+  timeline->wait_count++;
+  timeline->completed = value;
+}
+
+void vulkan_timeline_log_stats(vulkan_timeline* timeline) {
+  OE_LOG(LOG_LEVEL_INFO,
+         "%s timeline: reached %llu, %u waits took %.3f ms, %u queries took "
+         "%.3f ms",
+         timeline->name, (unsigned long long)timeline->completed,
+         timeline->wait_count, timeline->wait_seconds * 1000.0,
+         timeline->query_count, timeline->query_seconds * 1000.0);
+}
@@ -0,0 +1,287 @@
+#include "engine/vulkan/vulkan_upload.h"
+
+#include "engine/logger.h"
+#include "engine/vulkan/vulkan_staging.h"
+#include "engine/vulkan/vulkan_timeline.h"
+
+static bool is_dedicated_transfer(backend_context* context) {
+  return context->device.transfer_queue_index !=
+         context->device.graphics_queue_index;
+}
+
+static void begin_commands(vk::CommandBuffer command_buffer) {
+  command_buffer.reset();
+  vk::CommandBufferBeginInfo begin_info{
+      .flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
+  command_buffer.begin(begin_info);
+}
+
+static void begin_graphics(backend_context* context,
+                           vulkan_upload_batch* batch) {
+  if (batch->graphics_recording) {
+    return;
+  }
+  if (batch->graphics_pending) {
+    vulkan_timeline_wait(context, &context->graphics_timeline,
+                         batch->graphics_value);
+    batch->graphics_pending = false;
+  }
+  begin_commands(batch->graphics_commands);
+  batch->graphics_recording = true;
+}
+
+// Acquires what the transfer half released, makes every write visible to
+// later graphics work, and submits
+static void submit_graphics(backend_context* context,
+                            vulkan_upload_batch* batch, bool wait_transfer) {
+  begin_graphics(context, batch);
+  vk::CommandBuffer commands = batch->graphics_commands;
+  if (!batch->image_acquires.empty() || !batch->buffer_acquires.empty()) {
+    commands.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe, batch->acquire_stages,
+        vk::DependencyFlags(), 0, nullptr,
+        static_cast<uint32_t>(batch->buffer_acquires.size()),
+        batch->buffer_acquires.data(),
+        static_cast<uint32_t>(batch->image_acquires.size()),
+        batch->image_acquires.data());
+    batch->image_acquires.clear();
+    batch->buffer_acquires.clear();
+    batch->acquire_stages = vk::PipelineStageFlags();
+  }
+  vk::MemoryBarrier barrier{
+      .srcAccessMask = vk::AccessFlagBits::eMemoryWrite,
+      .dstAccessMask = vk::AccessFlagBits::eMemoryRead,
+  };
+  commands.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands,
+                           vk::PipelineStageFlagBits::eAllCommands,
+                           vk::DependencyFlags(), 1, &barrier, 0, nullptr, 0,
+                           nullptr);
+  commands.end();
+
+  batch->graphics_value = vulkan_timeline_next(&context->graphics_timeline);
+  vk::TimelineSemaphoreSubmitInfo timeline_info{
+      .waitSemaphoreValueCount = wait_transfer ? 1u : 0u,
+      .pWaitSemaphoreValues = &batch->transfer_value,
+      .signalSemaphoreValueCount = 1,
+      .pSignalSemaphoreValues = &batch->graphics_value,
+  };
+  vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eAllCommands;
+  vk::SubmitInfo submit_info{
+      .pNext = &timeline_info,
+      .waitSemaphoreCount = wait_transfer ? 1u : 0u,
+      .pWaitSemaphores = &context->transfer_timeline.semaphore,
+      .pWaitDstStageMask = &wait_stage,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &batch->graphics_commands,
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &context->graphics_timeline.semaphore,
+  };
+  context->device.graphics_queue.submit(submit_info);
+  batch->graphics_recording = false;
+  batch->graphics_pending = true;
+  batch->submit_count++;
+}
+
+// Once the transfer half has completed its staging space is free, and the
+// graphics half can go without stalling the graphics queue
+static void hand_over(backend_context* context, vulkan_upload_batch* batch) {
+  vulkan_staging_reclaim(context, batch->staging);
+  batch->transfer_pending = false;
+  submit_graphics(context, batch, true);
+}
+
+static void begin_transfer(backend_context* context,
+                           vulkan_upload_batch* batch) {
+  if (batch->transfer_recording) {
+    return;
+  }
+  if (batch->transfer_pending) {
+    vulkan_timeline_wait(context, &context->transfer_timeline,
+                         batch->transfer_value);
+    hand_over(context, batch);
+  }
+  begin_commands(batch->transfer_commands);
+  batch->transfer_recording = true;
+}
+
+void vulkan_upload_batch_create(backend_context* context,
+                                vulkan_staging_ring* staging,
+                                vulkan_upload_batch* out_batch) {
+  *out_batch = {};
+  vk::Device device = context->device.logical_device;
+  vk::CommandPoolCreateInfo pool_ci{
+      .flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer,
+      .queueFamilyIndex =
+          static_cast<uint32_t>(context->device.transfer_queue_index),
+  };
+  out_batch->transfer_pool = device.createCommandPool(pool_ci);
+
+  vk::CommandBufferAllocateInfo alloc_info{
+      .commandPool = out_batch->transfer_pool,
+      .level = vk::CommandBufferLevel::ePrimary,
+      .commandBufferCount = 1,
+  };
+  VK_CHECK(device.allocateCommandBuffers(&alloc_info,
+                                         &out_batch->transfer_commands));
+  alloc_info.commandPool = context->command_pool;
+  VK_CHECK(device.allocateCommandBuffers(&alloc_info,
+                                         &out_batch->graphics_commands));
+  out_batch->staging = staging;
+}
+
+void vulkan_upload_batch_destroy(backend_context* context,
+                                 vulkan_upload_batch* batch) {
+  vulkan_upload_batch_wait(context, batch);
+  vk::Device device = context->device.logical_device;
+  if (batch->graphics_pending) {
+    vulkan_timeline_wait(context, &context->graphics_timeline,
+                         batch->graphics_value);
+  }
+  device.freeCommandBuffers(context->command_pool, 1,
+                            &batch->graphics_commands);
+  // Frees transfer_commands with it
+  device.destroyCommandPool(batch->transfer_pool);
+  *batch = {};
+}
+
+vk::CommandBuffer vulkan_upload_batch_record(backend_context* context,
+                                             vulkan_upload_batch* batch,
+                                             vulkan_upload_queue queue) {
+  batch->command_count++;
+  batch->total_commands++;
+  if (queue == VULKAN_UPLOAD_QUEUE_GRAPHICS) {
+    begin_graphics(context, batch);
+    return batch->graphics_commands;
+  }
+  begin_transfer(context, batch);
+  return batch->transfer_commands;
+}
+
+void vulkan_upload_batch_release_image(backend_context* context,
+                                       vulkan_upload_batch* batch,
+                                       const vk::ImageMemoryBarrier& barrier,
+                                       vk::PipelineStageFlags dst_stage) {
+  vk::CommandBuffer commands =
+      vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER);
+  if (!is_dedicated_transfer(context)) {
+    // Same family, so there is no ownership to transfer and the queue
+    // supports dst_stage. The semaphore orders it against the graphics queue.
+    vk::ImageMemoryBarrier transition = barrier;
+    transition.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+    transition.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+    commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dst_stage,
+                             vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1,
+                             &transition);
+    return;
+  }
+
+  // The release only has to finish the copies, the acquire on the graphics
+  // queue makes them visible to dst_stage
+  vk::ImageMemoryBarrier release = barrier;
+  release.srcQueueFamilyIndex = context->device.transfer_queue_index;
+  release.dstQueueFamilyIndex = context->device.graphics_queue_index;
+  release.dstAccessMask = vk::AccessFlags();
+  commands.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                           vk::PipelineStageFlagBits::eBottomOfPipe,
+                           vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1,
+                           &release);
+
+  vk::ImageMemoryBarrier acquire = release;
+  acquire.srcAccessMask = vk::AccessFlags();
+  acquire.dstAccessMask = barrier.dstAccessMask;
+  batch->image_acquires.push_back(acquire);
+  batch->acquire_stages |= dst_stage;
+}
+
+void vulkan_upload_batch_release_buffer(backend_context* context,
+                                        vulkan_upload_batch* batch,
+                                        vk::Buffer buffer,
+                                        vk::AccessFlags dst_access,
+                                        vk::PipelineStageFlags dst_stage) {
+  // Without a family change the graphics half's barrier is enough
+  if (!is_dedicated_transfer(context)) {
+    return;
+  }
+  vk::BufferMemoryBarrier release{
+      .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+      .dstAccessMask = vk::AccessFlags(),
+      .srcQueueFamilyIndex =
+          static_cast<uint32_t>(context->device.transfer_queue_index),
+      .dstQueueFamilyIndex =
+          static_cast<uint32_t>(context->device.graphics_queue_index),
+      .buffer = buffer,
+      .offset = 0,
+      .size = vk::WholeSize,
+  };
+  vulkan_upload_batch_record(context, batch, VULKAN_UPLOAD_QUEUE_TRANSFER)
+      .pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                       vk::PipelineStageFlagBits::eBottomOfPipe,
+                       vk::DependencyFlags(), 0, nullptr, 1, &release, 0,
+                       nullptr);
+
+  vk::BufferMemoryBarrier acquire = release;
+  acquire.srcAccessMask = vk::AccessFlags();
+  acquire.dstAccessMask = dst_access;
+  batch->buffer_acquires.push_back(acquire);
+  batch->acquire_stages |= dst_stage;
+}
+
+bool vulkan_upload_batch_submit(backend_context* context,
+                                vulkan_upload_batch* batch) {
+  if (!batch->transfer_recording && !batch->graphics_recording) {
+    return false;
+  }
+
+  if (batch->transfer_recording) {
+    batch->transfer_commands.end();
+    batch->transfer_value = vulkan_timeline_next(&context->transfer_timeline);
+    vk::TimelineSemaphoreSubmitInfo timeline_info{
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &batch->transfer_value,
+    };
+    vk::SubmitInfo submit_info{
+        .pNext = &timeline_info,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &batch->transfer_commands,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &context->transfer_timeline.semaphore,
+    };
+    context->device.transfer_queue.submit(submit_info);
+    vulkan_staging_retire(context, batch->staging,
+                          &context->transfer_timeline, batch->transfer_value);
+    batch->transfer_recording = false;
+    batch->transfer_pending = true;
+    batch->submit_count++;
+  }
+  // Graphics only work goes straight away, unless there's a transfer half to
+  // hand over with it
+  if (batch->graphics_recording && !batch->transfer_pending) {
+    submit_graphics(context, batch, false);
+  }
+
+  OE_LOG(LOG_LEVEL_DEBUG, "Submitted %u upload commands",
+         batch->command_count);
+  batch->command_count = 0;
+  return true;
+}
+
+bool vulkan_upload_batch_poll(backend_context* context,
+                              vulkan_upload_batch* batch) {
+  if (batch->transfer_pending &&
+      vulkan_timeline_reached(context, &context->transfer_timeline,
+                              batch->transfer_value)) {
+    hand_over(context, batch);
+  }
+  return !batch->transfer_recording && !batch->graphics_recording &&
+         !batch->transfer_pending;
+}
+
+void vulkan_upload_batch_wait(backend_context* context,
+                              vulkan_upload_batch* batch) {
+  vulkan_upload_batch_submit(context, batch);
+  if (batch->transfer_pending) {
+    vulkan_timeline_wait(context, &context->transfer_timeline,
+                         batch->transfer_value);
+    hand_over(context, batch);
+  }
+}
@@ -0,0 +1,744 @@
+// Headless benchmarks for engine subsystems.
+// Run from the build directory, like the engine itself, so the default asset
+// paths resolve.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "engine/assets/asset_pack.h"
+#include "engine/filesystem.h"
+#include "engine/geometry/mesh_cache.h"
+#include "engine/geometry/mesh_loader.h"
+#include "engine/geometry/mesh_optimizer.h"
+#include "engine/geometry/vertex_packing.h"
+#include "engine/geometry/vertex_welder.h"
+#include "engine/logger.h"
+#include "engine/memory/tlsf.h"
+#include "engine/texture/mipmap.h"
+#include "engine/platform.h"
+
+#define DEFAULT_MODEL_PATH "../bin/assets/models/viking_room.obj"
+#define BENCH_ITERATIONS 5
+
+typedef struct benchmark {
+  const char *name;
+  const char *usage;
+  int (*run)(int argc, char **argv);
+} benchmark;
+
+// Loads a mesh and copies it into a host buffer standing in for the staging
+// buffer, which is the whole startup cost up to the GPU copy.
+static double time_mesh_load(const std::string &path, bool use_cache,
+                             bool *out_from_cache) {
+  double start = platform_get_absolute_time();
+  mesh_asset mesh;
+  if (!mesh_loader_load(path, use_cache, &mesh)) {
+    exit(1);
+  }
+  size_t vertex_size = sizeof(Vertex) * mesh.geometry.vertex_count;
+  size_t index_size =
+      (size_t)mesh.geometry.index_stride * mesh.geometry.index_count;
+  std::vector<char> staging(vertex_size + index_size);
+  memcpy(staging.data(), mesh.geometry.vertices, vertex_size);
+  memcpy(staging.data() + vertex_size, mesh.geometry.indices, index_size);
+  *out_from_cache = mesh.from_cache;
+  mesh_loader_release(&mesh);
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+static int bench_mesh_cache(int argc, char **argv) {
+  std::string path = argc > 0 ? argv[0] : DEFAULT_MODEL_PATH;
+  bool from_cache = false;
+
+  double parse_best = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    double ms = time_mesh_load(path, false, &from_cache);
+    parse_best = ms < parse_best ? ms : parse_best;
+  }
+
+  // Cold start: no cache on disk, parse and write it
+  remove(mesh_cache_path(path).c_str());
+  double cold = time_mesh_load(path, true, &from_cache);
+  if (from_cache) {
+    OE_LOG(LOG_LEVEL_ERROR, "Cold load unexpectedly hit the cache");
+    return 1;
+  }
+
+  // Warm start: map the cache written above
+  double warm_best = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    double ms = time_mesh_load(path, true, &from_cache);
+    if (!from_cache) {
+      OE_LOG(LOG_LEVEL_ERROR, "Warm load missed the cache");
+      return 1;
+    }
+    warm_best = ms < warm_best ? ms : warm_best;
+  }
+
+  OE_LOG(LOG_LEVEL_INFO, "mesh_cache: %s", path.c_str());
+  OE_LOG(LOG_LEVEL_INFO, "  parse only (best of %d): %10.3f ms",
+         BENCH_ITERATIONS, parse_best);
+  OE_LOG(LOG_LEVEL_INFO, "  cold (parse + write)   : %10.3f ms", cold);
+  OE_LOG(LOG_LEVEL_INFO, "  warm (best of %d)      : %10.3f ms  (%.1fx)",
+         BENCH_ITERATIONS, warm_best, parse_best / warm_best);
+  return 0;
+}
+
+static int bench_obj_parser(int argc, char **argv) {
+  std::string path = argc > 0 ? argv[0] : DEFAULT_MODEL_PATH;
+  std::vector<Vertex> reference_vertices, vertices;
+  std::vector<uint32_t> reference_indices, indices;
+
+  double start = platform_get_absolute_time();
+  if (!mesh_loader_parse_obj(path, MESH_OBJ_PARSER_TINYOBJ,
+                             &reference_vertices, &reference_indices)) {
+    return 1;
+  }
+  double tinyobj_ms = (platform_get_absolute_time() - start) * 1000.0;
+
+  double parallel_best = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    start = platform_get_absolute_time();
+    if (!mesh_loader_parse_obj(path, MESH_OBJ_PARSER_PARALLEL, &vertices,
+                               &indices)) {
+      return 1;
+    }
+    double ms = (platform_get_absolute_time() - start) * 1000.0;
+    parallel_best = ms < parallel_best ? ms : parallel_best;
+  }
+
+  // Output must be bit identical, not just close
+  bool identical =
+      vertices.size() == reference_vertices.size() &&
+      indices.size() == reference_indices.size() &&
+      memcmp(vertices.data(), reference_vertices.data(),
+             vertices.size() * sizeof(Vertex)) == 0 &&
+      memcmp(indices.data(), reference_indices.data(),
+             indices.size() * sizeof(uint32_t)) == 0;
+
+  OE_LOG(LOG_LEVEL_INFO, "obj_parser: %s (%u hardware threads)", path.c_str(),
+         std::thread::hardware_concurrency());
+  OE_LOG(LOG_LEVEL_INFO, "  tinyobj              : %10.3f ms", tinyobj_ms);
+  OE_LOG(LOG_LEVEL_INFO, "  parallel (best of %d): %10.3f ms  (%.1fx)",
+         BENCH_ITERATIONS, parallel_best, tinyobj_ms / parallel_best);
+  OE_LOG(LOG_LEVEL_INFO, "  output matches tinyobj: %s",
+         identical ? "yes" : "NO");
+  return identical ? 0 : 1;
+}
+
+// The dedup the loader used before the welder, kept as the baseline
+static double time_unordered_map_weld(const std::vector<Vertex> &corners,
+                                      uint32_t *out_vertex_count) {
+  double start = platform_get_absolute_time();
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::unordered_map<Vertex, uint32_t> unique_verts{};
+  for (const Vertex &vertex : corners) {
+    if (unique_verts.count(vertex) == 0) {
+      unique_verts[vertex] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(vertex);
+    }
+    indices.push_back(unique_verts[vertex]);
+  }
+  *out_vertex_count = static_cast<uint32_t>(vertices.size());
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+static double time_welder(const std::vector<Vertex> &corners, float epsilon,
+                          uint32_t thread_count, vertex_weld_stats *stats) {
+  vertex_weld_config config = {};
+  config.epsilon = epsilon;
+  config.thread_count = thread_count;
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> remap;
+  double best = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    vertex_welder_weld(corners.data(), static_cast<uint32_t>(corners.size()),
+                       &config, &vertices, &remap, stats);
+    best = stats->elapsed_ms < best ? stats->elapsed_ms : best;
+  }
+  return best;
+}
+
+static int bench_vertex_welder(int argc, char **argv) {
+  std::string path = argc > 0 ? argv[0] : DEFAULT_MODEL_PATH;
+  float epsilon = argc > 1 ? (float)atof(argv[1]) : 1e-4f;
+
+  // Expand the mesh back into one vertex per corner, the welder's input
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  if (!mesh_loader_parse_obj(path, MESH_OBJ_PARSER_PARALLEL, &vertices,
+                             &indices)) {
+    return 1;
+  }
+  std::vector<Vertex> corners(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    corners[i] = vertices[indices[i]];
+  }
+
+  uint32_t map_count = 0;
+  double map_ms = time_unordered_map_weld(corners, &map_count);
+  vertex_weld_stats single, threaded, snapped;
+  double single_ms = time_welder(corners, 0.0f, 1, &single);
+  double threaded_ms = time_welder(corners, 0.0f, 0, &threaded);
+  double snapped_ms = time_welder(corners, epsilon, 0, &snapped);
+
+  OE_LOG(LOG_LEVEL_INFO, "vertex_welder: %s (%zu corners)", path.c_str(),
+         corners.size());
+  OE_LOG(LOG_LEVEL_INFO, "  unordered_map          : %10.3f ms  %u vertices",
+         map_ms, map_count);
+  OE_LOG(LOG_LEVEL_INFO,
+         "  welder, 1 thread       : %10.3f ms  %u vertices  (%.1fx)",
+         single_ms, single.output_vertex_count, map_ms / single_ms);
+  OE_LOG(LOG_LEVEL_INFO,
+         "  welder, %2u threads     : %10.3f ms  %u vertices  (%.1fx)",
+         threaded.thread_count, threaded_ms, threaded.output_vertex_count,
+         map_ms / threaded_ms);
+  OE_LOG(LOG_LEVEL_INFO, "  welder, epsilon %g : %10.3f ms  %u vertices",
+         epsilon, snapped_ms, snapped.output_vertex_count);
+
+  // Exact welding must find the same unique vertices regardless of threads
+  bool consistent = single.output_vertex_count == map_count &&
+                    threaded.output_vertex_count == map_count;
+  OE_LOG(LOG_LEVEL_INFO, "  exact counts match unordered_map: %s",
+         consistent ? "yes" : "NO");
+  return consistent ? 0 : 1;
+}
+
+static void log_cache_stats(const char *stage,
+                            const std::vector<uint32_t> &indices,
+                            uint32_t vertex_count, double ms) {
+  vertex_cache_stats stats = mesh_optimizer_analyze_vertex_cache(
+      indices.data(), static_cast<uint32_t>(indices.size()), vertex_count,
+      MESH_OPTIMIZER_CACHE_SIZE);
+  OE_LOG(LOG_LEVEL_INFO, "  %-12s: ACMR %.3f  ATVR %.3f  %10.3f ms", stage,
+         stats.acmr, stats.atvr, ms);
+}
+
+static int bench_mesh_optimizer(int argc, char **argv) {
+  std::string path = argc > 0 ? argv[0] : DEFAULT_MODEL_PATH;
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  if (!mesh_loader_parse_obj(path, MESH_OBJ_PARSER_PARALLEL, &vertices,
+                             &indices)) {
+    return 1;
+  }
+  uint32_t vertex_count = static_cast<uint32_t>(vertices.size());
+
+  OE_LOG(LOG_LEVEL_INFO, "mesh_optimizer: %s (%u vertices, %zu triangles)",
+         path.c_str(), vertex_count, indices.size() / 3);
+  log_cache_stats("raw", indices, vertex_count, 0.0);
+
+  double start = platform_get_absolute_time();
+  mesh_optimizer_optimize_vertex_cache(&indices, vertex_count,
+                                       MESH_OPTIMIZER_CACHE_SIZE);
+  log_cache_stats("vertex cache", indices, vertex_count,
+                  (platform_get_absolute_time() - start) * 1000.0);
+
+  start = platform_get_absolute_time();
+  bool applied = mesh_optimizer_optimize_overdraw(
+      &indices, vertices, MESH_OPTIMIZER_CACHE_SIZE,
+      MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+  log_cache_stats(applied ? "overdraw" : "overdraw (x)", indices,
+                  vertex_count,
+                  (platform_get_absolute_time() - start) * 1000.0);
+
+  start = platform_get_absolute_time();
+  mesh_optimizer_optimize_vertex_fetch(&vertices, &indices);
+  log_cache_stats("fetch", indices, static_cast<uint32_t>(vertices.size()),
+                  (platform_get_absolute_time() - start) * 1000.0);
+  return 0;
+}
+
+// Gathers vertices in index order, like the vertex fetch of a draw. Returns
+// the best time in ms.
+template <typename T>
+static double time_vertex_gather(const T *vertices, const mesh_geometry *mesh,
+                                 std::vector<T> *scratch) {
+  scratch->resize(mesh->index_count);
+  double best = 1e30;
+  for (int iteration = 0; iteration < BENCH_ITERATIONS; iteration++) {
+    double start = platform_get_absolute_time();
+    for (uint32_t i = 0; i < mesh->index_count; i++) {
+      uint32_t index = mesh->index_stride == sizeof(uint16_t)
+                           ? ((const uint16_t *)mesh->indices)[i]
+                           : ((const uint32_t *)mesh->indices)[i];
+      (*scratch)[i] = vertices[index];
+    }
+    double ms = (platform_get_absolute_time() - start) * 1000.0;
+    best = ms < best ? ms : best;
+  }
+  return best;
+}
+
+static int bench_vertex_packing(int argc, char **argv) {
+  std::string path = argc > 0 ? argv[0] : DEFAULT_MODEL_PATH;
+  mesh_asset mesh;
+  if (!mesh_loader_load(path, false, &mesh)) {
+    return 1;
+  }
+  const mesh_geometry *geometry = &mesh.geometry;
+
+  std::vector<PackedVertex> packed;
+  vertex_pack_decode decode;
+  double start = platform_get_absolute_time();
+  vertex_packing_pack(geometry, &packed, &decode);
+  double pack_ms = (platform_get_absolute_time() - start) * 1000.0;
+
+  // Worst case round trip error, positions relative to the bounds size
+  float position_error = 0.0f, uv_error = 0.0f;
+  glm::vec3 extent = geometry->bounds_max - geometry->bounds_min;
+  float size = extent.x > extent.y ? extent.x : extent.y;
+  size = size > extent.z ? size : extent.z;
+  for (uint32_t i = 0; i < geometry->vertex_count; i++) {
+    Vertex unpacked = vertex_packing_unpack(&packed[i], &decode, nullptr);
+    glm::vec3 position = glm::abs(unpacked.pos - geometry->vertices[i].pos);
+    glm::vec2 uv = unpacked.tex_coord - geometry->vertices[i].tex_coord;
+    for (int axis = 0; axis < 3; axis++) {
+      position_error = std::max(position_error, position[axis]);
+    }
+    uv_error = std::max(uv_error, std::max(std::fabs(uv.x), std::fabs(uv.y)));
+  }
+
+  std::vector<Vertex> full_scratch;
+  std::vector<PackedVertex> packed_scratch;
+  double full_ms =
+      time_vertex_gather(geometry->vertices, geometry, &full_scratch);
+  double packed_ms = time_vertex_gather(packed.data(), geometry,
+                                        &packed_scratch);
+
+  size_t full_bytes = sizeof(Vertex) * geometry->vertex_count;
+  size_t packed_bytes = sizeof(PackedVertex) * geometry->vertex_count;
+  double fetched_mb = geometry->index_count / (1024.0 * 1024.0);
+  OE_LOG(LOG_LEVEL_INFO, "vertex_packing: %s (%u vertices)", path.c_str(),
+         geometry->vertex_count);
+  OE_LOG(LOG_LEVEL_INFO, "  pack                 : %10.3f ms", pack_ms);
+  OE_LOG(LOG_LEVEL_INFO, "  vertex buffer        : %zu -> %zu bytes (%.0f%%)",
+         full_bytes, packed_bytes, 100.0 * packed_bytes / full_bytes);
+  OE_LOG(LOG_LEVEL_INFO,
+         "  max error            : position %g (%g of size), uv %g",
+         position_error, size > 0.0f ? position_error / size : 0.0f,
+         uv_error);
+  OE_LOG(LOG_LEVEL_INFO,
+         "  gather, Vertex       : %10.3f ms  %8.1f MB/s fetched",
+         full_ms, fetched_mb * sizeof(Vertex) / (full_ms / 1000.0));
+  OE_LOG(LOG_LEVEL_INFO,
+         "  gather, PackedVertex : %10.3f ms  %8.1f MB/s fetched  (%.1fx)",
+         packed_ms, fetched_mb * sizeof(PackedVertex) / (packed_ms / 1000.0),
+         full_ms / packed_ms);
+  mesh_loader_release(&mesh);
+  return 0;
+}
+
+static double time_mipmap(const std::vector<uint8_t> &pixels, uint32_t size,
+                          bool srgb, uint32_t thread_count) {
+  mip_chain chain;
+  double best = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    double start = platform_get_absolute_time();
+    mipmap_generate(pixels.data(), size, size, srgb, thread_count, &chain);
+    double ms = (platform_get_absolute_time() - start) * 1000.0;
+    best = ms < best ? ms : best;
+  }
+  return best;
+}
+
+static int bench_mipmap(int argc, char **argv) {
+  uint32_t size = argc > 0 ? (uint32_t)atoi(argv[0]) : 4096;
+  if (size == 0) {
+    return 1;
+  }
+  // Noise, so nothing is uniform enough to be a best case
+  std::vector<uint8_t> pixels((size_t)size * size * 4);
+  uint32_t seed = 1;
+  for (auto &byte : pixels) {
+    seed = seed * 1664525u + 1013904223u;
+    byte = (uint8_t)(seed >> 24);
+  }
+
+  OE_LOG(LOG_LEVEL_INFO, "mipmap: %ux%u RGBA8, %u levels", size, size,
+         mipmap_level_count(size, size));
+  uint32_t threads = std::thread::hardware_concurrency();
+  double unorm_single = time_mipmap(pixels, size, false, 1);
+  double unorm_threaded = time_mipmap(pixels, size, false, 0);
+  double srgb_single = time_mipmap(pixels, size, true, 1);
+  double srgb_threaded = time_mipmap(pixels, size, true, 0);
+  OE_LOG(LOG_LEVEL_INFO, "  unorm, 1 thread  : %10.3f ms", unorm_single);
+  OE_LOG(LOG_LEVEL_INFO, "  unorm, %2u threads: %10.3f ms  (%.1fx)", threads,
+         unorm_threaded, unorm_single / unorm_threaded);
+  OE_LOG(LOG_LEVEL_INFO, "  srgb, 1 thread   : %10.3f ms", srgb_single);
+  OE_LOG(LOG_LEVEL_INFO, "  srgb, %2u threads : %10.3f ms  (%.1fx)", threads,
+         srgb_threaded, srgb_single / srgb_threaded);
+  return 0;
+}
+
+// Reads every file with the blocking filesystem calls, one after another.
+// Like the batched reads, every file stays in memory until the end, as an
+// asset would until it is uploaded.
+static double time_serial_reads(const std::vector<std::string> &paths) {
+  double start = platform_get_absolute_time();
+  std::vector<char *> contents(paths.size(), nullptr);
+  for (size_t i = 0; i < paths.size(); i++) {
+    file_handle handle;
+    long size = 0;
+    if (filesystem_open(paths[i].c_str(), FILE_MODE_READ, true, &handle)) {
+      filesystem_read_all_bytes(&handle, &contents[i], &size);
+      filesystem_close(&handle);
+    }
+  }
+  for (char *data : contents) {
+    free(data);
+  }
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+// Queues every file, submits them as one batch and waits for them all.
+// Returns a negative time if the backend isn't available.
+static double time_batched_reads(const std::vector<std::string> &paths,
+                                 file_io_backend backend) {
+  double start = platform_get_absolute_time();
+  file_io_queue *queue;
+  if (!filesystem_io_queue_create(backend, 0, &queue)) {
+    return -1.0;
+  }
+  std::vector<file_read_id> ids;
+  for (const std::string &path : paths) {
+    ids.push_back(filesystem_read_async(queue, path.c_str(), nullptr, nullptr));
+  }
+  filesystem_io_submit(queue);
+  std::vector<file_read_result> results(ids.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    filesystem_io_wait(queue, ids[i], &results[i]);
+  }
+  for (const file_read_result &result : results) {
+    free(result.data);
+  }
+  filesystem_io_queue_destroy(queue);
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+static int bench_file_io(int argc, char **argv) {
+  uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 256;
+  uint32_t size_kb = argc > 1 ? (uint32_t)atoi(argv[1]) : 256;
+  char directory[] = "/tmp/orion_bench_io_XXXXXX";
+  if (count == 0 || !mkdtemp(directory)) {
+    return 1;
+  }
+
+  std::vector<std::string> paths;
+  std::vector<char> contents((size_t)size_kb * 1024, 'x');
+  for (uint32_t i = 0; i < count; i++) {
+    paths.push_back(std::string(directory) + "/file" + std::to_string(i));
+    file_handle handle;
+    long written;
+    if (!filesystem_open(paths.back().c_str(), FILE_MODE_WRITE, true,
+                         &handle)) {
+      return 1;
+    }
+    filesystem_write(&handle, (long)contents.size(), contents.data(),
+                     &written);
+    filesystem_close(&handle);
+  }
+
+  // The files were just written, so this measures syscall and scheduling
+  // overhead with a warm page cache rather than the disk
+  OE_LOG(LOG_LEVEL_INFO, "file_io: %u files of %u KB (page cache warm)", count,
+         size_kb);
+  double serial = 1e30, uring = 1e30, threads = 1e30;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    serial = std::min(serial, time_serial_reads(paths));
+    uring =
+        std::min(uring, time_batched_reads(paths, FILE_IO_BACKEND_IO_URING));
+    threads =
+        std::min(threads, time_batched_reads(paths, FILE_IO_BACKEND_THREADS));
+  }
+  OE_LOG(LOG_LEVEL_INFO, "  serial             : %10.3f ms", serial);
+  if (uring >= 0.0) {
+    OE_LOG(LOG_LEVEL_INFO, "  batched, io_uring  : %10.3f ms  (%.1fx)", uring,
+           serial / uring);
+  } else {
+    OE_LOG(LOG_LEVEL_INFO, "  batched, io_uring  : unavailable");
+  }
+  OE_LOG(LOG_LEVEL_INFO, "  batched, threads   : %10.3f ms  (%.1fx)", threads,
+         serial / threads);
+
+  for (const std::string &path : paths) {
+    remove(path.c_str());
+  }
+  rmdir(directory);
+  return 0;
+}
+
+// Sums every byte so the loads can't be skipped and each page is touched
+static uint64_t checksum(const void *data, size_t size) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; i++) {
+    sum += ((const unsigned char *)data)[i];
+  }
+  return sum;
+}
+
+static double time_loose_loads(const std::string &root,
+                               const std::vector<std::string> &names,
+                               uint64_t *out_checksum) {
+  double start = platform_get_absolute_time();
+  *out_checksum = 0;
+  for (const std::string &name : names) {
+    file_mapping mapping;
+    if (!filesystem_map((root + "/" + name).c_str(), FILE_MAP_HINT_NONE,
+                        &mapping)) {
+      exit(1);
+    }
+    *out_checksum += checksum(mapping.data, mapping.size);
+    filesystem_unmap(&mapping);
+  }
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+static double time_pack_loads(const char *pack_path,
+                              const std::vector<std::string> &names,
+                              uint64_t *out_checksum) {
+  double start = platform_get_absolute_time();
+  *out_checksum = 0;
+  asset_pack pack;
+  if (!asset_pack_mount(pack_path, &pack)) {
+    exit(1);
+  }
+  for (const std::string &name : names) {
+    const asset_pack_entry *entry = asset_pack_find(&pack, name.c_str());
+    asset_data data;
+    if (!entry || !asset_pack_read(&pack, entry, &data)) {
+      exit(1);
+    }
+    *out_checksum += checksum(data.data, data.size);
+    asset_data_release(&data);
+  }
+  asset_pack_unmount(&pack);
+  return (platform_get_absolute_time() - start) * 1000.0;
+}
+
+static double time_pack_build(const char *pack_path,
+                              const std::vector<std::string> &names,
+                              const std::vector<std::string> &contents,
+                              bool compress, uint64_t *out_size) {
+  double start = platform_get_absolute_time();
+  std::vector<asset_pack_source> sources(names.size());
+  for (size_t i = 0; i < names.size(); i++) {
+    sources[i] = {names[i].c_str(), contents[i].data(), contents[i].size()};
+  }
+  if (!asset_pack_write(pack_path, sources.data(), (uint32_t)sources.size(),
+                        compress)) {
+    exit(1);
+  }
+  double ms = (platform_get_absolute_time() - start) * 1000.0;
+  struct stat pack_stat;
+  stat(pack_path, &pack_stat);
+  *out_size = (uint64_t)pack_stat.st_size;
+  return ms;
+}
+
+static int bench_asset_pack(int argc, char **argv) {
+  uint32_t count = argc > 0 ? (uint32_t)atoi(argv[0]) : 10000;
+  uint32_t size = argc > 1 ? (uint32_t)atoi(argv[1]) : 4096;
+  char directory[] = "/tmp/orion_bench_pack_XXXXXX";
+  if (count == 0 || !mkdtemp(directory)) {
+    return 1;
+  }
+
+  // Small text-like assets spread over nested directories, like the configs
+  // and shaders of a real project
+  const uint32_t directory_count = 64;
+  std::string root = directory;
+  std::vector<std::string> names(count);
+  std::vector<std::string> contents(count);
+  uint64_t total_size = 0;
+  for (uint32_t i = 0; i < directory_count && i < count; i++) {
+    std::string group = root + "/group" + std::to_string(i % 8);
+    mkdir(group.c_str(), 0755);
+    mkdir((group + "/set" + std::to_string(i)).c_str(), 0755);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t set = i % directory_count;
+    names[i] = "group" + std::to_string(set % 8) + "/set" +
+               std::to_string(set) + "/asset" + std::to_string(i) + ".txt";
+    while (contents[i].size() < size) {
+      contents[i] += "asset " + std::to_string(i) + " value " +
+                     std::to_string(contents[i].size() * 7919 % 100003) + "\n";
+    }
+    contents[i].resize(size);
+    total_size += size;
+
+    file_handle handle;
+    long written;
+    if (!filesystem_open((root + "/" + names[i]).c_str(), FILE_MODE_WRITE,
+                         true, &handle)) {
+      return 1;
+    }
+    filesystem_write(&handle, (long)size, contents[i].data(), &written);
+    filesystem_close(&handle);
+  }
+
+  std::string raw_pack = root + "/raw" ASSET_PACK_EXTENSION;
+  std::string lz4_pack = root + "/lz4" ASSET_PACK_EXTENSION;
+  uint64_t raw_size, lz4_size;
+  double raw_build = time_pack_build(raw_pack.c_str(), names, contents, false,
+                                     &raw_size);
+  double lz4_build = time_pack_build(lz4_pack.c_str(), names, contents, true,
+                                     &lz4_size);
+
+  // Everything was just written, so this is the per-file open/map/close
+  // overhead against one mapping and an index lookup, with a warm page cache
+  OE_LOG(LOG_LEVEL_INFO, "asset_pack: %u assets of %u bytes (page cache warm)",
+         count, size);
+  OE_LOG(LOG_LEVEL_INFO, "  build, raw         : %10.3f ms  (%.2f MB)",
+         raw_build, raw_size / (1024.0 * 1024.0));
+  OE_LOG(LOG_LEVEL_INFO, "  build, lz4         : %10.3f ms  (%.2f MB, %.2fx)",
+         lz4_build, lz4_size / (1024.0 * 1024.0),
+         (double)total_size / lz4_size);
+
+  double loose = 1e30, raw = 1e30, lz4 = 1e30;
+  uint64_t loose_sum, raw_sum, lz4_sum;
+  for (int i = 0; i < BENCH_ITERATIONS; i++) {
+    loose = std::min(loose, time_loose_loads(root, names, &loose_sum));
+    raw = std::min(raw, time_pack_loads(raw_pack.c_str(), names, &raw_sum));
+    lz4 = std::min(lz4, time_pack_loads(lz4_pack.c_str(), names, &lz4_sum));
+  }
+  if (raw_sum != loose_sum || lz4_sum != loose_sum) {
+    OE_LOG(LOG_LEVEL_ERROR, "Packed assets don't match the loose files");
+    return 1;
+  }
+  OE_LOG(LOG_LEVEL_INFO, "  loose files        : %10.3f ms", loose);
+  OE_LOG(LOG_LEVEL_INFO, "  pack, raw          : %10.3f ms  (%.1fx)", raw,
+         loose / raw);
+  OE_LOG(LOG_LEVEL_INFO, "  pack, lz4          : %10.3f ms  (%.1fx)", lz4,
+         loose / lz4);
+
+  for (const std::string &name : names) {
+    remove((root + "/" + name).c_str());
+  }
+  for (uint32_t i = 0; i < directory_count && i < count; i++) {
+    std::string group = root + "/group" + std::to_string(i % 8);
+    rmdir((group + "/set" + std::to_string(i)).c_str());
+    rmdir(group.c_str());
+  }
+  remove(raw_pack.c_str());
+  remove(lz4_pack.c_str());
+  rmdir(directory);
+  return 0;
+}
+
+// Mimics resource churn in one allocator block: buffers and textures from a
+// few hundred bytes to a few MB, at GPU alignments
+static int bench_suballocator(int argc, char **argv) {
+  uint32_t operations = argc > 0 ? (uint32_t)atoi(argv[0]) : 1000000;
+  const uint64_t block_size = 256ull * 1024 * 1024;
+  if (operations == 0) {
+    return 1;
+  }
+
+  tlsf_allocator allocator;
+  tlsf_create(block_size, &allocator);
+  std::vector<uint32_t> live;
+  live.reserve(operations);
+  uint32_t seed = 1;
+  uint32_t failures = 0;
+  float worst_fragmentation = 0.0f;
+  double start = platform_get_absolute_time();
+  for (uint32_t i = 0; i < operations; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    // Grow towards ~60% full, then hover there
+    bool allocate = live.empty() ||
+                    (seed >> 8) % 100 < (allocator.free_size >
+                                                 block_size * 2 / 5
+                                             ? 60u
+                                             : 40u);
+    if (allocate) {
+      uint64_t size = 256ull << ((seed >> 16) % 14);
+      size += (seed >> 4) % size;
+      uint64_t alignment = (seed & 1) ? 256 : 65536;
+      uint32_t node;
+      uint64_t offset;
+      if (tlsf_allocate(&allocator, size, alignment, &node, &offset)) {
+        live.push_back(node);
+      } else {
+        failures++;
+      }
+    } else {
+      uint32_t victim = (seed >> 8) % live.size();
+      tlsf_free(&allocator, live[victim]);
+      live[victim] = live.back();
+      live.pop_back();
+    }
+    if (i % 4096 == 0 && allocator.free_size > 0) {
+      float fragmentation =
+          1.0f - (float)tlsf_largest_free(&allocator) / allocator.free_size;
+      worst_fragmentation = std::max(worst_fragmentation, fragmentation);
+    }
+  }
+  double ms = (platform_get_absolute_time() - start) * 1000.0;
+
+  OE_LOG(LOG_LEVEL_INFO, "suballocator: %u operations in a %llu MB block",
+         operations, (unsigned long long)(block_size >> 20));
+  OE_LOG(LOG_LEVEL_INFO, "  time               : %10.3f ms  (%.1f ns/op)",
+         ms, ms * 1e6 / operations);
+  OE_LOG(LOG_LEVEL_INFO, "  live at the end    : %u, %.1f MB",
+         allocator.allocation_count,
+         (block_size - allocator.free_size) / (1024.0 * 1024.0));
+  OE_LOG(LOG_LEVEL_INFO, "  failed allocations : %u", failures);
+  OE_LOG(LOG_LEVEL_INFO, "  worst fragmentation: %.1f%%",
+         worst_fragmentation * 100.0f);
+  return 0;
+}
+
+static const benchmark benchmarks[] = {
+    {"mesh_cache", "[model.obj]", bench_mesh_cache},
+    {"obj_parser", "[model.obj]", bench_obj_parser},
+    {"vertex_welder", "[model.obj] [epsilon]", bench_vertex_welder},
+    {"mesh_optimizer", "[model.obj]", bench_mesh_optimizer},
+    {"vertex_packing", "[model.obj]", bench_vertex_packing},
+    {"mipmap", "[size]", bench_mipmap},
+    {"file_io", "[file count] [file size KB]", bench_file_io},
+    {"asset_pack", "[asset count] [asset size]", bench_asset_pack},
+    {"suballocator", "[operations]", bench_suballocator},
+};
+static const int benchmark_count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    printf("usage: orion_bench <benchmark|all> [args]\n");
+    for (int i = 0; i < benchmark_count; i++) {
+      printf("  %s %s\n", benchmarks[i].name, benchmarks[i].usage);
+    }
+    return 1;
+  }
+
+  bool run_all = strcmp(argv[1], "all") == 0;
+  bool found = false;
+  for (int i = 0; i < benchmark_count; i++) {
+    if (run_all || strcmp(argv[1], benchmarks[i].name) == 0) {
+      found = true;
+      // "all" runs everything with default arguments
+      int result = run_all ? benchmarks[i].run(0, nullptr)
+                           : benchmarks[i].run(argc - 2, argv + 2);
+      if (result != 0) {
+        return result;
+      }
+    }
+  }
+
+  if (!found) {
+    OE_LOG(LOG_LEVEL_ERROR, "Unknown benchmark '%s'", argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,142 @@
+// Offline asset packer. Bundles every file under the assets directory into a
+// single .opak file so the engine maps one file and finds assets with an index
+// lookup instead of opening each one. Meshes are packed pre-baked.
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "engine/assets/asset_pack.h"
+#include "engine/filesystem.h"
+#include "engine/geometry/mesh_loader.h"
+#include "engine/logger.h"
+#include "engine/platform.h"
+
+typedef struct pack_options {
+  const char *input_dir;
+  const char *output_path;
+  bool compress;
+} pack_options;
+
+static bool parse_options(int argc, char **argv, pack_options *out_options) {
+  *out_options = {};
+  out_options->compress = true;
+  int positional = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-compress") == 0) {
+      out_options->compress = false;
+    } else if (argv[i][0] == '-') {
+      return false;
+    } else if (positional == 0) {
+      out_options->input_dir = argv[i];
+      positional++;
+    } else if (positional == 1) {
+      out_options->output_path = argv[i];
+      positional++;
+    } else {
+      return false;
+    }
+  }
+  return positional == 2;
+}
+
+static bool ends_with(const std::string &text, const char *suffix) {
+  size_t length = strlen(suffix);
+  return text.size() >= length &&
+         text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// Collects the paths of every regular file under dir, relative to root
+static void list_files(const std::string &root, const std::string &dir,
+                       std::vector<std::string> *out_paths) {
+  std::string full_dir = dir.empty() ? root : root + "/" + dir;
+  DIR *handle = opendir(full_dir.c_str());
+  if (!handle) {
+    OE_LOG(LOG_LEVEL_WARN, "Unable to open directory '%s'", full_dir.c_str());
+    return;
+  }
+  while (struct dirent *entry = readdir(handle)) {
+    if (entry->d_name[0] == '.') {
+      continue;
+    }
+    std::string path = dir.empty() ? entry->d_name : dir + "/" + entry->d_name;
+    struct stat path_stat;
+    if (stat((root + "/" + path).c_str(), &path_stat) != 0) {
+      continue;
+    }
+    if (S_ISDIR(path_stat.st_mode)) {
+      list_files(root, path, out_paths);
+    } else if (S_ISREG(path_stat.st_mode)) {
+      out_paths->push_back(path);
+    }
+  }
+  closedir(handle);
+}
+
+int main(int argc, char **argv) {
+  pack_options options;
+  if (!parse_options(argc, argv, &options)) {
+    printf("usage: orion_pack <asset dir> <output.opak> [--no-compress]\n");
+    return 1;
+  }
+
+  double start = platform_get_absolute_time();
+  std::string root = options.input_dir;
+  std::vector<std::string> files;
+  list_files(root, "", &files);
+
+  // Bake the meshes, the runtime only ever reads the cache from a pack
+  std::vector<std::string> paths;
+  for (const auto &file : files) {
+    if (ends_with(file, ".tmp") || ends_with(file, ASSET_PACK_EXTENSION) ||
+        ends_with(file, MESH_CACHE_EXTENSION)) {
+      continue;
+    }
+    if (ends_with(file, ".obj")) {
+      mesh_asset mesh;
+      if (!mesh_loader_load(root + "/" + file, true, &mesh)) {
+        return 1;
+      }
+      mesh_loader_release(&mesh);
+      paths.push_back(mesh_cache_path(file));
+      continue;
+    }
+    paths.push_back(file);
+  }
+  std::sort(paths.begin(), paths.end());
+
+  std::vector<file_mapping> mappings(paths.size());
+  std::vector<asset_pack_source> sources(paths.size());
+  uint64_t total_size = 0;
+  bool ok = true;
+  for (size_t i = 0; i < paths.size() && ok; i++) {
+    std::string path = root + "/" + paths[i];
+    ok = filesystem_map(path.c_str(), FILE_MAP_HINT_SEQUENTIAL, &mappings[i]);
+    sources[i] = {paths[i].c_str(), mappings[i].data, mappings[i].size};
+    total_size += mappings[i].size;
+  }
+  ok = ok && asset_pack_write(options.output_path, sources.data(),
+                              (uint32_t)sources.size(), options.compress);
+  for (auto &mapping : mappings) {
+    filesystem_unmap(&mapping);
+  }
+  if (!ok) {
+    return 1;
+  }
+
+  struct stat pack_stat;
+  stat(options.output_path, &pack_stat);
+  OE_LOG(LOG_LEVEL_INFO,
+         "Packed %zu assets from '%s' into '%s': %.2f MB -> %.2f MB in "
+         "%.1f ms",
+         paths.size(), options.input_dir, options.output_path,
+         total_size / (1024.0 * 1024.0),
+         pack_stat.st_size / (1024.0 * 1024.0),
+         (platform_get_absolute_time() - start) * 1000.0);
+  return 0;
+}
@@ -0,0 +1,452 @@
+#include "bc_encoder.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+// Texels are worked on as floats, up to 4 channels
+typedef float block_texels[16][4];
+
+// BC7 4 bit index interpolation weights, out of 64
+static const int bc7_weights[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                    34, 38, 43, 47, 51, 55, 60, 64};
+
+static inline int clamp_int(int value, int low, int high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+// Endpoints along the texels' principal axis, found with a few rounds of
+// power iteration on their covariance
+static void fit_principal_axis(const block_texels texels, int channels,
+                               float out_e0[4], float out_e1[4]) {
+  float mean[4] = {};
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < channels; c++) {
+      mean[c] += texels[i][c] / 16.0f;
+    }
+  }
+  float covariance[4][4] = {};
+  for (int i = 0; i < 16; i++) {
+    for (int a = 0; a < channels; a++) {
+      for (int b = 0; b < channels; b++) {
+        covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+      }
+    }
+  }
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {};
+    float length = 0.0f;
+    for (int a = 0; a < channels; a++) {
+      for (int b = 0; b < channels; b++) {
+        next[a] += covariance[a][b] * axis[b];
+      }
+      length += next[a] * next[a];
+    }
+    if (length <= 1e-12f) {
+      break;
+    }
+    length = sqrtf(length);
+    for (int c = 0; c < channels; c++) {
+      axis[c] = next[c] / length;
+    }
+  }
+
+  float low = 0.0f, high = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++) {
+      t += (texels[i][c] - mean[c]) * axis[c];
+    }
+    low = t < low ? t : low;
+    high = t > high ? t : high;
+  }
+  for (int c = 0; c < channels; c++) {
+    out_e0[c] = fminf(fmaxf(mean[c] + low * axis[c], 0.0f), 255.0f);
+    out_e1[c] = fminf(fmaxf(mean[c] + high * axis[c], 0.0f), 255.0f);
+  }
+}
+
+// Refits the endpoints to a fixed set of per texel weights (0 selects e0,
+// 1 selects e1) by least squares. Returns false if the system is degenerate.
+static bool fit_least_squares(const block_texels texels, int channels,
+                              const float weights[16], float out_e0[4],
+                              float out_e1[4]) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = {}, bx[4] = {};
+  for (int i = 0; i < 16; i++) {
+    float b = weights[i];
+    float a = 1.0f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < channels; c++) {
+      ax[c] += a * texels[i][c];
+      bx[c] += b * texels[i][c];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (fabsf(determinant) < 1e-6f) {
+    return false;
+  }
+  for (int c = 0; c < channels; c++) {
+    out_e0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+    out_e1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    out_e0[c] = fminf(fmaxf(out_e0[c], 0.0f), 255.0f);
+    out_e1[c] = fminf(fmaxf(out_e1[c], 0.0f), 255.0f);
+  }
+  return true;
+}
+
+// BC1 color
+
+static inline uint16_t pack_565(const float color[4]) {
+  int r = clamp_int((int)(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+  int g = clamp_int((int)(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+  int b = clamp_int((int)(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static inline void unpack_565(uint16_t color, int out[3]) {
+  int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+  out[0] = (r << 3) | (r >> 2);
+  out[1] = (g << 2) | (g >> 4);
+  out[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the nearest of the 4 palette colors for each texel, returns the
+// total squared error. Assumes 4 color mode, color0 > color1.
+static uint32_t bc1_select_indices(const block_texels texels, uint16_t color0,
+                                   uint16_t color1, uint8_t out_indices[16]) {
+  int palette[4][3];
+  unpack_565(color0, palette[0]);
+  unpack_565(color1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+  }
+  uint32_t total = 0;
+  for (int i = 0; i < 16; i++) {
+    uint32_t best = UINT32_MAX;
+    for (int p = 0; p < 4; p++) {
+      uint32_t error = 0;
+      for (int c = 0; c < 3; c++) {
+        int d = (int)texels[i][c] - palette[p][c];
+        error += (uint32_t)(d * d);
+      }
+      if (error < best) {
+        best = error;
+        out_indices[i] = (uint8_t)p;
+      }
+    }
+    total += best;
+  }
+  return total;
+}
+
+static uint32_t bc1_try_endpoints(const block_texels texels,
+                                  const float e0[4], const float e1[4],
+                                  uint16_t *out_color0, uint16_t *out_color1,
+                                  uint8_t out_indices[16]) {
+  uint16_t color0 = pack_565(e0);
+  uint16_t color1 = pack_565(e1);
+  // 4 color mode needs color0 > color1, swapping the endpoints keeps the
+  // same palette
+  if (color0 < color1) {
+    uint16_t swap = color0;
+    color0 = color1;
+    color1 = swap;
+  }
+  *out_color0 = color0;
+  *out_color1 = color1;
+  if (color0 == color1) {
+    // Solid block, every index picks color0
+    memset(out_indices, 0, 16);
+    int palette[3];
+    unpack_565(color0, palette);
+    uint32_t total = 0;
+    for (int i = 0; i < 16; i++) {
+      for (int c = 0; c < 3; c++) {
+        int d = (int)texels[i][c] - palette[c];
+        total += (uint32_t)(d * d);
+      }
+    }
+    return total;
+  }
+  return bc1_select_indices(texels, color0, color1, out_indices);
+}
+
+static void bc1_encode_color(const block_texels texels, uint8_t *out_block) {
+  float e0[4], e1[4];
+  fit_principal_axis(texels, 3, e0, e1);
+
+  uint16_t color0, color1;
+  uint8_t indices[16];
+  uint32_t error =
+      bc1_try_endpoints(texels, e1, e0, &color0, &color1, indices);
+
+  // One least squares refinement on the chosen indices
+  static const float index_weights[4] = {0.0f, 1.0f, 1.0f / 3.0f,
+                                         2.0f / 3.0f};
+  float weights[16];
+  for (int i = 0; i < 16; i++) {
+    weights[i] = index_weights[indices[i]];
+  }
+  if (color0 != color1 && fit_least_squares(texels, 3, weights, e0, e1)) {
+    uint16_t refined0, refined1;
+    uint8_t refined_indices[16];
+    uint32_t refined_error = bc1_try_endpoints(texels, e0, e1, &refined0,
+                                               &refined1, refined_indices);
+    if (refined_error < error) {
+      color0 = refined0;
+      color1 = refined1;
+      memcpy(indices, refined_indices, sizeof(indices));
+    }
+  }
+
+  uint32_t index_bits = 0;
+  for (int i = 0; i < 16; i++) {
+    index_bits |= (uint32_t)indices[i] << (2 * i);
+  }
+  out_block[0] = (uint8_t)(color0 & 0xff);
+  out_block[1] = (uint8_t)(color0 >> 8);
+  out_block[2] = (uint8_t)(color1 & 0xff);
+  out_block[3] = (uint8_t)(color1 >> 8);
+  for (int i = 0; i < 4; i++) {
+    out_block[4 + i] = (uint8_t)(index_bits >> (8 * i));
+  }
+}
+
+// BC3 alpha, 8 interpolated values between the block's min and max
+static void bc3_encode_alpha(const block_texels texels, uint8_t *out_block) {
+  int alpha0 = 0, alpha1 = 255;
+  for (int i = 0; i < 16; i++) {
+    int alpha = (int)texels[i][3];
+    alpha0 = alpha > alpha0 ? alpha : alpha0;
+    alpha1 = alpha < alpha1 ? alpha : alpha1;
+  }
+  out_block[0] = (uint8_t)alpha0;
+  out_block[1] = (uint8_t)alpha1;
+
+  uint64_t index_bits = 0;
+  if (alpha0 != alpha1) {
+    // alpha0 > alpha1 selects the 8 value mode
+    int palette[8] = {alpha0, alpha1};
+    for (int k = 2; k < 8; k++) {
+      palette[k] = ((8 - k) * alpha0 + (k - 1) * alpha1) / 7;
+    }
+    for (int i = 0; i < 16; i++) {
+      int alpha = (int)texels[i][3];
+      int best = 0, best_error = 256;
+      for (int k = 0; k < 8; k++) {
+        int error = abs(alpha - palette[k]);
+        if (error < best_error) {
+          best_error = error;
+          best = k;
+        }
+      }
+      index_bits |= (uint64_t)best << (3 * i);
+    }
+  }
+  for (int i = 0; i < 6; i++) {
+    out_block[2 + i] = (uint8_t)(index_bits >> (8 * i));
+  }
+}
+
+// BC7 mode 6
+
+typedef struct bc7_mode6 {
+  int endpoints[2][4];  // 7 bits each
+  int p_bits[2];
+  uint8_t indices[16];
+  uint32_t error;
+} bc7_mode6;
+
+static void bc7_evaluate(const block_texels texels, bc7_mode6 *mode) {
+  int palette[16][4];
+  for (int c = 0; c < 4; c++) {
+    int v0 = (mode->endpoints[0][c] << 1) | mode->p_bits[0];
+    int v1 = (mode->endpoints[1][c] << 1) | mode->p_bits[1];
+    for (int k = 0; k < 16; k++) {
+      palette[k][c] =
+          ((64 - bc7_weights[k]) * v0 + bc7_weights[k] * v1 + 32) >> 6;
+    }
+  }
+  mode->error = 0;
+  for (int i = 0; i < 16; i++) {
+    uint32_t best = UINT32_MAX;
+    for (int k = 0; k < 16; k++) {
+      uint32_t error = 0;
+      for (int c = 0; c < 4; c++) {
+        int d = (int)texels[i][c] - palette[k][c];
+        error += (uint32_t)(d * d);
+      }
+      if (error < best) {
+        best = error;
+        mode->indices[i] = (uint8_t)k;
+      }
+    }
+    mode->error += best;
+  }
+}
+
+// Tries every p-bit combination for a pair of endpoints, keeping the best
+static void bc7_try_endpoints(const block_texels texels, const float e0[4],
+                              const float e1[4], bc7_mode6 *best) {
+  for (int p = 0; p < 4; p++) {
+    bc7_mode6 candidate;
+    candidate.p_bits[0] = p & 1;
+    candidate.p_bits[1] = p >> 1;
+    for (int c = 0; c < 4; c++) {
+      candidate.endpoints[0][c] = clamp_int(
+          (int)floorf((e0[c] - candidate.p_bits[0]) / 2.0f + 0.5f), 0, 127);
+      candidate.endpoints[1][c] = clamp_int(
+          (int)floorf((e1[c] - candidate.p_bits[1]) / 2.0f + 0.5f), 0, 127);
+    }
+    bc7_evaluate(texels, &candidate);
+    if (candidate.error < best->error) {
+      *best = candidate;
+    }
+  }
+}
+
+typedef struct bit_writer {
+  uint64_t words[2];
+  uint32_t position;
+} bit_writer;
+
+static void write_bits(bit_writer *writer, uint32_t value, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++, writer->position++) {
+    if (value & (1u << i)) {
+      writer->words[writer->position / 64] |= 1ull << (writer->position % 64);
+    }
+  }
+}
+
+static void bc7_encode(const block_texels texels, uint8_t *out_block) {
+  float e0[4], e1[4];
+  fit_principal_axis(texels, 4, e0, e1);
+
+  bc7_mode6 best;
+  best.error = UINT32_MAX;
+  bc7_try_endpoints(texels, e0, e1, &best);
+
+  float weights[16];
+  for (int i = 0; i < 16; i++) {
+    weights[i] = bc7_weights[best.indices[i]] / 64.0f;
+  }
+  if (fit_least_squares(texels, 4, weights, e0, e1)) {
+    bc7_try_endpoints(texels, e0, e1, &best);
+  }
+
+  // The anchor (first) index is stored without its top bit, so it must be
+  // below 8. Swapping the endpoints mirrors every index.
+  if (best.indices[0] >= 8) {
+    for (int c = 0; c < 4; c++) {
+      int swap = best.endpoints[0][c];
+      best.endpoints[0][c] = best.endpoints[1][c];
+      best.endpoints[1][c] = swap;
+    }
+    int swap = best.p_bits[0];
+    best.p_bits[0] = best.p_bits[1];
+    best.p_bits[1] = swap;
+    for (int i = 0; i < 16; i++) {
+      best.indices[i] = (uint8_t)(15 - best.indices[i]);
+    }
+  }
+
+  bit_writer writer = {};
+  write_bits(&writer, 1u << 6, 7);  // Mode 6
+  for (int c = 0; c < 4; c++) {
+    write_bits(&writer, (uint32_t)best.endpoints[0][c], 7);
+    write_bits(&writer, (uint32_t)best.endpoints[1][c], 7);
+  }
+  write_bits(&writer, (uint32_t)best.p_bits[0], 1);
+  write_bits(&writer, (uint32_t)best.p_bits[1], 1);
+  write_bits(&writer, best.indices[0], 3);
+  for (int i = 1; i < 16; i++) {
+    write_bits(&writer, best.indices[i], 4);
+  }
+  for (int i = 0; i < 16; i++) {
+    out_block[i] = (uint8_t)(writer.words[i / 8] >> (8 * (i % 8)));
+  }
+}
+
+uint32_t bc_block_size(bc_format format) {
+  return format == BC_FORMAT_BC1 ? 8 : 16;
+}
+
+void bc_encode_block(bc_format format, const uint8_t texels[64],
+                     uint8_t *out_block) {
+  block_texels block;
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 4; c++) {
+      block[i][c] = texels[4 * i + c];
+    }
+  }
+  switch (format) {
+    case BC_FORMAT_BC1:
+      bc1_encode_color(block, out_block);
+      break;
+    case BC_FORMAT_BC3:
+      bc3_encode_alpha(block, out_block);
+      bc1_encode_color(block, out_block + 8);
+      break;
+    case BC_FORMAT_BC7:
+      bc7_encode(block, out_block);
+      break;
+  }
+}
+
+static void encode_block_rows(bc_format format, const uint8_t *pixels,
+                              uint32_t width, uint32_t height,
+                              uint32_t first_row, uint32_t end_row,
+                              uint8_t *out_blocks) {
+  uint32_t blocks_x = (width + 3) / 4;
+  uint32_t block_size = bc_block_size(format);
+  uint8_t texels[64];
+  for (uint32_t by = first_row; by < end_row; by++) {
+    for (uint32_t bx = 0; bx < blocks_x; bx++) {
+      for (uint32_t y = 0; y < 4; y++) {
+        uint32_t py = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (uint32_t x = 0; x < 4; x++) {
+          uint32_t px = bx * 4 + x < width ? bx * 4 + x : width - 1;
+          memcpy(&texels[16 * y + 4 * x],
+                 pixels + ((size_t)py * width + px) * 4, 4);
+        }
+      }
+      bc_encode_block(format, texels,
+                      out_blocks + ((size_t)by * blocks_x + bx) * block_size);
+    }
+  }
+}
+
+void bc_encode_image(bc_format format, const uint8_t *pixels, uint32_t width,
+                     uint32_t height, uint32_t thread_count,
+                     std::vector<uint8_t> *out_blocks) {
+  uint32_t blocks_y = (height + 3) / 4;
+  out_blocks->resize((size_t)((width + 3) / 4) * blocks_y *
+                     bc_block_size(format));
+
+  if (thread_count == 0) {
+    thread_count = std::thread::hardware_concurrency();
+  }
+  thread_count = thread_count < blocks_y ? thread_count : blocks_y;
+  if (thread_count == 0) {
+    thread_count = 1;
+  }
+
+  std::vector<std::thread> threads;
+  for (uint32_t i = 1; i < thread_count; i++) {
+    threads.emplace_back(encode_block_rows, format, pixels, width, height,
+                         blocks_y * i / thread_count,
+                         blocks_y * (i + 1) / thread_count, out_blocks->data());
+  }
+  encode_block_rows(format, pixels, width, height, 0, blocks_y / thread_count,
+                    out_blocks->data());
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef BC_ENCODER_H
+#define BC_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+typedef enum bc_format {
+  // RGB, 8 bytes per block. Alpha is dropped
+  BC_FORMAT_BC1 = 0,
+  // RGBA, 16 bytes per block. BC1 color plus 8 bit interpolated alpha
+  BC_FORMAT_BC3 = 1,
+  // RGBA, 16 bytes per block. Only mode 6 (one subset, 4 bit indices) is
+  // emitted, which every BC7 decoder handles and suits smooth content
+  BC_FORMAT_BC7 = 2
+} bc_format;
+
+/**
+ * @brief Gets the number of bytes in one 4x4 block of a format
+ */
+uint32_t bc_block_size(bc_format format);
+
+/**
+ * @brief Encodes one 4x4 block of RGBA8 texels, row by row
+ */
+void bc_encode_block(bc_format format, const uint8_t texels[64],
+                     uint8_t* out_block);
+
+/**
+ * @brief Encodes an RGBA8 image into blocks, row by row. Partial blocks on
+ * the right and bottom edges repeat the last column/row.
+ * @param thread_count Threads to encode with, 0 for one per hardware thread
+ */
+void bc_encode_image(bc_format format, const uint8_t* pixels, uint32_t width,
+                     uint32_t height, uint32_t thread_count,
+                     std::vector<uint8_t>* out_blocks);
+
+#endif
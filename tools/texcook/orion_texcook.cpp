@@ -0,0 +1,286 @@
+// Offline texture cooker. Converts a source image into a KTX2 file holding
+// BC compressed blocks and a prebuilt mip chain, which the renderer copies
+// straight into a staging buffer without decoding anything at load time.
+
+#include <stdio.h>
+#include <string.h>
+
+#include <cstdlib>
+#include <vector>
+
+#include "bc_encoder.h"
+#include "engine/logger.h"
+#include "engine/platform.h"
+#include "engine/resources/stb_image.h"
+#include "engine/texture/ktx2.h"
+#include "engine/texture/mipmap.h"
+
+// Data format descriptor values, from the Khronos Data Format spec
+#define DFD_VERSION 2
+#define DFD_COLOR_MODEL_RGBSDA 1
+#define DFD_COLOR_MODEL_BC1A 128
+#define DFD_COLOR_MODEL_BC3 130
+#define DFD_COLOR_MODEL_BC7 134
+#define DFD_PRIMARIES_BT709 1
+#define DFD_TRANSFER_LINEAR 1
+#define DFD_TRANSFER_SRGB 2
+#define DFD_CHANNEL_ALPHA 15
+#define DFD_SAMPLE_LINEAR 0x10
+
+// The block formats share bc_format's values
+typedef enum cook_format {
+  COOK_FORMAT_BC1 = BC_FORMAT_BC1,
+  COOK_FORMAT_BC3 = BC_FORMAT_BC3,
+  COOK_FORMAT_BC7 = BC_FORMAT_BC7,
+  COOK_FORMAT_RGBA8
+} cook_format;
+
+typedef struct cook_options {
+  const char *input_path;
+  const char *output_path;
+  cook_format format;
+  bool srgb;
+  bool mips;
+} cook_options;
+
+typedef struct dfd_sample {
+  uint32_t bit_offset;
+  uint32_t bit_length;
+  uint32_t channel;
+  uint32_t upper;
+} dfd_sample;
+
+static uint32_t vk_format_for(cook_format format, bool srgb) {
+  switch (format) {
+    case COOK_FORMAT_BC1:
+      return srgb ? KTX2_VK_FORMAT_BC1_RGB_SRGB : KTX2_VK_FORMAT_BC1_RGB_UNORM;
+    case COOK_FORMAT_BC3:
+      return srgb ? KTX2_VK_FORMAT_BC3_SRGB : KTX2_VK_FORMAT_BC3_UNORM;
+    case COOK_FORMAT_BC7:
+      return srgb ? KTX2_VK_FORMAT_BC7_SRGB : KTX2_VK_FORMAT_BC7_UNORM;
+    case COOK_FORMAT_RGBA8:
+      break;
+  }
+  return srgb ? KTX2_VK_FORMAT_R8G8B8A8_SRGB : KTX2_VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+static void append_u32(std::vector<uint8_t> *out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out->push_back((uint8_t)(value >> (8 * i)));
+  }
+}
+
+// Builds the basic data format descriptor, including its leading total size
+static std::vector<uint8_t> build_dfd(const cook_options *options) {
+  uint32_t color_model = DFD_COLOR_MODEL_RGBSDA;
+  uint32_t block_dimension = 1;
+  uint32_t block_size = 4;
+  // Alpha is never sRGB encoded, so it gets the linear qualifier when the
+  // color channels are
+  uint32_t alpha = DFD_CHANNEL_ALPHA | (options->srgb ? DFD_SAMPLE_LINEAR : 0);
+  std::vector<dfd_sample> samples;
+  switch (options->format) {
+    case COOK_FORMAT_BC1:
+      color_model = DFD_COLOR_MODEL_BC1A;
+      block_dimension = 4;
+      block_size = 8;
+      samples = {{0, 64, 0, UINT32_MAX}};
+      break;
+    case COOK_FORMAT_BC3:
+      color_model = DFD_COLOR_MODEL_BC3;
+      block_dimension = 4;
+      block_size = 16;
+      samples = {{0, 64, alpha, UINT32_MAX}, {64, 64, 0, UINT32_MAX}};
+      break;
+    case COOK_FORMAT_BC7:
+      color_model = DFD_COLOR_MODEL_BC7;
+      block_dimension = 4;
+      block_size = 16;
+      samples = {{0, 128, 0, UINT32_MAX}};
+      break;
+    case COOK_FORMAT_RGBA8:
+      samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255},
+                 {24, 8, alpha, 255}};
+      break;
+  }
+
+  uint32_t block_length = 24 + 16 * (uint32_t)samples.size();
+  std::vector<uint8_t> dfd;
+  append_u32(&dfd, 4 + block_length);
+  append_u32(&dfd, 0);  // Khronos vendor, basic descriptor type
+  append_u32(&dfd, DFD_VERSION | (block_length << 16));
+  append_u32(&dfd, color_model | (DFD_PRIMARIES_BT709 << 8) |
+                       ((options->srgb ? DFD_TRANSFER_SRGB
+                                       : DFD_TRANSFER_LINEAR)
+                        << 16));
+  append_u32(&dfd, (block_dimension - 1) | ((block_dimension - 1) << 8));
+  append_u32(&dfd, block_size);
+  append_u32(&dfd, 0);
+  for (const dfd_sample &sample : samples) {
+    append_u32(&dfd, sample.bit_offset | ((sample.bit_length - 1) << 16) |
+                         (sample.channel << 24));
+    append_u32(&dfd, 0);  // Sample position
+    append_u32(&dfd, 0);  // Lower
+    append_u32(&dfd, sample.upper);
+  }
+  return dfd;
+}
+
+static bool write_ktx2(const cook_options *options, uint32_t width,
+                       uint32_t height,
+                       const std::vector<std::vector<uint8_t>> &levels) {
+  uint32_t level_count = (uint32_t)levels.size();
+  std::vector<uint8_t> dfd = build_dfd(options);
+  uint32_t alignment =
+      ktx2_format_block_size(vk_format_for(options->format, options->srgb),
+                             nullptr);
+
+  size_t dfd_offset = KTX2_IDENTIFIER_SIZE + sizeof(ktx2_header) +
+                      level_count * sizeof(ktx2_level_index);
+  size_t offset = dfd_offset + dfd.size();
+
+  // Levels are stored smallest first, each aligned to a texel block
+  std::vector<ktx2_level_index> index(level_count);
+  for (uint32_t i = level_count; i-- > 0;) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    index[i].byte_offset = offset;
+    index[i].byte_length = levels[i].size();
+    index[i].uncompressed_byte_length = levels[i].size();
+    offset += levels[i].size();
+  }
+
+  ktx2_header header = {
+      .vk_format = vk_format_for(options->format, options->srgb),
+      .type_size = 1,
+      .pixel_width = width,
+      .pixel_height = height,
+      .pixel_depth = 0,
+      .layer_count = 0,
+      .face_count = 1,
+      .level_count = level_count,
+      .supercompression_scheme = 0,
+      .dfd_byte_offset = (uint32_t)dfd_offset,
+      .dfd_byte_length = (uint32_t)dfd.size(),
+  };
+
+  FILE *file = fopen(options->output_path, "wb");
+  if (!file) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to open '%s' for writing",
+           options->output_path);
+    return false;
+  }
+  static const uint8_t identifier[KTX2_IDENTIFIER_SIZE] = KTX2_IDENTIFIER;
+  static const uint8_t padding[16] = {};
+  bool ok = fwrite(identifier, sizeof(identifier), 1, file) == 1 &&
+            fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(index.data(), sizeof(ktx2_level_index), level_count,
+                   file) == level_count &&
+            fwrite(dfd.data(), dfd.size(), 1, file) == 1;
+  size_t written = dfd_offset + dfd.size();
+  for (uint32_t i = level_count; ok && i-- > 0;) {
+    ok = fwrite(padding, 1, index[i].byte_offset - written, file) ==
+             index[i].byte_offset - written &&
+         fwrite(levels[i].data(), levels[i].size(), 1, file) == 1;
+    written = index[i].byte_offset + index[i].byte_length;
+  }
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to write '%s'", options->output_path);
+  }
+  return ok;
+}
+
+static bool parse_options(int argc, char **argv, cook_options *out_options) {
+  *out_options = {
+      .input_path = nullptr,
+      .output_path = nullptr,
+      .format = COOK_FORMAT_BC7,
+      .srgb = true,
+      .mips = true,
+  };
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+      const char *name = argv[++i];
+      if (strcmp(name, "bc1") == 0) {
+        out_options->format = COOK_FORMAT_BC1;
+      } else if (strcmp(name, "bc3") == 0) {
+        out_options->format = COOK_FORMAT_BC3;
+      } else if (strcmp(name, "bc7") == 0) {
+        out_options->format = COOK_FORMAT_BC7;
+      } else if (strcmp(name, "rgba8") == 0) {
+        out_options->format = COOK_FORMAT_RGBA8;
+      } else {
+        OE_LOG(LOG_LEVEL_ERROR, "Unknown format '%s'", name);
+        return false;
+      }
+    } else if (strcmp(argv[i], "--linear") == 0) {
+      out_options->srgb = false;
+    } else if (strcmp(argv[i], "--no-mips") == 0) {
+      out_options->mips = false;
+    } else if (!out_options->input_path) {
+      out_options->input_path = argv[i];
+    } else if (!out_options->output_path) {
+      out_options->output_path = argv[i];
+    } else {
+      return false;
+    }
+  }
+  return out_options->input_path && out_options->output_path;
+}
+
+int main(int argc, char **argv) {
+  cook_options options;
+  if (!parse_options(argc, argv, &options)) {
+    printf(
+        "usage: orion_texcook <input> <output.ktx2> "
+        "[--format bc1|bc3|bc7|rgba8] [--linear] [--no-mips]\n");
+    return 1;
+  }
+
+  double start = platform_get_absolute_time();
+  int width, height, channels;
+  stbi_uc *pixels = stbi_load(options.input_path, &width, &height, &channels,
+                              STBI_rgb_alpha);
+  if (!pixels) {
+    OE_LOG(LOG_LEVEL_ERROR, "Failed to load image '%s'", options.input_path);
+    return 1;
+  }
+
+  mip_chain chain;
+  if (options.mips) {
+    mipmap_generate(pixels, (uint32_t)width, (uint32_t)height, options.srgb, 0,
+                    &chain);
+  } else {
+    size_t size = (size_t)width * height * 4;
+    chain.pixels.assign(pixels, pixels + size);
+    chain.levels = {{(uint32_t)width, (uint32_t)height, 0, size}};
+  }
+  stbi_image_free(pixels);
+
+  std::vector<std::vector<uint8_t>> levels(chain.levels.size());
+  size_t source_size = 0;
+  size_t cooked_size = 0;
+  for (size_t i = 0; i < chain.levels.size(); i++) {
+    const mip_level *level = &chain.levels[i];
+    const uint8_t *data = chain.pixels.data() + level->offset;
+    if (options.format == COOK_FORMAT_RGBA8) {
+      levels[i].assign(data, data + level->size);
+    } else {
+      bc_encode_image((bc_format)options.format, data, level->width,
+                      level->height, 0, &levels[i]);
+    }
+    source_size += level->size;
+    cooked_size += levels[i].size();
+  }
+
+  if (!write_ktx2(&options, (uint32_t)width, (uint32_t)height, levels)) {
+    return 1;
+  }
+  double ms = (platform_get_absolute_time() - start) * 1000.0;
+  OE_LOG(LOG_LEVEL_INFO,
+         "Cooked '%s' (%dx%d, %zu levels) into '%s': %.2f MB -> %.2f MB in "
+         "%.1f ms",
+         options.input_path, width, height, levels.size(), options.output_path,
+         source_size / (1024.0 * 1024.0), cooked_size / (1024.0 * 1024.0), ms);
+  return 0;
+}